@@ -0,0 +1,39 @@
+//
+//  AMDRyzenCPUEnergy.h
+//  AMDRyzenCPUPowerManagement
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#ifndef AMDRyzenCPUEnergy_h
+#define AMDRyzenCPUEnergy_h
+
+/**
+ *  Core::X86::Msr::CORE_ENERGY_STAT and PKG_ENERGY_STAT count energy units in their low 32 bits
+ *  and wrap silently. Subtracting modulo 2^32 keeps each delta exact as long as the counter
+ *  advances less than one full turn between two reads, which at the unit sizes of Zen takes
+ *  minutes even under full load.
+ *
+ *  Kept apart from the provider so the arithmetic is checked by Tests/ on the host.
+ */
+
+#include <stdint.h>
+
+typedef struct energy_counter {
+    uint32_t last;
+    uint64_t acc;
+} energy_counter;
+
+/**
+ *  Folds a raw MSR value into the running total, returns the units consumed since the last read.
+ */
+static inline uint32_t energy_accumulate(energy_counter *ec, uint64_t msr){
+    uint32_t value = (uint32_t)(msr & 0xffffffff);
+    uint32_t delta = value - ec->last;
+
+    ec->acc += delta;
+    ec->last = value;
+    return delta;
+}
+
+#endif /* AMDRyzenCPUEnergy_h */
@@ -0,0 +1,97 @@
+//
+//  AMDRyzenCPUFanCurve.cpp
+//  AMDRyzenCPUPowerManagement
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#include "AMDRyzenCPUFanCurve.hpp"
+
+bool AMDRyzenCPUFanCurve::validate(const AMDRyzenFanCurve *curve){
+    if(curve->version != AMDRYZEN_FANCURVE_VERSION) return false;
+    if(!curve->enabled) return true;
+
+    if(curve->source >= kAMDRyzenFanSourceCount) return false;
+    if(!curve->numPoints || curve->numPoints > AMDRYZEN_FANCURVE_MAX_POINTS) return false;
+
+    for(uint32_t i = 0; i < curve->numPoints; i++){
+        //Rejects NaN too.
+        if(!(curve->tempC[i] > -100.0f && curve->tempC[i] < 200.0f)) return false;
+        if(i && curve->tempC[i] < curve->tempC[i - 1]) return false;
+    }
+
+    if(!(curve->hysteresisC >= 0) || !(curve->slewPerSec >= 0)) return false;
+
+    return curve->kp == curve->kp && curve->ki == curve->ki && curve->kd == curve->kd &&
+           curve->targetC == curve->targetC;
+}
+
+void AMDRyzenCPUFanCurve::configure(const AMDRyzenFanCurve *curve){
+    config = *curve;
+
+    primed = false;
+    integral = 0;
+    prevError = 0;
+}
+
+float AMDRyzenCPUFanCurve::interpolate(float temp) const {
+    uint32_t n = config.numPoints;
+
+    if(temp <= config.tempC[0]) return config.pwm[0];
+    if(temp >= config.tempC[n - 1]) return config.pwm[n - 1];
+
+    uint32_t i = 1;
+    while(temp > config.tempC[i]) i++;
+
+    float span = config.tempC[i] - config.tempC[i - 1];
+    if(span <= 0) return config.pwm[i];
+
+    float t = (temp - config.tempC[i - 1]) / span;
+    return config.pwm[i - 1] + t * ((float)config.pwm[i] - (float)config.pwm[i - 1]);
+}
+
+uint8_t AMDRyzenCPUFanCurve::evaluate(float temp, float dt){
+    //Follow rising temperatures right away, falling ones only once they leave the band.
+    if(!primed || temp > heldTemp)
+        heldTemp = temp;
+    else if(temp < heldTemp - config.hysteresisC)
+        heldTemp = temp + config.hysteresisC;
+
+    float target = interpolate(heldTemp);
+
+    if(config.kp != 0 || config.ki != 0 || config.kd != 0){
+        float error = temp - config.targetC;
+        float correction = config.kp * error;
+
+        if(primed && dt > 0){
+            correction += config.kd * (error - prevError) / dt;
+
+            //Only integrate while the output can still move the way the error pushes it, a fan
+            //held at 0 through a long idle would otherwise start the next load far behind.
+            float unclamped = target + correction + config.ki * integral;
+            float push = config.ki * error;
+            if(!(unclamped >= 255.0f && push > 0) && !(unclamped <= 0 && push < 0))
+                integral += error * dt;
+
+            //Keep the integral term within the PWM range so it can unwind quickly.
+            if(config.ki != 0){
+                float limit = 255.0f / (config.ki > 0 ? config.ki : -config.ki);
+                integral = integral > limit ? limit : (integral < -limit ? -limit : integral);
+            }
+        }
+
+        target += correction + config.ki * integral;
+        prevError = error;
+    }
+
+    if(primed && config.slewPerSec > 0){
+        float step = config.slewPerSec * dt;
+        if(target > output + step) target = output + step;
+        if(target < output - step) target = output - step;
+    }
+
+    output = target > 255.0f ? 255.0f : (target < 0 ? 0 : target);
+    primed = true;
+
+    return (uint8_t)(output + 0.5f);
+}
@@ -0,0 +1,50 @@
+//
+//  AMDRyzenCPUFanCurve.hpp
+//  AMDRyzenCPUPowerManagement
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#ifndef AMDRyzenCPUFanCurve_hpp
+#define AMDRyzenCPUFanCurve_hpp
+
+#include <IOKit/IOLib.h>
+
+#include "AMDRyzenCPUPMFanCurve.h"
+
+/**
+ *  Closed loop state of one fan, see AMDRyzenCPUPMFanCurve.h for the pipeline.
+ *  Only the timer calls evaluate, configure is serialised against it by the provider.
+ */
+class AMDRyzenCPUFanCurve {
+
+public:
+    static bool validate(const AMDRyzenFanCurve *curve);
+
+    void configure(const AMDRyzenFanCurve *curve);
+    const AMDRyzenFanCurve *getConfig() const { return &config; }
+    bool isEnabled() const { return config.enabled; }
+
+    /**
+     *  PWM for temp, dt is the time since the previous call in seconds.
+     */
+    uint8_t evaluate(float temp, float dt);
+
+    /**
+     *  PWM returned by the last evaluate, -1 if the curve has not run since it was configured.
+     */
+    int lastOutput() const { return primed ? (int)(output + 0.5f) : -1; }
+
+private:
+    AMDRyzenFanCurve config {};
+
+    bool primed = false;
+    float heldTemp = 0;
+    float output = 0;
+    float integral = 0;
+    float prevError = 0;
+
+    float interpolate(float temp) const;
+};
+
+#endif /* AMDRyzenCPUFanCurve_hpp */
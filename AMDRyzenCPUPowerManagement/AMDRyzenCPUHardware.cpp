@@ -0,0 +1,125 @@
+//
+//  AMDRyzenCPUHardware.cpp
+//  AMDRyzenCPUPowerManagement
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#include "AMDRyzenCPUPowerManagement.hpp"
+
+#include <architecture/i386/pio.h>
+
+AMDRyzenCPUHardware *AMDRyzenCPUHardware::sharedInstance = nullptr;
+
+AMDRyzenCPUHardware *AMDRyzenCPUHardware::shared(){
+    return sharedInstance;
+}
+
+void AMDRyzenCPUHardware::setShared(AMDRyzenCPUHardware *hw){
+    sharedInstance = hw;
+}
+
+
+bool AMDRyzenCPUNativeHardware::readMSR(uint32_t addr, uint64_t *value){
+    uint32_t lo, hi;
+    int err = rdmsr_carefully(addr, &lo, &hi);
+
+    if(!err) *value = lo | ((uint64_t)hi << 32);
+
+    return err == 0;
+}
+
+bool AMDRyzenCPUNativeHardware::writeMSR(uint32_t addr, uint64_t value){
+    if(wrmsrCarefully){
+        uint32_t lo = value & 0xffffffff;
+        uint32_t hi = value >> 32;
+        return (*wrmsrCarefully)(addr, lo, hi) == 0;
+    }
+
+    //Fall back with unsafe method
+    wrmsr64(addr, value);
+
+    //If failed, we've already panic and starting reboot. So just return true.
+    return true;
+}
+
+void AMDRyzenCPUNativeHardware::readEffectiveFrequencyCounters(uint64_t *aperf, uint64_t *mperf){
+    uint32_t APERF_lo, APERF_hi;
+    uint32_t MPERF_lo, MPERF_hi;
+
+    __asm__ volatile("movl $0xe8, %%ecx;"
+                     "rdmsr;"
+                     "movl %%eax, %0;"
+                     "movl %%edx, %1;"
+                     "movl $0xe7, %%ecx;"
+                     "rdmsr;"
+                     : "=r"(APERF_lo), "=r"(APERF_hi), "=a"(MPERF_lo), "=d"(MPERF_hi)
+                     :
+                     : "%ecx"
+                    );
+
+    *aperf = APERF_lo | ((uint64_t)APERF_hi << 32);
+    *mperf = MPERF_lo | ((uint64_t)MPERF_hi << 32);
+}
+
+uint32_t AMDRyzenCPUNativeHardware::pciConfigRead32(uint8_t offset){
+    IOPCIAddressSpace space;
+    space.bits = 0x00;
+
+    return pciDevice->configRead32(space, offset);
+}
+
+void AMDRyzenCPUNativeHardware::pciConfigWrite32(uint8_t offset, uint32_t value){
+    IOPCIAddressSpace space;
+    space.bits = 0x00;
+
+    pciDevice->configWrite32(space, offset, value);
+}
+
+uint8_t AMDRyzenCPUNativeHardware::portRead8(uint16_t port){
+    return inb(port);
+}
+
+void AMDRyzenCPUNativeHardware::portWrite8(uint16_t port, uint8_t value){
+    outb(port, value);
+}
+
+uint64_t AMDRyzenCPUNativeHardware::readTSC(){
+    return rdtsc64();
+}
+
+int AMDRyzenCPUNativeHardware::cpuNumber(){
+    return cpu_number();
+}
+
+void AMDRyzenCPUNativeHardware::rendezvous(void (*action)(void *), void *arg){
+    mp_rendezvous(nullptr, action, nullptr, arg);
+}
+
+void AMDRyzenCPUNativeHardware::rendezvousNoIntrs(void (*action)(void *), void *arg){
+    mp_rendezvous_no_intrs(action, arg);
+}
+
+void AMDRyzenCPUNativeHardware::crossCall(const uint64_t *cpuMask, uint32_t words, void (*action)(void *), void *arg){
+    //mp_cpus_call only takes cpus below 64.
+    bool fits = mpCpusCall != nullptr;
+    for(uint32_t i = 1; fits && i < words; i++){
+        if(cpuMask[i]) fits = false;
+    }
+
+    if(fits){
+        if(cpuMask[0]) (*mpCpusCall)(cpuMask[0], kMPAsync, action, arg);
+        return;
+    }
+
+    //Everyone joins the rendezvous but only CPUs in the mask run the action.
+    FilteredCall call = {cpuMask, words, action, arg};
+
+    mp_rendezvous_no_intrs([](void *obj) {
+        auto call = static_cast<FilteredCall*>(obj);
+        uint32_t cpu = cpu_number();
+
+        if(cpu / 64 < call->words && (call->cpuMask[cpu / 64] & (1ULL << (cpu % 64))))
+            call->action(call->arg);
+    }, &call);
+}
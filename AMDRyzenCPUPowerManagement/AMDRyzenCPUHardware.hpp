@@ -0,0 +1,111 @@
+//
+//  AMDRyzenCPUHardware.hpp
+//  AMDRyzenCPUPowerManagement
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#ifndef AMDRyzenCPUHardware_hpp
+#define AMDRyzenCPUHardware_hpp
+
+#include <IOKit/IOLib.h>
+#include <IOKit/pci/IOPCIDevice.h>
+
+/**
+ *  Every access the sampling engine and SuperIO drivers make to the machine goes through
+ *  this interface, so the engine can be driven by something other than real hardware,
+ *  such as AMDRyzenCPUSimulatedHardware which Tests/ runs against.
+ *  pmAMDRyzen.c's idle loop binds its few accesses at compile time, see PMRYZEN_HW_HOOKS.
+ */
+class AMDRyzenCPUHardware {
+
+public:
+    virtual ~AMDRyzenCPUHardware() {}
+
+    virtual bool readMSR(uint32_t addr, uint64_t *value) = 0;
+    virtual bool writeMSR(uint32_t addr, uint64_t value) = 0;
+
+    /**
+     *  APERF and MPERF must be read back to back with no more than 3 MOVs in between,
+     *  so they get their own call instead of two readMSR.
+     */
+    virtual void readEffectiveFrequencyCounters(uint64_t *aperf, uint64_t *mperf) = 0;
+
+    virtual uint32_t pciConfigRead32(uint8_t offset) = 0;
+    virtual void pciConfigWrite32(uint8_t offset, uint32_t value) = 0;
+
+    virtual uint8_t portRead8(uint16_t port) = 0;
+    virtual void portWrite8(uint16_t port, uint8_t value) = 0;
+
+    virtual uint64_t readTSC() = 0;
+
+    virtual int cpuNumber() = 0;
+    virtual void rendezvous(void (*action)(void *), void *arg) = 0;
+    virtual void rendezvousNoIntrs(void (*action)(void *), void *arg) = 0;
+
+    /**
+     *  Run action with interrupts disabled on each CPU set in cpuMask and wait for all of them.
+     *  Bit n of word w is cpu_num 64 * w + n.
+     */
+    virtual void crossCall(const uint64_t *cpuMask, uint32_t words, void (*action)(void *), void *arg) = 0;
+
+    /**
+     *  Backend used by code without a provider pointer (SuperIO probing).
+     */
+    static AMDRyzenCPUHardware *shared();
+    static void setShared(AMDRyzenCPUHardware *hw);
+
+private:
+    static AMDRyzenCPUHardware *sharedInstance;
+};
+
+
+class AMDRyzenCPUNativeHardware : public AMDRyzenCPUHardware {
+
+public:
+    /**
+     *  mp_cpus_call(cpumask_t, mp_sync_t, action, arg), nullptr makes crossCall fall back to a rendezvous.
+     */
+    typedef uint32_t (*mp_cpus_call_t)(uint64_t cpus, uint32_t mode, void (*action)(void *), void *arg);
+
+    AMDRyzenCPUNativeHardware(IOPCIDevice *pciDevice, int (*wrmsrCarefully)(uint32_t, uint32_t, uint32_t),
+                              mp_cpus_call_t mpCpusCall) :
+    pciDevice(pciDevice), wrmsrCarefully(wrmsrCarefully), mpCpusCall(mpCpusCall) {}
+
+    bool readMSR(uint32_t addr, uint64_t *value) override;
+    bool writeMSR(uint32_t addr, uint64_t value) override;
+    void readEffectiveFrequencyCounters(uint64_t *aperf, uint64_t *mperf) override;
+
+    uint32_t pciConfigRead32(uint8_t offset) override;
+    void pciConfigWrite32(uint8_t offset, uint32_t value) override;
+
+    uint8_t portRead8(uint16_t port) override;
+    void portWrite8(uint16_t port, uint8_t value) override;
+
+    uint64_t readTSC() override;
+
+    int cpuNumber() override;
+    void rendezvous(void (*action)(void *), void *arg) override;
+    void rendezvousNoIntrs(void (*action)(void *), void *arg) override;
+    void crossCall(const uint64_t *cpuMask, uint32_t words, void (*action)(void *), void *arg) override;
+
+private:
+    /**
+     *  mp_sync_t ASYNC: the action is queued on all targets at once and mp_cpus_call returns
+     *  once every one of them has run it. SYNC would run the targets one after another.
+     */
+    static constexpr uint32_t kMPAsync = 1;
+
+    struct FilteredCall {
+        const uint64_t *cpuMask;
+        uint32_t words;
+        void (*action)(void *);
+        void *arg;
+    };
+
+    IOPCIDevice *pciDevice;
+    int (*wrmsrCarefully)(uint32_t, uint32_t, uint32_t);
+    mp_cpus_call_t mpCpusCall;
+};
+
+#endif /* AMDRyzenCPUHardware_hpp */
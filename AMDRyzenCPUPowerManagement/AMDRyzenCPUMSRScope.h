@@ -0,0 +1,74 @@
+//
+//  AMDRyzenCPUMSRScope.h
+//  AMDRyzenCPUPowerManagement
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#ifndef AMDRyzenCPUMSRScope_h
+#define AMDRyzenCPUMSRScope_h
+
+/**
+ *  How many logical CPUs share one instance of an MSR, a write needs one CPU per instance.
+ *  Registers from Processor Programming Reference for AMD 17h CPU, anything not listed is
+ *  per thread.
+ *
+ *  Kept apart from the provider so the cross-call masks are built by Tests/ on the host.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "pmAMDRyzen.h"
+#ifdef __cplusplus
+}
+#endif
+
+enum {
+    kAMDRyzenMSRScopeThread     = 0,
+    kAMDRyzenMSRScopeCore       = 1,
+    kAMDRyzenMSRScopePackage    = 2,
+};
+
+#define AMDRYZEN_MSR_SCOPE_TABLE_LEN 4
+static const struct AMDRyzenMSRScopeDesc {
+    uint32_t first;
+    uint32_t count;
+    uint8_t scope;
+} AMDRyzenMSRScopeTable[] = {
+    { 0xC0010064, 8, kAMDRyzenMSRScopeCore },       /* PStateDef */
+    { 0xC001029A, 1, kAMDRyzenMSRScopeCore },       /* CORE_ENERGY_STAT */
+    { 0xC001029B, 1, kAMDRyzenMSRScopePackage },    /* PKG_ENERGY_STAT */
+    { 0xC0010299, 1, kAMDRyzenMSRScopePackage },    /* RAPL_PWR_UNIT */
+};
+
+static inline uint8_t AMDRyzenMSRScope(uint32_t addr){
+    for(uint32_t i = 0; i < AMDRYZEN_MSR_SCOPE_TABLE_LEN; i++){
+        const struct AMDRyzenMSRScopeDesc *ms = AMDRyzenMSRScopeTable + i;
+        if(addr >= ms->first && addr < ms->first + ms->count)
+            return ms->scope;
+    }
+
+    return kAMDRyzenMSRScopeThread;
+}
+
+/**
+ *  One CPU per instance of addr out of the CPUs pmRyzen_init found, as a mask of words
+ *  64 bit words.
+ */
+static inline void AMDRyzenMSRScopeMask(uint32_t addr, uint64_t *cpuMask, uint32_t words){
+    uint8_t scope = AMDRyzenMSRScope(addr);
+    for(uint32_t i = 0; i < words; i++) cpuMask[i] = 0;
+
+    for(uint32_t i = 0; i < pmRyzen_num_slots && i / 64 < words; i++){
+        if(!pmRyzen_cpunum_to_lcpu[i]) continue;
+
+        if((scope == kAMDRyzenMSRScopeCore && !pmRyzen_cpu_primary_in_core(i)) ||
+           (scope == kAMDRyzenMSRScopePackage && !pmRyzen_cpu_primary_in_package(i)))
+            continue;
+
+        cpuMask[i / 64] |= 1ULL << (i % 64);
+    }
+}
+
+#endif /* AMDRyzenCPUMSRScope_h */
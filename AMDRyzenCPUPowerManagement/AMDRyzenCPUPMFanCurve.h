@@ -0,0 +1,57 @@
+//
+//  AMDRyzenCPUPMFanCurve.h
+//  AMDRyzenCPUPowerManagement
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#ifndef AMDRyzenCPUPMFanCurve_h
+#define AMDRyzenCPUPMFanCurve_h
+
+/**
+ *  Fan curve configuration accepted by the set fan curve selector, one per fan.
+ *
+ *  The kext evaluates enabled curves on every timer tick: the source temperature goes through
+ *  the hysteresis band, is mapped to a PWM by linear interpolation between points, corrected
+ *  by the optional PID term around targetC and finally slew limited. Disabling a curve hands
+ *  the fan back to its default control mode.
+ *
+ *  The selector takes exactly sizeof(AMDRyzenFanCurve) and rejects any other version, so adding
+ *  or reordering fields means bumping AMDRYZEN_FANCURVE_VERSION. Floats are IEEE single precision.
+ */
+
+#include <stdint.h>
+
+#define AMDRYZEN_FANCURVE_VERSION 1
+#define AMDRYZEN_FANCURVE_MAX_POINTS 8
+
+enum {
+    kAMDRyzenFanSourcePackage       = 0, // Tctl minus offset, sourceIndex must be 0
+    kAMDRyzenFanSourceCCDMax        = 1, // Hottest CCD, package if the CCDs are not readable
+    kAMDRyzenFanSourceCCD           = 2, // CCD sourceIndex
+    kAMDRyzenFanSourceSuperIO       = 3, // SuperIO temperature channel sourceIndex, package if absent
+
+    kAMDRyzenFanSourceCount
+};
+
+typedef struct AMDRyzenFanCurve {
+    uint32_t version;
+
+    uint8_t enabled;
+    uint8_t source;
+    uint8_t sourceIndex;
+    uint8_t numPoints;              // 1...AMDRYZEN_FANCURVE_MAX_POINTS
+
+    float tempC[AMDRYZEN_FANCURVE_MAX_POINTS]; // Ascending
+    uint8_t pwm[AMDRYZEN_FANCURVE_MAX_POINTS];
+
+    float hysteresisC;              // Temperature has to fall this far before the fan slows down
+    float slewPerSec;               // Largest PWM change per second, 0 for unlimited
+
+    float targetC;                  // PID set point
+    float kp;                       // PID gains in PWM per degree, all 0 disables the PID term
+    float ki;
+    float kd;
+} AMDRyzenFanCurve;
+
+#endif /* AMDRyzenCPUPMFanCurve_h */
@@ -0,0 +1,172 @@
+//
+//  AMDRyzenCPUPMSnapshot.h
+//  AMDRyzenCPUPowerManagement
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#ifndef AMDRyzenCPUPMSnapshot_h
+#define AMDRyzenCPUPMSnapshot_h
+
+/**
+ *  Wire format of the "get everything" selector.
+ *
+ *  A snapshot is a header followed by one section per bit set in fieldMask, in bit order.
+ *  Every section starts 8 byte aligned and its size only depends on the counts in the header,
+ *  so a client can locate any section without knowing the ones it did not ask for.
+ *
+ *  New data only ever gets a new bit above the existing ones, a section's layout never changes
+ *  under the same AMDRYZEN_SNAPSHOT_VERSION. The header may grow, readers skip it by headerSize.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#define AMDRYZEN_SNAPSHOT_VERSION 1
+
+enum {
+    kAMDRyzenSnapshotPackage        = 1 << 0, // AMDRyzenSnapshotPackage
+    kAMDRyzenSnapshotCoreFreq       = 1 << 1, // float[numPhysCores], MHz
+    kAMDRyzenSnapshotCoreLoad       = 1 << 2, // float[numPhysCores], 0...1
+    kAMDRyzenSnapshotInstRetired    = 1 << 3, // uint64_t[numLogicalCores], delta since last tick
+    kAMDRyzenSnapshotPState         = 1 << 4, // uint8_t[numLogicalCores], governor P-state
+    kAMDRyzenSnapshotFans           = 1 << 5, // AMDRyzenSnapshotFan[numFans]
+    kAMDRyzenSnapshotCorePower      = 1 << 6, // float[numPhysCores], Watts
+    kAMDRyzenSnapshotEnergy         = 1 << 7, // double[1 + numPhysCores], cumulative Joules, package first
+    kAMDRyzenSnapshotCCDTemp        = 1 << 8, // float[numCCDs], Celsius
+    kAMDRyzenSnapshotSVI            = 1 << 9, // AMDRyzenSnapshotSVI, zero if SVI2 is not supported
+    kAMDRyzenSnapshotHighFreq       = 1 << 10, // AMDRyzenSnapshotHighFreq[numLogicalCores], zero if the mode is off
+
+    kAMDRyzenSnapshotAllFields      = (1 << 11) - 1,
+};
+
+typedef struct AMDRyzenSnapshotHeader {
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t totalSize;
+    uint32_t fieldMask;
+
+    uint32_t numPhysCores;
+    uint32_t numLogicalCores;
+    uint32_t numFans;
+    uint32_t numCCDs;
+
+    uint64_t timestampNs;
+} AMDRyzenSnapshotHeader;
+
+typedef struct AMDRyzenSnapshotPackage {
+    float packagePower;
+    float packageTemp;
+    uint32_t PStateCtl;
+    uint32_t reserved;
+} AMDRyzenSnapshotPackage;
+
+typedef struct AMDRyzenSnapshotFan {
+    uint32_t rpm;
+    uint8_t throttle;
+    uint8_t autoControl;
+    uint16_t reserved;
+} AMDRyzenSnapshotFan;
+
+typedef struct AMDRyzenSnapshotSVI {
+    float coreVoltage;
+    float coreCurrent;
+    float corePower;
+    float socVoltage;
+    float socCurrent;
+    float socPower;
+} AMDRyzenSnapshotSVI;
+
+typedef struct AMDRyzenSnapshotHighFreq {
+    uint32_t samples;
+    float freqMin;
+    float freqMax;
+    float freqAvg;
+    float power;
+    uint32_t reserved;
+    uint64_t instructions;
+} AMDRyzenSnapshotHighFreq;
+
+
+static inline uint32_t AMDRyzenSnapshotAlign(uint32_t size){
+    return (size + 7) & ~7U;
+}
+
+static inline uint32_t AMDRyzenSnapshotSectionSize(const AMDRyzenSnapshotHeader *hdr, uint32_t field){
+    switch (field) {
+        case kAMDRyzenSnapshotPackage:      return AMDRyzenSnapshotAlign(sizeof(AMDRyzenSnapshotPackage));
+        case kAMDRyzenSnapshotCoreFreq:     return AMDRyzenSnapshotAlign(hdr->numPhysCores * sizeof(float));
+        case kAMDRyzenSnapshotCoreLoad:     return AMDRyzenSnapshotAlign(hdr->numPhysCores * sizeof(float));
+        case kAMDRyzenSnapshotInstRetired:  return AMDRyzenSnapshotAlign(hdr->numLogicalCores * sizeof(uint64_t));
+        case kAMDRyzenSnapshotPState:       return AMDRyzenSnapshotAlign(hdr->numLogicalCores * sizeof(uint8_t));
+        case kAMDRyzenSnapshotFans:         return AMDRyzenSnapshotAlign(hdr->numFans * sizeof(AMDRyzenSnapshotFan));
+        case kAMDRyzenSnapshotCorePower:    return AMDRyzenSnapshotAlign(hdr->numPhysCores * sizeof(float));
+        case kAMDRyzenSnapshotEnergy:       return (1 + hdr->numPhysCores) * sizeof(double);
+        case kAMDRyzenSnapshotCCDTemp:      return AMDRyzenSnapshotAlign(hdr->numCCDs * sizeof(float));
+        case kAMDRyzenSnapshotSVI:          return AMDRyzenSnapshotAlign(sizeof(AMDRyzenSnapshotSVI));
+        case kAMDRyzenSnapshotHighFreq:     return hdr->numLogicalCores * sizeof(AMDRyzenSnapshotHighFreq);
+        default:                            return 0;
+    }
+}
+
+/**
+ *  Offset of a section from the start of the snapshot, or 0 if the field is not present.
+ */
+static inline uint32_t AMDRyzenSnapshotSectionOffset(const AMDRyzenSnapshotHeader *hdr, uint32_t field){
+    if(!(hdr->fieldMask & field)) return 0;
+
+    uint32_t offset = AMDRyzenSnapshotAlign(hdr->headerSize);
+    for(uint32_t f = 1; f < field; f <<= 1){
+        if(hdr->fieldMask & f) offset += AMDRyzenSnapshotSectionSize(hdr, f);
+    }
+
+    return offset;
+}
+
+static inline uint32_t AMDRyzenSnapshotTotalSize(const AMDRyzenSnapshotHeader *hdr){
+    uint32_t size = AMDRyzenSnapshotAlign(hdr->headerSize);
+    for(uint32_t f = 1; f & kAMDRyzenSnapshotAllFields; f <<= 1){
+        if(hdr->fieldMask & f) size += AMDRyzenSnapshotSectionSize(hdr, f);
+    }
+
+    return size;
+}
+
+/**
+ *  Encoder side: lay out a snapshot for the mask and counts in *counts at buf, with every byte
+ *  not written afterwards zero, padding included. Returns its total size, or 0 if bufSize is
+ *  too small and nothing was written. Sections are then filled through AMDRyzenSnapshotSectionOut.
+ */
+static inline uint32_t AMDRyzenSnapshotBeginEncode(void *buf, uint32_t bufSize, const AMDRyzenSnapshotHeader *counts){
+    AMDRyzenSnapshotHeader hdr = *counts;
+    hdr.version = AMDRYZEN_SNAPSHOT_VERSION;
+    hdr.headerSize = sizeof(AMDRyzenSnapshotHeader);
+    hdr.fieldMask &= kAMDRyzenSnapshotAllFields;
+    hdr.totalSize = AMDRyzenSnapshotTotalSize(&hdr);
+
+    if(bufSize < hdr.totalSize) return 0;
+
+    memset(buf, 0, hdr.totalSize);
+    memcpy(buf, &hdr, sizeof(hdr));
+    return hdr.totalSize;
+}
+
+static inline void *AMDRyzenSnapshotSectionOut(void *buf, uint32_t field){
+    uint32_t offset = AMDRyzenSnapshotSectionOffset((const AMDRyzenSnapshotHeader *)buf, field);
+    return offset ? (uint8_t *)buf + offset : 0;
+}
+
+/**
+ *  Pointer to a section inside a received snapshot, or NULL if it is absent or the buffer is truncated.
+ */
+static inline const void *AMDRyzenSnapshotSection(const void *buf, uint32_t bufSize, uint32_t field){
+    const AMDRyzenSnapshotHeader *hdr = (const AMDRyzenSnapshotHeader *)buf;
+    if(bufSize < sizeof(AMDRyzenSnapshotHeader) || hdr->version != AMDRYZEN_SNAPSHOT_VERSION) return 0;
+
+    uint32_t offset = AMDRyzenSnapshotSectionOffset(hdr, field);
+    if(!offset || offset + AMDRyzenSnapshotSectionSize(hdr, field) > bufSize) return 0;
+
+    return (const uint8_t *)buf + offset;
+}
+
+#endif /* AMDRyzenCPUPMSnapshot_h */
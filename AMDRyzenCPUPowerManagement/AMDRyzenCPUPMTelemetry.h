@@ -0,0 +1,104 @@
+//
+//  AMDRyzenCPUPMTelemetry.h
+//  AMDRyzenCPUPowerManagement
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#ifndef AMDRyzenCPUPMTelemetry_h
+#define AMDRyzenCPUPMTelemetry_h
+
+/**
+ *  Layout of the telemetry ring mapped into clients by clientMemoryForType(kAMDRyzenTelemetryMemoryType).
+ *
+ *  The kext is the only writer and publishes one sample per timer tick. Each record carries its own
+ *  sequence word: 2n+1 while sample n is being written, 2n+2 once it is complete. Readers copy a record
+ *  and accept it only if the sequence word is the expected even value before and after the copy.
+ *
+ *  This header is shared with user space, keep it plain C with fixed size types.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#define kAMDRyzenTelemetryMemoryType 0
+
+#define AMDRYZEN_TELEMETRY_MAGIC 0x524D4C54 // 'TLMR'
+#define AMDRYZEN_TELEMETRY_VERSION 1
+#define AMDRYZEN_TELEMETRY_MAX_CORES 256
+#define AMDRYZEN_TELEMETRY_CAPACITY 32
+
+typedef struct AMDRyzenTelemetrySample {
+    uint64_t seq;
+
+    uint64_t timestampNs;
+    uint64_t instructionDelta;
+
+    float packagePower;
+    float packageTemp;
+    uint32_t PStateCtl;
+    uint32_t numPhysCores;
+
+    float effFreq_perCore[AMDRYZEN_TELEMETRY_MAX_CORES];
+    float load_perCore[AMDRYZEN_TELEMETRY_MAX_CORES];
+} AMDRyzenTelemetrySample;
+
+typedef struct AMDRyzenTelemetryRing {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t capacity;
+
+    //Number of samples published so far, the latest one is head - 1.
+    uint64_t head;
+    uint8_t pad[40];
+
+    AMDRyzenTelemetrySample records[AMDRYZEN_TELEMETRY_CAPACITY];
+} AMDRyzenTelemetryRing;
+
+
+/**
+ *  Writer side, for the kext only: claim the record of sample n, fill it, then publish it.
+ */
+static inline AMDRyzenTelemetrySample *AMDRyzenTelemetryBeginWrite(AMDRyzenTelemetryRing *ring, uint64_t n){
+    AMDRyzenTelemetrySample *rec = &ring->records[n % AMDRYZEN_TELEMETRY_CAPACITY];
+
+    //Mark the record as being written before touching its payload.
+    __atomic_store_n(&rec->seq, 2 * n + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return rec;
+}
+
+static inline void AMDRyzenTelemetryEndWrite(AMDRyzenTelemetryRing *ring, uint64_t n){
+    __atomic_store_n(&ring->records[n % AMDRYZEN_TELEMETRY_CAPACITY].seq, 2 * n + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->head, n + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ *  Copy sample n out of the ring. Returns 0 if it has not been published yet, was overwritten,
+ *  or was being written during the copy.
+ */
+static inline int AMDRyzenTelemetryRead(const AMDRyzenTelemetryRing *ring, uint64_t n,
+                                        AMDRyzenTelemetrySample *out){
+    const AMDRyzenTelemetrySample *rec = &ring->records[n % AMDRYZEN_TELEMETRY_CAPACITY];
+    uint64_t expected = 2 * n + 2;
+
+    if(__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) != expected) return 0;
+    memcpy(out, rec, sizeof(AMDRyzenTelemetrySample));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    return __atomic_load_n(&rec->seq, __ATOMIC_RELAXED) == expected;
+}
+
+/**
+ *  Copy the most recent complete sample. Returns 0 if nothing has been published yet.
+ */
+static inline int AMDRyzenTelemetryReadLatest(const AMDRyzenTelemetryRing *ring, AMDRyzenTelemetrySample *out){
+    for(;;){
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if(!head) return 0;
+        if(AMDRyzenTelemetryRead(ring, head - 1, out)) return 1;
+    }
+}
+
+#endif /* AMDRyzenCPUPMTelemetry_h */
@@ -0,0 +1,55 @@
+//
+//  AMDRyzenCPUPMTrace.h
+//  AMDRyzenCPUPowerManagement
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#ifndef AMDRyzenCPUPMTrace_h
+#define AMDRyzenCPUPMTrace_h
+
+/**
+ *  Records of the idle trace, one per idle period of a CPU.
+ *
+ *  Each CPU owns a ring of AMDRYZEN_TRACE_LEN records and a head counting every record it
+ *  ever wrote, record n lives at n % AMDRYZEN_TRACE_LEN. The read selector returns the first
+ *  index it could copy without it being overwritten, so a reader can tell how much it lost.
+ *
+ *  Next to the trace each CPU keeps log2 histograms of its wake path in TSC ticks,
+ *  bucket b counts values in [2^(b-1), 2^b), the last bucket also takes everything above.
+ *
+ *  Records are copied out as a flat array, so AMDRyzenTraceRecord stays 16 bytes with no implicit
+ *  padding. The read selector reports AMDRYZEN_TRACE_VERSION with every batch, bump it whenever
+ *  a field changes meaning, reason codes are only ever appended.
+ */
+
+#include <stdint.h>
+
+#define AMDRYZEN_TRACE_VERSION 1
+#define AMDRYZEN_TRACE_LEN 512
+
+enum {
+    kAMDRyzenTraceWakeInterrupt     = 0, // Nobody armed the CPU, woken by an interrupt or timer
+    kAMDRyzenTraceWakeArmed         = 1, // pmRyzen_exit_idle wrote the monitored line
+    kAMDRyzenTraceWakeIPI           = 2, // pmRyzen_exit_idle gave up and sent an IPI
+};
+
+#define AMDRYZEN_HIST_BUCKETS 40
+
+enum {
+    kAMDRyzenHistWakeLatency        = 0, // pmRyzen_exit_idle arming the CPU until it runs again
+    kAMDRyzenHistSpin               = 1, // Time the waking CPU spent spinning before return or IPI
+    kAMDRyzenHistIdleResidency      = 2, // Length of each idle period
+    kAMDRyzenHistCount
+};
+
+typedef struct AMDRyzenTraceRecord {
+    uint64_t idleTSC;       // TSC at idle entry
+    uint32_t idleLength;    // TSC ticks spent idle, saturated
+    uint8_t wakeReason;
+    uint8_t PStateBefore;
+    uint8_t PStateAfter;    // P-state after the governor ran on this wake
+    uint8_t reserved;
+} AMDRyzenTraceRecord;
+
+#endif /* AMDRyzenCPUPMTrace_h */
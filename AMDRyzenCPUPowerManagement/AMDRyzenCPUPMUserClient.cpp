@@ -88,6 +88,24 @@ bool AMDRyzenCPUPMUserClient::hasPrivilege(){
     return false;
 }
 
+IOReturn AMDRyzenCPUPMUserClient::clientMemoryForType(UInt32 type, IOOptionBits *options,
+                                                      IOMemoryDescriptor **memory){
+    
+    if(type != kAMDRyzenTelemetryMemoryType)
+        return kIOReturnBadArgument;
+    
+    if(!fProvider || !fProvider->telemetryBuffer)
+        return kIOReturnNoMemory;
+    
+    //Clients only ever read the ring.
+    *options = kIOMapReadOnly;
+    
+    fProvider->telemetryBuffer->retain();
+    *memory = fProvider->telemetryBuffer;
+    
+    return kIOReturnSuccess;
+}
+
 IOReturn AMDRyzenCPUPMUserClient::externalMethod(uint32_t selector, IOExternalMethodArguments *arguments,
                                                  IOExternalMethodDispatch *dispatch,
                                                    OSObject *target, void *reference){
@@ -141,7 +159,7 @@ IOReturn AMDRyzenCPUPMUserClient::externalMethod(uint32_t selector, IOExternalMe
             float *dataOut = (float*) arguments->structureOutput;
 
             for(uint32_t i = 0; i < numPhyCores; i++){
-                dataOut[i] = fProvider->effFreq_perCore[i];
+                dataOut[i] = fProvider->sampler.effFreq_perCore[i];
             }
             
             break;
@@ -173,7 +191,7 @@ IOReturn AMDRyzenCPUPMUserClient::externalMethod(uint32_t selector, IOExternalMe
             dataOut[2] = fProvider->PStateCtl;
             
             for(uint32_t i = 0; i < numPhyCores; i++){
-                dataOut[i + 3] = fProvider->effFreq_perCore[i];
+                dataOut[i + 3] = fProvider->sampler.effFreq_perCore[i];
             }
             
             break;
@@ -190,7 +208,7 @@ IOReturn AMDRyzenCPUPMUserClient::externalMethod(uint32_t selector, IOExternalMe
             dataOut[0] = 0;
             
             for(uint32_t i = 0; i < fProvider->totalNumberOfLogicalCores; i++){
-                dataOut[0] += fProvider->instructionDelta_PerCore[i];
+                dataOut[0] += fProvider->sampler.instructionDelta_PerCore[i];
             }
             
             break;
@@ -408,6 +426,520 @@ IOReturn AMDRyzenCPUPMUserClient::externalMethod(uint32_t selector, IOExternalMe
             break;
         }
         
+        //Get versioned snapshot, see AMDRyzenCPUPMSnapshot.h
+        //Input: [fieldMask], all fields if omitted. Output: [version]
+        case 20: {
+            uint32_t fieldMask = kAMDRyzenSnapshotAllFields;
+            if(arguments->scalarInputCount >= 1)
+                fieldMask = (uint32_t)arguments->scalarInput[0] & kAMDRyzenSnapshotAllFields;
+            
+            arguments->scalarOutputCount = 1;
+            arguments->scalarOutput[0] = AMDRYZEN_SNAPSHOT_VERSION;
+            
+            uint32_t size = fProvider->getSnapshotSize(fieldMask);
+            
+            //Large topologies may not fit in the inline structure buffer.
+            if(arguments->structureOutputDescriptor){
+                if(arguments->structureOutputDescriptor->getLength() < size)
+                    return kIOReturnNoSpace;
+                
+                void *buf = IOMalloc(size);
+                if(!buf)
+                    return kIOReturnNoMemory;
+                
+                //The fan count may change between sizing and encoding, never copy out what was not written.
+                bzero(buf, size);
+                uint32_t written = fProvider->encodeSnapshot(buf, size, fieldMask);
+                if(written)
+                    arguments->structureOutputDescriptor->writeBytes(0, buf, written);
+                arguments->structureOutputDescriptorSize = written;
+                IOFree(buf, size);
+                
+                if(!written)
+                    return kIOReturnNoSpace;
+                break;
+            }
+            
+            if(arguments->structureOutputSize < size)
+                return kIOReturnNoSpace;
+            
+            arguments->structureOutputSize = fProvider->encodeSnapshot(arguments->structureOutput, size, fieldMask);
+            if(!arguments->structureOutputSize)
+                return kIOReturnNoSpace;
+            break;
+        }
+        
+        //Get per core power
+        case 21: {
+            uint32_t numPhyCores = fProvider->totalNumberOfPhysicalCores;
+            
+            arguments->scalarOutputCount = 1;
+            arguments->scalarOutput[0] = numPhyCores;
+            
+            arguments->structureOutputSize = numPhyCores * sizeof(float);
+            
+            float *dataOut = (float*) arguments->structureOutput;
+            
+            for(uint32_t i = 0; i < numPhyCores; i++){
+                dataOut[i] = fProvider->sampler.corePower_perCore[i];
+            }
+            
+            break;
+        }
+        
+        //Get cumulative energy in Joules since service start: [package, core_1, 2, 3 .....]
+        case 22: {
+            uint32_t numPhyCores = fProvider->totalNumberOfPhysicalCores;
+            
+            arguments->scalarOutputCount = 1;
+            arguments->scalarOutput[0] = numPhyCores;
+            
+            arguments->structureOutputSize = (numPhyCores + 1) * sizeof(double);
+            
+            double *dataOut = (double*) arguments->structureOutput;
+            
+            dataOut[0] = fProvider->getEnergyJoules(fProvider->packageEnergy.acc);
+            for(uint32_t i = 0; i < numPhyCores; i++){
+                dataOut[i + 1] = fProvider->getEnergyJoules(fProvider->sampler.coreEnergy_perCore[i].acc);
+            }
+            
+            break;
+        }
+        
+        //Get per CCD temperature
+        case 23: {
+            uint32_t numCCDs = fProvider->numberOfCCDs;
+            
+            arguments->scalarOutputCount = 1;
+            arguments->scalarOutput[0] = numCCDs;
+            
+            arguments->structureOutputSize = numCCDs * sizeof(float);
+            
+            float *dataOut = (float*) arguments->structureOutput;
+            
+            for(uint32_t i = 0; i < numCCDs; i++){
+                dataOut[i] = fProvider->CCD_TEMPERATURE_perCCD[i];
+            }
+            
+            break;
+        }
+        
+        //Get SVI2 telemetry: [core V, core A, core W, SoC V, SoC A, SoC W]
+        case 24: {
+            uint32_t core = AMDRyzenCPUPowerManagement::kSVIPlaneCore;
+            uint32_t soc = AMDRyzenCPUPowerManagement::kSVIPlaneSoC;
+            
+            arguments->scalarOutputCount = 1;
+            arguments->scalarOutput[0] = fProvider->sviSupported ? 1 : 0;
+            
+            arguments->structureOutputSize = 6 * sizeof(float);
+            
+            float *dataOut = (float*) arguments->structureOutput;
+            
+            dataOut[0] = fProvider->SVI_VOLTAGE_perPlane[core];
+            dataOut[1] = fProvider->SVI_CURRENT_perPlane[core];
+            dataOut[2] = fProvider->SVI_POWER_perPlane[core];
+            dataOut[3] = fProvider->SVI_VOLTAGE_perPlane[soc];
+            dataOut[4] = fProvider->SVI_CURRENT_perPlane[soc];
+            dataOut[5] = fProvider->SVI_POWER_perPlane[soc];
+            
+            break;
+        }
+        
+        //Set PMU events: [event_slot_0, 1, ... 5], (unitMask << 16) | eventSelect, 0 frees a slot.
+        //No input loads the default preset.
+        case 25: {
+            arguments->scalarOutputCount = 0;
+            arguments->structureOutputSize = 0;
+            
+            if(!hasPrivilege())
+                return kIOReturnNotPrivileged;
+            
+            if(arguments->scalarInputCount > AMDRyzenCPUPowerManagement::kPMCMaxCounters)
+                return kIOReturnBadArgument;
+            
+            if(arguments->scalarInputCount)
+                fProvider->setPMCEvents(arguments->scalarInput, arguments->scalarInputCount);
+            else
+                fProvider->setPMCEvents(nullptr, 0);
+            
+            break;
+        }
+        
+        //Get PMU rate per logical core for one slot, events per second
+        //Input: [slot]. Output: [event, numLogicalCores]
+        case 26: {
+            if(arguments->scalarInputCount != 1)
+                return kIOReturnBadArgument;
+            
+            uint32_t slot = (uint32_t)arguments->scalarInput[0];
+            if(slot >= AMDRyzenCPUPowerManagement::kPMCMaxCounters)
+                return kIOReturnBadArgument;
+            
+            uint32_t numLogCores = fProvider->totalNumberOfLogicalCores;
+            
+            arguments->scalarOutputCount = 2;
+            arguments->scalarOutput[0] = fProvider->sampler.pmcEvents[slot];
+            arguments->scalarOutput[1] = numLogCores;
+            
+            arguments->structureOutputSize = numLogCores * sizeof(float);
+            
+            float *dataOut = (float*) arguments->structureOutput;
+            
+            for(uint32_t i = 0; i < numLogCores; i++){
+                dataOut[i] = fProvider->getPMCRate(i, slot);
+            }
+            
+            break;
+        }
+        
+        //Set high frequency sampling interval in microseconds, 0 turns it off.
+        case 27: {
+            arguments->scalarOutputCount = 0;
+            arguments->structureOutputSize = 0;
+            
+            if(!hasPrivilege())
+                return kIOReturnNotPrivileged;
+            
+            if(arguments->scalarInputCount != 1)
+                return kIOReturnBadArgument;
+            
+            //Anything below 100us would spend more time sampling than running.
+            uint64_t us = arguments->scalarInput[0];
+            if(us && us < 100)
+                return kIOReturnBadArgument;
+            
+            fProvider->setHighFrequencySampling((uint32_t)min(us, (uint64_t)1000000));
+            
+            break;
+        }
+        
+        //Get high frequency sampling aggregates since last tick, per logical core:
+        //[samples, min MHz, max MHz, avg MHz, ...]. Output: [interval us, numLogicalCores]
+        case 28: {
+            uint32_t numLogCores = fProvider->totalNumberOfLogicalCores;
+            
+            arguments->scalarOutputCount = 2;
+            arguments->scalarOutput[0] = fProvider->hfIntervalUs;
+            arguments->scalarOutput[1] = numLogCores;
+            
+            arguments->structureOutputSize = numLogCores * 4 * sizeof(float);
+            
+            float *dataOut = (float*) arguments->structureOutput;
+            
+            for(uint32_t i = 0; i < numLogCores; i++){
+                dataOut[i * 4] = fProvider->hfSamples_perCore[i];
+                dataOut[i * 4 + 1] = fProvider->hfFreqMin_perCore[i];
+                dataOut[i * 4 + 2] = fProvider->hfFreqMax_perCore[i];
+                dataOut[i * 4 + 3] = fProvider->hfFreqAvg_perCore[i];
+            }
+            
+            break;
+        }
+        
+        //Get P-state governor: Output: [governor, number of governors], name as string
+        case 29: {
+            arguments->scalarOutputCount = 2;
+            arguments->scalarOutput[0] = pmRyzen_governor;
+            arguments->scalarOutput[1] = PMRYZEN_GOV_COUNT;
+            
+            const char *name = pmRyzen_governor_name(pmRyzen_governor);
+            arguments->structureOutputSize = (uint32_t)strlen(name) + 1;
+            
+            char *dataOut = (char*) arguments->structureOutput;
+            strlcpy(dataOut, name, arguments->structureOutputSize);
+            
+            break;
+        }
+        
+        //Set P-state governor, see PMRYZEN_GOV_*
+        case 30: {
+            arguments->scalarOutputCount = 0;
+            arguments->structureOutputSize = 0;
+            
+            if(!hasPrivilege())
+                return kIOReturnNotPrivileged;
+            
+            if(arguments->scalarInputCount != 1)
+                return kIOReturnBadArgument;
+            
+            if(!pmRyzen_set_governor((uint32_t)arguments->scalarInput[0]))
+                return kIOReturnBadArgument;
+            
+            break;
+        }
+        
+        //Enable or disable the idle trace, see AMDRyzenCPUPMTrace.h
+        case 31: {
+            arguments->scalarOutputCount = 0;
+            arguments->structureOutputSize = 0;
+            
+            if(!hasPrivilege())
+                return kIOReturnNotPrivileged;
+            
+            if(arguments->scalarInputCount != 1)
+                return kIOReturnBadArgument;
+            
+            if(!pmRyzen_trace_enable(arguments->scalarInput[0] == 1))
+                return kIOReturnNoMemory;
+            
+            break;
+        }
+        
+        //Read idle trace records of one CPU starting at an index
+        //Input: [cpu, from]. Output: [first index returned, count, version], AMDRyzenTraceRecord[count]
+        case 32: {
+            if(arguments->scalarInputCount != 2)
+                return kIOReturnBadArgument;
+            
+            uint32_t cpu = (uint32_t)arguments->scalarInput[0];
+            if(cpu >= fProvider->totalNumberOfLogicalCores)
+                return kIOReturnBadArgument;
+            
+            uint32_t count = 0;
+            uint32_t max = arguments->structureOutputSize / sizeof(AMDRyzenTraceRecord);
+            
+            AMDRyzenTraceRecord *dataOut = (AMDRyzenTraceRecord*) arguments->structureOutput;
+            uint64_t first = pmRyzen_trace_read(cpu, arguments->scalarInput[1], dataOut, max, &count);
+            
+            arguments->scalarOutputCount = 3;
+            arguments->scalarOutput[0] = first;
+            arguments->scalarOutput[1] = count;
+            arguments->scalarOutput[2] = AMDRYZEN_TRACE_VERSION;
+            
+            arguments->structureOutputSize = count * sizeof(AMDRyzenTraceRecord);
+            
+            break;
+        }
+        
+        //Get idle governor statistics: [hpcpus, idle, exit_idle, exit_idle_ipi, false_wake]
+        case 33: {
+            arguments->scalarOutputCount = 0;
+            
+            arguments->structureOutputSize = 5 * sizeof(uint64_t);
+            
+            uint64_t *dataOut = (uint64_t*) arguments->structureOutput;
+            
+            pmRyzenStats_t stats;
+            pmRyzen_get_stats(&stats);
+            
+            dataOut[0] = stats.hpcpus;
+            dataOut[1] = stats.idle;
+            dataOut[2] = stats.exit_idle;
+            dataOut[3] = stats.exit_idle_ipi;
+            dataOut[4] = stats.false_wake;
+            
+            break;
+        }
+        
+        //Read a wake path histogram, see AMDRyzenCPUPMTrace.h
+        //Input: [cpu or -1 for all, kind]. Output: [TSC frequency], uint64_t[AMDRYZEN_HIST_BUCKETS]
+        case 34: {
+            if(arguments->scalarInputCount != 2)
+                return kIOReturnBadArgument;
+            
+            uint32_t cpu = (uint32_t)arguments->scalarInput[0];
+            if(cpu != (uint32_t)-1 && cpu >= fProvider->totalNumberOfLogicalCores)
+                return kIOReturnBadArgument;
+            
+            arguments->scalarOutputCount = 1;
+            arguments->scalarOutput[0] = pmRyzen_tsc_freq;
+            
+            arguments->structureOutputSize = AMDRYZEN_HIST_BUCKETS * sizeof(uint64_t);
+            
+            if(!pmRyzen_hist_read(cpu, (uint32_t)arguments->scalarInput[1], (uint64_t*)arguments->structureOutput))
+                return kIOReturnBadArgument;
+            
+            break;
+        }
+        
+        //Pin logical CPUs to a P-state, 0xff hands them back to the governor
+        //Input: [state, cpu mask word 0, 1, ...], bit n of word w is cpu 64 * w + n
+        case 35: {
+            arguments->scalarOutputCount = 0;
+            arguments->structureOutputSize = 0;
+            
+            if(!hasPrivilege())
+                return kIOReturnNotPrivileged;
+            
+            if(arguments->scalarInputCount < 2 ||
+               arguments->scalarInputCount > 1 + AMDRyzenCPUPowerManagement::kCPUMaskWords)
+                return kIOReturnBadArgument;
+            
+            uint8_t state = (uint8_t)arguments->scalarInput[0];
+            if(state != AMDRyzenCPUPowerManagement::kPStateUnpinned && state >= fProvider->PStateEnabledLen)
+                return kIOReturnBadArgument;
+            
+            uint64_t mask[AMDRyzenCPUPowerManagement::kCPUMaskWords] {};
+            for(uint32_t i = 1; i < arguments->scalarInputCount; i++){
+                mask[i - 1] = arguments->scalarInput[i];
+            }
+            
+            fProvider->setPStateTargets(mask, state);
+            break;
+        }
+        
+        //Pin every logical CPU of a set of CCXs to a P-state, 0xff hands them back to the governor
+        //Input: [state, ccx mask]
+        case 36: {
+            arguments->scalarOutputCount = 0;
+            arguments->structureOutputSize = 0;
+            
+            if(!hasPrivilege())
+                return kIOReturnNotPrivileged;
+            
+            if(arguments->scalarInputCount != 2)
+                return kIOReturnBadArgument;
+            
+            uint8_t state = (uint8_t)arguments->scalarInput[0];
+            if(state != AMDRyzenCPUPowerManagement::kPStateUnpinned && state >= fProvider->PStateEnabledLen)
+                return kIOReturnBadArgument;
+            
+            fProvider->setCCXPStateTargets(arguments->scalarInput[1], state);
+            break;
+        }
+        
+        //Get per CPU P-state pins and CCX numbers
+        //Output: [numCCX], uint8_t[numLogicalCores] pins, uint8_t[numLogicalCores] CCX
+        case 37: {
+            uint32_t numLogCores = fProvider->totalNumberOfLogicalCores;
+            
+            arguments->scalarOutputCount = 1;
+            arguments->scalarOutput[0] = pmRyzen_num_ccx;
+            
+            arguments->structureOutputSize = 2 * numLogCores;
+            
+            uint8_t *dataOut = (uint8_t*) arguments->structureOutput;
+            
+            for(uint32_t i = 0; i < numLogCores; i++){
+                dataOut[i] = fProvider->PStateCtl_perCore[i];
+                dataOut[numLogCores + i] = (uint8_t)pmRyzen_get_processor(i)->ccx;
+            }
+            
+            break;
+        }
+        
+        //Get fans as last sampled by the timer
+        //Output: [sample time ns, numFans], AMDRyzenSnapshotFan[numFans]
+        case 38: {
+            if(!fProvider->superIO)
+                return kIOReturnNoDevice;
+            
+            int numFans = fProvider->superIO->getNumberOfFans();
+            
+            arguments->scalarOutputCount = 2;
+            arguments->scalarOutput[0] = fProvider->fanSampleTimeNs;
+            arguments->scalarOutput[1] = numFans;
+            
+            arguments->structureOutputSize = numFans * sizeof(AMDRyzenSnapshotFan);
+            
+            AMDRyzenSnapshotFan *dataOut = (AMDRyzenSnapshotFan*) arguments->structureOutput;
+            
+            for (int i = 0; i < numFans; i++) {
+                dataOut[i].rpm = fProvider->superIO->getRPMForFan(i);
+                dataOut[i].throttle = fProvider->superIO->getFanThrottle(i);
+                dataOut[i].autoControl = fProvider->superIO->getFanAutoControlMode(i) ? 1 : 0;
+                dataOut[i].reserved = 0;
+            }
+            
+            break;
+        }
+        
+        //Set the fan curve of one fan, see AMDRyzenCPUPMFanCurve.h
+        //Input: [fan], AMDRyzenFanCurve
+        case 39: {
+            arguments->scalarOutputCount = 0;
+            arguments->structureOutputSize = 0;
+            
+            if(!fProvider->superIO)
+                return kIOReturnNoDevice;
+            
+            if(!hasPrivilege())
+                return kIOReturnNotPrivileged;
+            
+            if(arguments->scalarInputCount != 1 || arguments->structureInputSize != sizeof(AMDRyzenFanCurve))
+                return kIOReturnBadArgument;
+            
+            if(!fProvider->setFanCurve((int)arguments->scalarInput[0], (const AMDRyzenFanCurve*)arguments->structureInput))
+                return kIOReturnBadArgument;
+            
+            break;
+        }
+        
+        //Get the fan curve of one fan
+        //Input: [fan]. Output: [last PWM written by the curve or -1], AMDRyzenFanCurve
+        case 40: {
+            if(arguments->scalarInputCount != 1)
+                return kIOReturnBadArgument;
+            
+            int pwm = -1;
+            if(!fProvider->getFanCurve((int)arguments->scalarInput[0], (AMDRyzenFanCurve*)arguments->structureOutput, &pwm))
+                return kIOReturnBadArgument;
+            
+            arguments->scalarOutputCount = 1;
+            arguments->scalarOutput[0] = (uint64_t)(int64_t)pwm;
+            
+            arguments->structureOutputSize = sizeof(AMDRyzenFanCurve);
+            
+            break;
+        }
+        
+        //Get SuperIO voltages and temperatures as last sampled by the timer
+        //Output: [sample time ns, numVoltages, numTemperatures], float[numVoltages] Volts, float[numTemperatures] Celsius
+        case 41: {
+            if(!fProvider->superIO)
+                return kIOReturnNoDevice;
+            
+            int numVoltages = fProvider->superIO->getNumberOfVoltages();
+            int numTemps = fProvider->superIO->getNumberOfTemperatures();
+            
+            arguments->scalarOutputCount = 3;
+            arguments->scalarOutput[0] = fProvider->fanSampleTimeNs;
+            arguments->scalarOutput[1] = numVoltages;
+            arguments->scalarOutput[2] = numTemps;
+            
+            arguments->structureOutputSize = (numVoltages + numTemps) * sizeof(float);
+            
+            float *dataOut = (float*) arguments->structureOutput;
+            
+            for (int i = 0; i < numVoltages; i++) {
+                dataOut[i] = fProvider->superIO->getVoltage(i);
+            }
+            
+            for (int i = 0; i < numTemps; i++) {
+                dataOut[numVoltages + i] = fProvider->superIO->getTemperature(i);
+            }
+            
+            break;
+        }
+        
+        //Get readable desc for a SuperIO sensor
+        //Input: [0 for voltage 1 for temperature, index]. Output: string
+        case 42: {
+            if(!fProvider->superIO)
+                return kIOReturnNoDevice;
+            
+            arguments->scalarOutputCount = 0;
+            
+            if(arguments->scalarInputCount != 2)
+                return kIOReturnBadArgument;
+            
+            int idx = (int)arguments->scalarInput[1];
+            const char *str = arguments->scalarInput[0] ?
+                fProvider->superIO->getReadableStringForTemperature(idx) :
+                fProvider->superIO->getReadableStringForVoltage(idx);
+            
+            if(!str)
+                return kIOReturnBadArgument;
+            
+            arguments->structureOutputSize = (uint32_t)strlen(str);
+            
+            char *dataOut = (char*) arguments->structureOutput;
+            strcpy(dataOut, str, strlen(str));
+            
+            break;
+        }
+        
         //Try load SMC driver
         case 90: {
             
@@ -474,7 +1006,6 @@ IOReturn AMDRyzenCPUPMUserClient::externalMethod(uint32_t selector, IOExternalMe
             arguments->structureOutputSize = fProvider->superIO->getNumberOfFans() * sizeof(uint64_t);
             uint64_t *dataOut = (uint64_t*) arguments->structureOutput;
             
-            fProvider->superIO->updateFanRPMS();
             for (int i = 0; i < fProvider->superIO->getNumberOfFans(); i++) {
                 dataOut[i] = fProvider->superIO->getRPMForFan(i);
             }
@@ -496,7 +1027,6 @@ IOReturn AMDRyzenCPUPMUserClient::externalMethod(uint32_t selector, IOExternalMe
             arguments->structureOutputSize = fProvider->superIO->getNumberOfFans() * sizeof(uint64_t);
             uint64_t *dataOut = (uint64_t*) arguments->structureOutput;
             
-            fProvider->superIO->updateFanControl();
             for (int i = 0; i < fProvider->superIO->getNumberOfFans(); i++) {
                 dataOut[i] = fProvider->superIO->getFanThrottle(i) << 8 | (fProvider->superIO->getFanAutoControlMode(i) ? 1 : 0);
             }
@@ -518,7 +1048,7 @@ IOReturn AMDRyzenCPUPMUserClient::externalMethod(uint32_t selector, IOExternalMe
             int fanSel = (int)arguments->scalarInput[0];
             uint8_t pwm = (uint8_t)arguments->scalarInput[1];
             
-            fProvider->superIO->overrideFanControl(fanSel, pwm);
+            fProvider->overrideFanControl(fanSel, pwm);
             
             break;
         }
@@ -536,7 +1066,7 @@ IOReturn AMDRyzenCPUPMUserClient::externalMethod(uint32_t selector, IOExternalMe
             
             int fanSel = (int)arguments->scalarInput[0];
             
-            fProvider->superIO->setDefaultFanControl(fanSel);
+            fProvider->setDefaultFanControl(fanSel);
             
             break;
         }
@@ -555,9 +1085,9 @@ IOReturn AMDRyzenCPUPMUserClient::externalMethod(uint32_t selector, IOExternalMe
             int numFan = fProvider->superIO->getNumberOfFans();
             for (int i = 0; i < numFan; i++) {
                 if(arguments->scalarInput[0])
-                    fProvider->superIO->overrideFanControl(i, 0xff);
+                    fProvider->overrideFanControl(i, 0xff);
                 else
-                    fProvider->superIO->setDefaultFanControl(i);
+                    fProvider->setDefaultFanControl(i);
             }
             
             break;
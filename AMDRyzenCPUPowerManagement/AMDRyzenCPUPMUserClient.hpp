@@ -55,6 +55,9 @@ protected:
     virtual IOReturn externalMethod(uint32_t selector, IOExternalMethodArguments* arguments,
                                     IOExternalMethodDispatch* dispatch, OSObject* target, void* reference) override;
     
+    // Map the telemetry sample ring into the client.
+    virtual IOReturn clientMemoryForType(UInt32 type, IOOptionBits *options, IOMemoryDescriptor **memory) override;
+    
     
     char taskProcessBinaryName[32]{};
 };
@@ -3,6 +3,36 @@
 
 OSDefineMetaClassAndStructors(AMDRyzenCPUPowerManagement, IOService);
 
+/**
+ * Tccd register base per model: https://github.com/torvalds/linux/blob/master/drivers/hwmon/k10temp.c
+ */
+#define CCD_TEMP_TABLE_LEN 4
+static constexpr const struct ccd_temp_base {
+    uint8_t family;
+    uint8_t modelFirst;
+    uint8_t modelLast;
+    uint32_t base;
+} ccd_temp_table[] = {
+    { 0x17, 0x31, 0x31, 0x00059954 }, /* Zen 2 Threadripper/EPYC */
+    { 0x17, 0x71, 0x71, 0x00059954 }, /* Zen 2 Matisse */
+    { 0x19, 0x00, 0x01, 0x00059954 }, /* Zen 3 Milan */
+    { 0x19, 0x21, 0x21, 0x00059954 }, /* Zen 3 Vermeer */
+};
+
+static constexpr const AMDRyzenFanCurve kFanCurveDisabled = { AMDRYZEN_FANCURVE_VERSION };
+
+/**
+ * Default PMU preset, events from Processor Programming Reference for AMD 17h CPU.
+ */
+#define PMC_DEFAULT_EVENTS_LEN 5
+static constexpr const uint32_t pmc_default_events[] = {
+    0x000076, /* Cycles not in halt */
+    0x0000c0, /* Retired instructions */
+    0x0000c3, /* Retired branch mispredicts */
+    0x090064, /* L2 cache misses from DC and IC */
+    0x480043, /* Demand DC fills from DRAM or another die, stands in for L3 misses */
+};
+
 #define TCTL_OFFSET_TABLE_LEN 6
 static constexpr const struct tctl_offset tctl_offset_table[] = {
     { 0x17, "AMD Ryzen 5 1600X", 20 },
@@ -94,7 +124,7 @@ void AMDRyzenCPUPowerManagement::startWorkLoop() {
             IOLog("AMDCPUSupport::startWorkLoop initialize service");
             
             //Disable interrupts and sync all processor cores.
-            mp_rendezvous_no_intrs([](void *obj) {
+            provider->hardware->rendezvousNoIntrs([](void *obj) {
                 auto provider = static_cast<AMDRyzenCPUPowerManagement*>(obj);
                 
                 provider->write_msr(kMSR_CSTATE_ADDR, 0xf0);
@@ -114,7 +144,7 @@ void AMDRyzenCPUPowerManagement::startWorkLoop() {
                 provider->write_msr(kMSR_HWCR, hwConfig);
 
 
-                uint32_t cpu_num = cpu_number();
+                uint32_t cpu_num = provider->hardware->cpuNumber();
 
                 //Read PStateDef generated by EFI.
                 if(pmRyzen_cpu_is_master(cpu_num))
@@ -122,17 +152,13 @@ void AMDRyzenCPUPowerManagement::startWorkLoop() {
 
 
                 if(!pmRyzen_cpu_primary_in_core(cpu_num)) return;
-                uint8_t physical = pmRyzen_cpu_phys_num(cpu_num);
+                uint32_t physical = pmRyzen_cpu_phys_num(cpu_num);
 
 
-                //Init performance frequency counter.
-                uint64_t APERF, MPERF;
-                if(!provider->read_msr(kMSR_APERF, &APERF) || !provider->read_msr(kMSR_MPERF, &MPERF))
+                //Init performance frequency and core energy counters.
+                if(!provider->sampler.primeCore(physical))
                     panic("AMDCPUSupport::startWorkLoop: wtf?");
 
-                provider->lastAPERF_PerCore[physical] = APERF;
-                provider->lastMPERF_PerCore[physical] = MPERF;
-
             }, provider);
             
             //Make all cores P0 state by default.
@@ -144,25 +170,33 @@ void AMDRyzenCPUPowerManagement::startWorkLoop() {
         }
         
         
-        mp_rendezvous_no_intrs([](void *obj) {
+        provider->applyPMCConfig();
+        
+        provider->hardware->rendezvousNoIntrs([](void *obj) {
             auto provider = static_cast<AMDRyzenCPUPowerManagement*>(obj);
-            uint32_t cpu_num = cpu_number();
+            uint32_t cpu_num = provider->hardware->cpuNumber();
             
-            provider->updateInstructionDelta(cpu_num);
+            provider->sampler.updateInstructionDelta(cpu_num);
+            provider->sampler.updatePMC(cpu_num);
             
             // Ignore hyper-threaded cores
             if(!pmRyzen_cpu_primary_in_core(cpu_num)) return;
-            uint8_t physical = pmRyzen_cpu_phys_num(cpu_num);
+            uint32_t physical = pmRyzen_cpu_phys_num(cpu_num);
 
 
-            provider->calculateEffectiveFrequency(physical);
+            provider->sampler.calculateEffectiveFrequency(physical, provider->PStateDefClock_perCore[0]);
+            provider->sampler.updateCoreEnergy(physical);
 
         }, provider);
         
         //Read stats from package.
         provider->updatePackageTemp();
+        provider->updateSVITelemetry();
+        provider->drainHighFrequencySamples();
         provider->updatePackageEnergy();
-//        if(provider->superIO) provider->superIO->updateFanControl();
+        provider->publishTelemetry();
+        provider->sampleFans(false);
+        provider->updateFanCurves();
 //        IOLog("exit idle: %llu, ipi: %llu, diff %llu, false %llu\n", pmRyzen_exit_idle_c, pmRyzen_exit_idle_ipi_c, pmRyzen_exit_idle_c - pmRyzen_exit_idle_ipi_c, pmRyzen_exit_idle_false_c);
 //        pmRyzen_exit_idle_c = 0; pmRyzen_exit_idle_ipi_c = 0; pmRyzen_exit_idle_false_c = 0;
 //
@@ -193,7 +227,23 @@ void AMDRyzenCPUPowerManagement::startWorkLoop() {
     registerService();
     
     lastUpdateTime = getCurrentTimeNs();
-    pwrLastTSC = rdtsc64();
+    
+    //Firmware may have moved the SMN index while asleep.
+    IOLockLock(smnLock);
+    smn.invalidate();
+    IOLockUnlock(smnLock);
+    
+    //PMU state is lost across sleep. A new pending generation makes the next tick latch the
+    //same events again under a generation no CPU has applied, so every CPU reprograms them.
+    IOLockLock(pmcLock);
+    if(sampler.pmcActive) pmcPendingGen++;
+    IOLockUnlock(pmcLock);
+    
+    //Counters may have been reset while asleep, resync before the first tick.
+    uint64_t pkgEnergy = 0;
+    read_msr(kMSR_PKG_ENERGY_STAT, &pkgEnergy);
+    packageEnergy.last = (uint32_t)pkgEnergy;
+    pwrLastTSC = hardware->readTSC();
     workLoop->addEventSource(timerEventSource);
     timerEventSource->setTimeoutMS(1);
 }
@@ -233,7 +283,7 @@ bool AMDRyzenCPUPowerManagement::start(IOService *provider){
     
     CPUInfo::getCpuid(1, 0, &cpuid_eax, &cpuid_ebx, &cpuid_ecx, &cpuid_edx);
     cpuFamily = ((cpuid_eax >> 20) & 0xff) + ((cpuid_eax >> 8) & 0xf);
-    cpuModel = ((cpuid_eax >> 16) & 0xf) + ((cpuid_eax >> 4) & 0xf);
+    cpuModel = (((cpuid_eax >> 16) & 0xf) << 4) | ((cpuid_eax >> 4) & 0xf);
     
     //Only 17h Family are supported offically by now.
     cpuSupportedByCurrentVersion = (cpuFamily == 0x17)? 1 : 0;
@@ -277,14 +327,21 @@ bool AMDRyzenCPUPowerManagement::start(IOService *provider){
         }
     }
     
-    uint64_t rapl = 0;
-    if(!read_msr(kMSR_RAPL_PWR_UNIT, &rapl))
-        panic("AMDCPUSupport: unable to read power unit\n");
+    for(int i = 0; i < CCD_TEMP_TABLE_LEN; i++){
+        auto ct = ccd_temp_table + i;
+        if(cpuFamily == ct->family && cpuModel >= ct->modelFirst && cpuModel <= ct->modelLast){
+            ccdTempBase = ct->base;
+            break;
+        }
+    }
     
-    pwrTimeUnit = pow((double)0.5, (double)((rapl >> 16) & 0xf));
-    pwrEnergyUnit = pow((double)0.5, (double)((rapl >> 8) & 0x1f));
-    IOLog("a %lld\n", (long long)(pwrTimeUnit * 10000000000));
-    IOLog("b %lld\n", (long long)(pwrEnergyUnit * 10000000000));
+    if(auto sp = svi_plane_lookup(cpuFamily, cpuModel)){
+        sviRegs[kSVIPlaneCore] = k17H_M01H_SVI + sp->coreOffset;
+        sviRegs[kSVIPlaneSoC] = k17H_M01H_SVI + sp->socOffset;
+        sviCurrentScale[kSVIPlaneCore] = sp->coreCurrentScale;
+        sviCurrentScale[kSVIPlaneSoC] = sp->socCurrentScale;
+        sviSupported = true;
+    }
     
     fetchOEMBaseBoardInfo();
     
@@ -330,13 +387,70 @@ bool AMDRyzenCPUPowerManagement::start(IOService *provider){
         return false;
     }
     
-    pmRyzen_init(this);
+    auto mp_cpus_call = (AMDRyzenCPUNativeHardware::mp_cpus_call_t)lookup_symbol("_mp_cpus_call");
+    if(!mp_cpus_call)
+        IOLog("AMDCPUSupport::start WARN: Can't find _mp_cpus_call, cross-calls will use rendezvous\n");
     
+    hardware = new AMDRyzenCPUNativeHardware(fIOPCIDevice, wrmsr_carefully, mp_cpus_call);
+    AMDRyzenCPUHardware::setShared(hardware);
+    smn.setHardware(hardware);
+    smnLock = IOLockAlloc();
+    pmcLock = IOLockAlloc();
+    superIOLock = IOLockAlloc();
+    
+    uint64_t rapl = 0;
+    if(!read_msr(kMSR_RAPL_PWR_UNIT, &rapl))
+        panic("AMDCPUSupport: unable to read power unit\n");
+    
+    pwrTimeUnit = pow((double)0.5, (double)((rapl >> 16) & 0xf));
+    pwrEnergyUnit = pow((double)0.5, (double)((rapl >> 8) & 0x1f));
+    IOLog("a %lld\n", (long long)(pwrTimeUnit * 10000000000));
+    IOLog("b %lld\n", (long long)(pwrEnergyUnit * 10000000000));
+    sampler.configure(hardware, xnuTSCFreq, pwrEnergyUnit);
+    
+    memset(PStateCtl_perCore, kPStateUnpinned, sizeof(PStateCtl_perCore));
+    
+    //Every per CPU array below is sized CPUInfo::MaxCpus.
+    if(!pmRyzen_init(this, CPUInfo::MaxCpus)){
+        IOLog("AMDCPUSupport::start unable to set up per CPU state, failing...\n");
+        IOLockFree(superIOLock);
+        IOLockFree(pmcLock);
+        IOLockFree(smnLock);
+        superIOLock = pmcLock = smnLock = nullptr;
+        AMDRyzenCPUHardware::setShared(nullptr);
+        delete hardware;
+        hardware = nullptr;
+        return false;
+    }
+    
+    totalNumberOfPackages = pmRyzen_num_pkgs;
     totalNumberOfLogicalCores = pmRyzen_num_logi;
     totalNumberOfPhysicalCores = pmRyzen_num_phys;
     
-    IOLog("AMDCPUSupport::start, Physical Count: %u, Logical Count %u.\n",
-              totalNumberOfPhysicalCores, totalNumberOfLogicalCores);
+    IOLog("AMDCPUSupport::start, Package Count: %u, Physical Count: %u, Logical Count %u.\n",
+              totalNumberOfPackages, totalNumberOfPhysicalCores, totalNumberOfLogicalCores);
+    
+    probeCCDs();
+    
+    telemetryBuffer = IOBufferMemoryDescriptor::withOptions(kIODirectionInOut | kIOMemoryKernelUserShared,
+                                                            sizeof(AMDRyzenTelemetryRing), page_size);
+    if(telemetryBuffer){
+        telemetryRing = (AMDRyzenTelemetryRing*)telemetryBuffer->getBytesNoCopy();
+        bzero(telemetryRing, sizeof(AMDRyzenTelemetryRing));
+        telemetryRing->magic = AMDRYZEN_TELEMETRY_MAGIC;
+        telemetryRing->version = AMDRYZEN_TELEMETRY_VERSION;
+        telemetryRing->recordSize = sizeof(AMDRyzenTelemetrySample);
+        telemetryRing->capacity = AMDRYZEN_TELEMETRY_CAPACITY;
+    } else {
+        IOLog("AMDCPUSupport::start WARN: unable to allocate telemetry buffer.\n");
+    }
+    
+    //SuperIO is otherwise only probed when a user client asks for it.
+    //-amdpsuperio probes it now so the VirtualSMC plugin can publish its sensors.
+    if(checkKernelArgument("-amdpsuperio")){
+        uint16_t chipIntel;
+        initSuperIO(&chipIntel);
+    }
     
     workLoop = IOWorkLoop::workLoop();
     startWorkLoop();
@@ -356,6 +470,9 @@ void AMDRyzenCPUPowerManagement::stop(IOService *provider){
     
     stopWorkLoop();
     
+    //pmRyzen_stop has drained every CPU out of the idle and context switch callbacks.
+    pmRyzen_free();
+    
     if(superIO){
         for (int i = 0; i < superIO->getNumberOfFans(); i++) {
             superIO->setDefaultFanControl(i);
@@ -363,6 +480,31 @@ void AMDRyzenCPUPowerManagement::stop(IOService *provider){
 
         delete superIO;
     }
+    
+    if(telemetryBuffer){
+        telemetryBuffer->release();
+        telemetryBuffer = nullptr;
+        telemetryRing = nullptr;
+    }
+    
+    if(smnLock){
+        IOLockFree(smnLock);
+        smnLock = nullptr;
+    }
+    
+    if(pmcLock){
+        IOLockFree(pmcLock);
+        pmcLock = nullptr;
+    }
+    
+    if(superIOLock){
+        IOLockFree(superIOLock);
+        superIOLock = nullptr;
+    }
+    
+    AMDRyzenCPUHardware::setShared(nullptr);
+    delete hardware;
+    hardware = nullptr;
 
     PMstop();
 
@@ -402,29 +544,11 @@ void AMDRyzenCPUPowerManagement::fetchOEMBaseBoardInfo(){
 }
 
 bool AMDRyzenCPUPowerManagement::read_msr(uint32_t addr, uint64_t *value){
-    
-    uint32_t lo, hi;
-    //    IOLog("AMDCPUSupport lalala \n");
-    int err = rdmsr_carefully(addr, &lo, &hi);
-    //    IOLog("AMDCPUSupport rdmsr_carefully %d\n", err);
-    
-    if(!err) *value = lo | ((uint64_t)hi << 32);
-    
-    return err == 0;
+    return hardware->readMSR(addr, value);
 }
 
 bool AMDRyzenCPUPowerManagement::write_msr(uint32_t addr, uint64_t value){
-    if(wrmsr_carefully){
-        uint32_t lo = value & 0xffffffff;
-        uint32_t hi = value >> 32;
-        return (*wrmsr_carefully)(addr, lo, hi) == 0;
-    }
-    
-    //Fall back with unsafe method
-    wrmsr64(addr, value);
-    
-    //If failed, we've already panic and starting reboot. So just return true.
-    return true;
+    return hardware->writeMSR(addr, value);
 }
 
 void AMDRyzenCPUPowerManagement::registerRequest(){
@@ -434,7 +558,156 @@ void AMDRyzenCPUPowerManagement::registerRequest(){
     timeOfLastMissedRequest = now;
 }
 
-void AMDRyzenCPUPowerManagement::updateClockSpeed(uint8_t physical){
+void AMDRyzenCPUPowerManagement::publishTelemetry(){
+    if(!telemetryRing) return;
+    
+    uint64_t n = telemetrySamples;
+    AMDRyzenTelemetrySample *rec = AMDRyzenTelemetryBeginWrite(telemetryRing, n);
+    
+    uint32_t numPhyCores = min(totalNumberOfPhysicalCores, AMDRYZEN_TELEMETRY_MAX_CORES);
+    int lcpu_percore = totalNumberOfLogicalCores / totalNumberOfPhysicalCores;
+    
+    rec->timestampNs = getCurrentTimeNs();
+    rec->packagePower = (float)uniPackageEnergy;
+    rec->packageTemp = PACKAGE_TEMPERATURE_perPackage[0];
+    rec->PStateCtl = PStateCtl;
+    rec->numPhysCores = numPhyCores;
+    
+    rec->instructionDelta = 0;
+    for(uint32_t i = 0; i < totalNumberOfLogicalCores; i++){
+        rec->instructionDelta += sampler.instructionDelta_PerCore[i];
+    }
+    
+    for(uint32_t i = 0; i < numPhyCores; i++){
+        rec->effFreq_perCore[i] = sampler.effFreq_perCore[i];
+        rec->load_perCore[i] = pmRyzen_avgload_pcpu(i * lcpu_percore);
+    }
+    
+    AMDRyzenTelemetryEndWrite(telemetryRing, n);
+    telemetrySamples = n + 1;
+}
+
+uint32_t AMDRyzenCPUPowerManagement::getSnapshotSize(uint32_t fieldMask){
+    AMDRyzenSnapshotHeader hdr {};
+    hdr.headerSize = sizeof(AMDRyzenSnapshotHeader);
+    hdr.fieldMask = fieldMask & kAMDRyzenSnapshotAllFields;
+    hdr.numPhysCores = totalNumberOfPhysicalCores;
+    hdr.numLogicalCores = totalNumberOfLogicalCores;
+    hdr.numFans = superIO ? superIO->getNumberOfFans() : 0;
+    hdr.numCCDs = numberOfCCDs;
+    
+    return AMDRyzenSnapshotTotalSize(&hdr);
+}
+
+uint32_t AMDRyzenCPUPowerManagement::encodeSnapshot(void *buf, uint32_t bufSize, uint32_t fieldMask){
+    AMDRyzenSnapshotHeader counts {};
+    counts.fieldMask = fieldMask;
+    counts.numPhysCores = totalNumberOfPhysicalCores;
+    counts.numLogicalCores = totalNumberOfLogicalCores;
+    counts.numFans = superIO ? superIO->getNumberOfFans() : 0;
+    counts.numCCDs = numberOfCCDs;
+    counts.timestampNs = getCurrentTimeNs();
+    
+    if(!AMDRyzenSnapshotBeginEncode(buf, bufSize, &counts)) return 0;
+    
+    auto hdr = static_cast<AMDRyzenSnapshotHeader*>(buf);
+    
+    if(hdr->fieldMask & kAMDRyzenSnapshotPackage){
+        auto pkg = (AMDRyzenSnapshotPackage*)AMDRyzenSnapshotSectionOut(buf, kAMDRyzenSnapshotPackage);
+        pkg->packagePower = (float)uniPackageEnergy;
+        pkg->packageTemp = PACKAGE_TEMPERATURE_perPackage[0];
+        pkg->PStateCtl = PStateCtl;
+        pkg->reserved = 0;
+    }
+    
+    if(hdr->fieldMask & kAMDRyzenSnapshotCoreFreq){
+        auto freq = (float*)AMDRyzenSnapshotSectionOut(buf, kAMDRyzenSnapshotCoreFreq);
+        for(uint32_t i = 0; i < totalNumberOfPhysicalCores; i++){
+            freq[i] = sampler.effFreq_perCore[i];
+        }
+    }
+    
+    if(hdr->fieldMask & kAMDRyzenSnapshotCoreLoad){
+        auto load = (float*)AMDRyzenSnapshotSectionOut(buf, kAMDRyzenSnapshotCoreLoad);
+        int lcpu_percore = totalNumberOfLogicalCores / totalNumberOfPhysicalCores;
+        for(uint32_t i = 0; i < totalNumberOfPhysicalCores; i++){
+            load[i] = pmRyzen_avgload_pcpu(i * lcpu_percore);
+        }
+    }
+    
+    if(hdr->fieldMask & kAMDRyzenSnapshotInstRetired){
+        auto ins = (uint64_t*)AMDRyzenSnapshotSectionOut(buf, kAMDRyzenSnapshotInstRetired);
+        for(uint32_t i = 0; i < totalNumberOfLogicalCores; i++){
+            ins[i] = sampler.instructionDelta_PerCore[i];
+        }
+    }
+    
+    if(hdr->fieldMask & kAMDRyzenSnapshotPState){
+        auto ps = (uint8_t*)AMDRyzenSnapshotSectionOut(buf, kAMDRyzenSnapshotPState);
+        for(uint32_t i = 0; i < totalNumberOfLogicalCores; i++){
+            ps[i] = pmRyzen_get_processor(i)->PState;
+        }
+    }
+    
+    if(hdr->fieldMask & kAMDRyzenSnapshotCorePower){
+        auto pwr = (float*)AMDRyzenSnapshotSectionOut(buf, kAMDRyzenSnapshotCorePower);
+        for(uint32_t i = 0; i < totalNumberOfPhysicalCores; i++){
+            pwr[i] = sampler.corePower_perCore[i];
+        }
+    }
+    
+    if(hdr->fieldMask & kAMDRyzenSnapshotEnergy){
+        auto joules = (double*)AMDRyzenSnapshotSectionOut(buf, kAMDRyzenSnapshotEnergy);
+        joules[0] = getEnergyJoules(packageEnergy.acc);
+        for(uint32_t i = 0; i < totalNumberOfPhysicalCores; i++){
+            joules[i + 1] = getEnergyJoules(sampler.coreEnergy_perCore[i].acc);
+        }
+    }
+    
+    if(hdr->fieldMask & kAMDRyzenSnapshotCCDTemp){
+        auto temp = (float*)AMDRyzenSnapshotSectionOut(buf, kAMDRyzenSnapshotCCDTemp);
+        for(uint32_t i = 0; i < numberOfCCDs; i++){
+            temp[i] = CCD_TEMPERATURE_perCCD[i];
+        }
+    }
+    
+    if(hdr->fieldMask & kAMDRyzenSnapshotSVI){
+        auto svi = (AMDRyzenSnapshotSVI*)AMDRyzenSnapshotSectionOut(buf, kAMDRyzenSnapshotSVI);
+        svi->coreVoltage = SVI_VOLTAGE_perPlane[kSVIPlaneCore];
+        svi->coreCurrent = SVI_CURRENT_perPlane[kSVIPlaneCore];
+        svi->corePower = SVI_POWER_perPlane[kSVIPlaneCore];
+        svi->socVoltage = SVI_VOLTAGE_perPlane[kSVIPlaneSoC];
+        svi->socCurrent = SVI_CURRENT_perPlane[kSVIPlaneSoC];
+        svi->socPower = SVI_POWER_perPlane[kSVIPlaneSoC];
+    }
+    
+    if(hdr->fieldMask & kAMDRyzenSnapshotHighFreq){
+        auto hf = (AMDRyzenSnapshotHighFreq*)AMDRyzenSnapshotSectionOut(buf, kAMDRyzenSnapshotHighFreq);
+        for(uint32_t i = 0; i < totalNumberOfLogicalCores; i++){
+            hf[i].samples = hfSamples_perCore[i];
+            hf[i].freqMin = hfFreqMin_perCore[i];
+            hf[i].freqMax = hfFreqMax_perCore[i];
+            hf[i].freqAvg = hfFreqAvg_perCore[i];
+            hf[i].power = hfPower_perCore[i];
+            hf[i].reserved = 0;
+            hf[i].instructions = hfInstructions_perCore[i];
+        }
+    }
+    
+    if(hdr->fieldMask & kAMDRyzenSnapshotFans){
+        auto fans = (AMDRyzenSnapshotFan*)AMDRyzenSnapshotSectionOut(buf, kAMDRyzenSnapshotFans);
+        for(uint32_t i = 0; i < hdr->numFans; i++){
+            fans[i].rpm = superIO->getRPMForFan(i);
+            fans[i].throttle = superIO->getFanThrottle(i);
+            fans[i].autoControl = superIO->getFanAutoControlMode(i) ? 1 : 0;
+            fans[i].reserved = 0;
+        }
+    }
+    
+    return hdr->totalSize;
+}
+
+void AMDRyzenCPUPowerManagement::updateClockSpeed(uint32_t physical){
     
     uint64_t msr_value_buf = 0;
     bool err = !read_msr(kMSR_HARDWARE_PSTATE_STATUS, &msr_value_buf);
@@ -454,94 +727,132 @@ void AMDRyzenCPUPowerManagement::updateClockSpeed(uint8_t physical){
     float clock = curCpuFid / curCpuDfsId * 200.0f;
     
 //    PStateCur_perCore[physical] = curHwPstate;
-    effFreq_perCore[physical] = clock;
+    sampler.effFreq_perCore[physical] = clock;
     
     //    IOLog("AMDCPUSupport::updateClockSpeed: %u\n", curHwPstate);
 }
 
-void AMDRyzenCPUPowerManagement::calculateEffectiveFrequency(uint8_t physical){
-    
-    uint32_t APERF_lo, APERF_hi;
-    uint32_t MPERF_lo, MPERF_hi;
-    
-    /**
-     * The effective frequency interface provides +/- 50MHz accuracy if the following constraints are met:
-     * • Effective frequency is read at most one time per millisecond.
-     * • When reading or writing Core::X86::Msr::MPERF and Core::X86::Msr::APERF software executes only
-     *  MOV instructions, and no more than 3 MOV instructions, between the two RDMSR or WRMSR
-     *  instructions.
-     * • Core::X86::Msr::MPERF and Core::X86::Msr::APERF are invalid if an overflow occurs.
-    */
-    __asm__ volatile("movl $0xe8, %%ecx;"
-                     "rdmsr;"
-                     "movl %%eax, %0;"
-                     "movl %%edx, %1;"
-                     "movl $0xe7, %%ecx;"
-                     "rdmsr;"
-                     : "=r"(APERF_lo), "=r"(APERF_hi), "=a"(MPERF_lo), "=d"(MPERF_hi)
-                     :
-                     : "%ecx"
-                    );
-    
-    uint64_t APERF = APERF_lo | ((uint64_t)APERF_hi << 32);
-    uint64_t MPERF = MPERF_lo | ((uint64_t)MPERF_hi << 32);;
-        
-    uint64_t lastAPERF = lastAPERF_PerCore[physical];
-    uint64_t lastMPERF = lastMPERF_PerCore[physical];
+void AMDRyzenCPUPowerManagement::setHighFrequencySampling(uint32_t intervalUs){
+    hfIntervalUs = intervalUs;
+    pmRyzen_hf_set_interval(intervalUs);
     
-    //If an overflow of either the MPERF or APERF register occurs between the read of last MPERF and the
-    //read of last APERF, the effective frequency calculated in is invalid.
-    //Yeah, so we will do nothing.
-    if(APERF <= lastAPERF || MPERF <= lastMPERF) {
-        IOLog("AMDCPUSupport::calculateEffectiveFrequency: frequency is invalid!!!");
-        return;
+    if(!intervalUs){
+        for(uint32_t i = 0; i < totalNumberOfLogicalCores; i++){
+            hfSamples_perCore[i] = 0;
+            hfFreqMin_perCore[i] = hfFreqMax_perCore[i] = hfFreqAvg_perCore[i] = 0;
+            hfInstructions_perCore[i] = 0;
+            hfPower_perCore[i] = 0;
+        }
     }
+}
+
+void AMDRyzenCPUPowerManagement::drainHighFrequencySamples(){
+    if(!hfIntervalUs) return;
     
     float freqP0 = PStateDefClock_perCore[0];
+    float ratioScale = freqP0 / (1 << HF_RATIO_SHIFT);
     
-    uint64_t deltaAPERF = APERF - lastAPERF;
-    deltaAPERF_PerCore[physical] = deltaAPERF;
-    deltaMPERF_PerCore[physical] = MPERF - lastMPERF;
-    float effFreq = ((float)deltaAPERF / (float)(MPERF - lastMPERF)) * freqP0;
-    
-    effFreq_perCore[physical] = effFreq;
+    for(uint32_t i = 0; i < totalNumberOfLogicalCores; i++){
+        pmRyzenHF_t hf;
+        if(!pmRyzen_hf_read(i, &hf)) continue;
+        
+        pmRyzenHF_t *last = &hfLast_perCore[i];
+        uint64_t samples = hf.samples - last->samples;
+        uint64_t dm = hf.mperf_acc - last->mperf_acc;
+        uint64_t dtsc = hf.tsc_acc - last->tsc_acc;
+        
+        hfSamples_perCore[i] = (uint32_t)samples;
+        hfInstructions_perCore[i] = hf.irpc_acc - last->irpc_acc;
+        
+        //Min and max are only meaningful if the CPU sampled during this epoch.
+        if(samples && dm && hf.ratio_min <= hf.ratio_max){
+            hfFreqAvg_perCore[i] = (float)(hf.aperf_acc - last->aperf_acc) / (float)dm * freqP0;
+            hfFreqMin_perCore[i] = hf.ratio_min * ratioScale;
+            hfFreqMax_perCore[i] = hf.ratio_max * ratioScale;
+        }
+        
+        if(dtsc)
+            hfPower_perCore[i] = (float)((pwrEnergyUnit * (hf.energy_acc - last->energy_acc)) /
+                                         ((double)dtsc / xnuTSCFreq));
+        
+        *last = hf;
+    }
     
-    lastAPERF_PerCore[physical] = APERF;
-    lastMPERF_PerCore[physical] = MPERF;
+    pmRyzen_hf_next_epoch();
 }
 
-void AMDRyzenCPUPowerManagement::updateInstructionDelta(uint8_t cpu_num){
-    uint64_t insCount;
-    
-    if(!read_msr(kMSR_PERF_IRPC, &insCount))
-        panic("AMDCPUSupport::updateInstructionDelta: fucked up");
+void AMDRyzenCPUPowerManagement::setPMCEvents(const uint64_t *events, uint32_t count){
+    IOLockLock(pmcLock);
     
+    //No events given means the default preset.
+    for(uint32_t i = 0; i < kPMCMaxCounters; i++){
+        if(!events)
+            pmcPendingEvents[i] = i < PMC_DEFAULT_EVENTS_LEN ? pmc_default_events[i] : 0;
+        else
+            pmcPendingEvents[i] = i < count ? (uint32_t)events[i] : 0;
+    }
     
-    //Skip if overflowed
-    if(lastInstructionDelta_perCore[cpu_num] > insCount) return;
-    
-//    uint64_t delta = insCount - lastInstructionDelta_perCore[cpu_num];
-    instructionDelta_PerCore[cpu_num] = insCount - lastInstructionDelta_perCore[cpu_num];
+    pmcPendingGen++;
     
-    lastInstructionDelta_perCore[cpu_num] = insCount;
+    IOLockUnlock(pmcLock);
+}
+
+void AMDRyzenCPUPowerManagement::applyPMCConfig(){
+    //Latch pending events outside the rendezvous so every CPU programs the same set.
+    IOLockLock(pmcLock);
     
-    //write_msr(kMSR_PERF_IRPC, 0);
+    if(pmcPendingGen != sampler.pmcConfigGen)
+        sampler.latchPMCEvents(pmcPendingEvents, pmcPendingGen);
     
+    IOLockUnlock(pmcLock);
+}
+
+float AMDRyzenCPUPowerManagement::getPMCRate(uint32_t cpu_num, uint32_t slot){
+    if(!actualUpdateTimeInterval) return 0;
     
-    //Calculate load index
-//    float estimatedInstRet = (effFreq_perCore[cpu_num] * 1000000);
-//    estimatedInstRet = estimatedInstRet * (actualUpdateTimeInterval * 0.001);
-//    float index = (float)delta / estimatedInstRet;
-//
-//    float growth = 3200;
-//    loadIndex_PerCore[cpu_num] = log10f(min(index,1) * growth) / log10f(growth);
+    return sampler.pmcDelta_perCore[cpu_num][slot] / (actualUpdateTimeInterval * 0.001f);
 }
 
 void AMDRyzenCPUPowerManagement::applyPowerControl(){
-    mp_rendezvous(nullptr, [](void *obj) {
+    //Pinned CPUs keep their own target.
+    uint64_t cpuMask[kCPUMaskWords];
+    AMDRyzenMSRScopeMask(kMSR_PSTATE_CTL, cpuMask, kCPUMaskWords);
+    for(uint32_t i = 0; i < pmRyzen_num_slots; i++){
+        if(PStateCtl_perCore[i] != kPStateUnpinned)
+            cpuMask[i / 64] &= ~(1ULL << (i % 64));
+    }
+    
+    hardware->crossCall(cpuMask, kCPUMaskWords, [](void *obj) {
         auto provider = static_cast<AMDRyzenCPUPowerManagement*>(obj);
         provider->write_msr(kMSR_PSTATE_CTL, (uint64_t)(provider->PStateCtl & 0x7));
-    }, nullptr, this);
+    }, this);
+}
+
+void AMDRyzenCPUPowerManagement::setPStateTargets(const uint64_t *cpuMask, uint8_t state){
+    for(uint32_t i = 0; i < CPUInfo::MaxCpus; i++){
+        if(cpuMask[i / 64] & (1ULL << (i % 64)))
+            PStateCtl_perCore[i] = state;
+    }
+    
+    hardware->crossCall(cpuMask, kCPUMaskWords, [](void *obj) {
+        auto provider = static_cast<AMDRyzenCPUPowerManagement*>(obj);
+        int cpu = provider->hardware->cpuNumber();
+        
+        //Unpinned CPUs go back to the global setting until the governor picks them up again.
+        pmRyzen_pin_PState(provider->PStateCtl_perCore[cpu], provider->PStateCtl & 0x7);
+    }, this);
+}
+
+void AMDRyzenCPUPowerManagement::setCCXPStateTargets(uint64_t ccxMask, uint8_t state){
+    uint64_t cpuMask[kCPUMaskWords] {};
+    
+    for(uint32_t i = 0; i < pmRyzen_num_slots; i++){
+        pmProcessor_t *p = pmRyzen_get_processor(i);
+        if(p->lcpu && p->ccx < 64 && (ccxMask & (1ULL << p->ccx)))
+            cpuMask[i / 64] |= 1ULL << (i % 64);
+    }
+    
+    setPStateTargets(cpuMask, state);
 }
 
 void AMDRyzenCPUPowerManagement::setCPBState(bool enabled){
@@ -560,11 +871,14 @@ void AMDRyzenCPUPowerManagement::setCPBState(bool enabled){
     //A bit hacky but at least works for now.
     void* args[] = {this, &hwConfig};
     
-    mp_rendezvous(nullptr, [](void *obj) {
+    uint64_t cpuMask[kCPUMaskWords];
+    AMDRyzenMSRScopeMask(kMSR_HWCR, cpuMask, kCPUMaskWords);
+    
+    hardware->crossCall(cpuMask, kCPUMaskWords, [](void *obj) {
         auto v = static_cast<uint64_t*>(*((uint64_t**)obj+1));
         auto provider = static_cast<AMDRyzenCPUPowerManagement*>(*((AMDRyzenCPUPowerManagement**)obj));
         provider->write_msr(kMSR_HWCR, *v);
-    }, nullptr, args);
+    }, args);
 }
 
 bool AMDRyzenCPUPowerManagement::getCPBState(){
@@ -575,12 +889,52 @@ bool AMDRyzenCPUPowerManagement::getCPBState(){
     return !((hwConfig >> 25) & 0x1);
 }
 
+uint32_t AMDRyzenCPUPowerManagement::readSMN(uint32_t addr){
+    uint32_t value = 0;
+    readSMNBatch(&addr, &value, 1);
+    return value;
+}
+
+void AMDRyzenCPUPowerManagement::readSMNBatch(const uint32_t *addrs, uint32_t *values, uint32_t count){
+    IOLockLock(smnLock);
+    smn.readBatch(addrs, values, count);
+    IOLockUnlock(smnLock);
+}
+
+void AMDRyzenCPUPowerManagement::probeCCDs(){
+    numberOfCCDs = 0;
+    if(!ccdTempBase) return;
+    
+    uint32_t regs[kMaxCCDs];
+    uint32_t values[kMaxCCDs];
+    for(uint32_t i = 0; i < kMaxCCDs; i++){
+        regs[i] = ccdTempBase + i * 4;
+    }
+    
+    readSMNBatch(regs, values, kMaxCCDs);
+    
+    //Unpopulated or fused off CCDs never report a valid reading.
+    for(uint32_t i = 0; i < kMaxCCDs; i++){
+        if(values[i] & kZEN_CCD_TEMP_VALID)
+            ccdTempRegs[numberOfCCDs++] = regs[i];
+    }
+    
+    IOLog("AMDCPUSupport::probeCCDs: %u CCD temperature sensor(s)\n", numberOfCCDs);
+}
+
 void AMDRyzenCPUPowerManagement::updatePackageTemp(){
-    IOPCIAddressSpace space;
-    space.bits = 0x00;
+    //Only the first package's SMN is reachable through our PCI device.
+    uint32_t regs[kMaxCCDs + 1];
+    uint32_t values[kMaxCCDs + 1];
     
-    fIOPCIDevice->configWrite32(space, (UInt8)kFAMILY_17H_PCI_CONTROL_REGISTER, (UInt32)kF17H_M01H_THM_TCON_CUR_TMP);
-    uint32_t temperature = fIOPCIDevice->configRead32(space, kFAMILY_17H_PCI_CONTROL_REGISTER + 4);
+    regs[0] = kF17H_M01H_THM_TCON_CUR_TMP;
+    for(uint32_t i = 0; i < numberOfCCDs; i++){
+        regs[i + 1] = ccdTempRegs[i];
+    }
+    
+    readSMNBatch(regs, values, numberOfCCDs + 1);
+    
+    uint32_t temperature = values[0];
     
     
     bool tempOffsetFlag = (temperature & kF17H_TEMP_OFFSET_FLAG) != 0;
@@ -596,29 +950,35 @@ void AMDRyzenCPUPowerManagement::updatePackageTemp(){
     
     PACKAGE_TEMPERATURE_perPackage[0] = t;
     
+    for(uint32_t i = 0; i < numberOfCCDs; i++){
+        uint32_t ccd = values[i + 1];
+        
+        // Tccd [10:0], 0.125 degree per step from -49C
+        if(ccd & kZEN_CCD_TEMP_VALID)
+            CCD_TEMPERATURE_perCCD[i] = (ccd & kZEN_CCD_TEMP_MASK) * 0.125f - 49.0f;
+    }
+}
+
+void AMDRyzenCPUPowerManagement::updateSVITelemetry(){
+    if(!sviSupported) return;
     
-//    IOPCIAddressSpace space2;
-//    space2.bits = 0;
-//    space2.es.deviceNum = 0x18;
-//    space2.es.functionNum = 3;
-//    uint32_t nn = fIOPCIDevice->configRead32(space2, 0x00);
-//    uint64_t ca = 0;
-//    read_msr(kMSR_CSTATE_ADDR, &ca);
-//
-//    IOLog("shit %u %llu\n", nn, ca);
+    uint32_t values[kSVIPlaneCount];
+    readSMNBatch(sviRegs, values, kSVIPlaneCount);
+    
+    for(uint32_t i = 0; i < kSVIPlaneCount; i++){
+        svi_decode(values[i], sviCurrentScale[i], &SVI_VOLTAGE_perPlane[i], &SVI_CURRENT_perPlane[i]);
+        SVI_POWER_perPlane[i] = SVI_VOLTAGE_perPlane[i] * SVI_CURRENT_perPlane[i];
+    }
 }
 
 void AMDRyzenCPUPowerManagement::updatePackageEnergy(){
     
-    uint64_t ctsc = rdtsc64();
+    uint64_t ctsc = hardware->readTSC();
 
     uint64_t msr_value_buf = 0;
     read_msr(kMSR_PKG_ENERGY_STAT, &msr_value_buf);
 
-    uint32_t energyValue = (uint32_t)(msr_value_buf & 0xffffffff);
-
-    uint64_t energyDelta = (lastUpdateEnergyValue <= energyValue) ?
-    energyValue - lastUpdateEnergyValue : UINT32_MAX - lastUpdateEnergyValue;
+    uint32_t energyDelta = energy_accumulate(&packageEnergy, msr_value_buf);
 
     double seconds = (ctsc - pwrLastTSC) / (double)(xnuTSCFreq);
     double e = (pwrEnergyUnit * energyDelta) / (seconds);
@@ -626,8 +986,11 @@ void AMDRyzenCPUPowerManagement::updatePackageEnergy(){
     uniPackageEnergy = e;
 
 
-    lastUpdateEnergyValue = energyValue;
-    pwrLastTSC = rdtsc64();
+    pwrLastTSC = ctsc;
+}
+
+double AMDRyzenCPUPowerManagement::getEnergyJoules(uint64_t acc){
+    return pwrEnergyUnit * (double)acc;
 }
 
 void AMDRyzenCPUPowerManagement::dumpPstate(){
@@ -665,8 +1028,15 @@ void AMDRyzenCPUPowerManagement::writePstate(const uint64_t *buf){
     //A bit hacky but at least works for now.
     void* args[] = {this, (void*)buf};
     
+    //PStateDef is per core, one thread of each is enough. The master reads them back.
+    uint64_t cpuMask[kCPUMaskWords];
+    AMDRyzenMSRScopeMask(kMSR_PSTATE_0, cpuMask, kCPUMaskWords);
+    for(uint32_t i = 0; i < pmRyzen_num_slots; i++){
+        if(pmRyzen_cpunum_to_lcpu[i] && pmRyzen_cpu_is_master(i))
+            cpuMask[i / 64] |= 1ULL << (i % 64);
+    }
     
-    mp_rendezvous(nullptr, [](void *obj) {
+    hardware->crossCall(cpuMask, kCPUMaskWords, [](void *obj) {
         auto v = static_cast<uint64_t*>(((uint64_t**)obj)[1]);
         auto provider = static_cast<AMDRyzenCPUPowerManagement*>(*((AMDRyzenCPUPowerManagement**)obj));
 
@@ -683,25 +1053,155 @@ void AMDRyzenCPUPowerManagement::writePstate(const uint64_t *buf){
         }
     
         
-        if(!pmRyzen_cpu_is_master(cpu_number())) return;
+        if(!pmRyzen_cpu_is_master(provider->hardware->cpuNumber())) return;
         provider->dumpPstate();
         
-    }, nullptr, args);
+    }, args);
         
 }
 
 bool AMDRyzenCPUPowerManagement::initSuperIO(uint16_t *chipIntel){
     
-    superIO = nullptr;
-    if(!superIO) superIO = ISSuperIONCT668X::getDevice(&savedSMCChipIntel);
-    if(!superIO) superIO = ISSuperIONCT67XXFamily::getDevice(&savedSMCChipIntel);
-    if(!superIO) superIO = ISSuperIOIT86XXEFamily::getDevice(&savedSMCChipIntel);
+    IOLockLock(superIOLock);
+    
+    //The timer and fan curves keep driving the chip found first, probing again would leak it.
+    if(!superIO)
+        superIO = ISSuperIOGeneric::getDevice(&savedSMCChipIntel);
+    
+    IOLockUnlock(superIOLock);
     
     *chipIntel = savedSMCChipIntel;
     
+    //Fill the cache now rather than on the next tick.
+    sampleFans(true);
+    
     return superIO != nullptr;
 }
 
+void AMDRyzenCPUPowerManagement::sampleFans(bool force){
+    if(!superIO) return;
+    
+    uint64_t now = getCurrentTimeNs();
+    if(!force && now - fanSampleTimeNs < kFanSampleIntervalMs * 1000000ULL) return;
+    
+    IOLockLock(superIOLock);
+    superIO->updateFanRPMS();
+    superIO->updateFanControl();
+    superIO->updateSensors();
+    fanSampleTimeNs = now;
+    IOLockUnlock(superIOLock);
+}
+
+void AMDRyzenCPUPowerManagement::overrideFanControl(int fan, uint8_t thr){
+    if(!superIO) return;
+    
+    IOLockLock(superIOLock);
+    if(fan >= 0 && fan < kMaxFanCurves) fanCurves[fan].configure(&kFanCurveDisabled);
+    superIO->overrideFanControl(fan, thr);
+    
+    //Show the new setting on the next tick.
+    fanSampleTimeNs = 0;
+    IOLockUnlock(superIOLock);
+}
+
+void AMDRyzenCPUPowerManagement::setDefaultFanControl(int fan){
+    if(!superIO) return;
+    
+    IOLockLock(superIOLock);
+    if(fan >= 0 && fan < kMaxFanCurves) fanCurves[fan].configure(&kFanCurveDisabled);
+    superIO->setDefaultFanControl(fan);
+    fanSampleTimeNs = 0;
+    IOLockUnlock(superIOLock);
+}
+
+bool AMDRyzenCPUPowerManagement::setFanCurve(int fan, const AMDRyzenFanCurve *curve){
+    if(!superIO || fan < 0 || fan >= kMaxFanCurves || fan >= superIO->getNumberOfFans())
+        return false;
+    
+    if(!AMDRyzenCPUFanCurve::validate(curve))
+        return false;
+    
+    //Only the first package's Tctl is sampled.
+    if(curve->enabled && curve->source == kAMDRyzenFanSourcePackage && curve->sourceIndex)
+        return false;
+    
+    IOLockLock(superIOLock);
+    
+    //Hand the fan back to the chip when its curve goes away.
+    if(fanCurves[fan].isEnabled() && !curve->enabled)
+        superIO->setDefaultFanControl(fan);
+    
+    fanCurves[fan].configure(curve);
+    fanCurveApplied[fan] = -1;
+    
+    IOLockUnlock(superIOLock);
+    return true;
+}
+
+bool AMDRyzenCPUPowerManagement::getFanCurve(int fan, AMDRyzenFanCurve *curve, int *pwm){
+    if(fan < 0 || fan >= kMaxFanCurves) return false;
+    
+    IOLockLock(superIOLock);
+    *curve = *fanCurves[fan].getConfig();
+    curve->version = AMDRYZEN_FANCURVE_VERSION;
+    *pwm = fanCurves[fan].lastOutput();
+    IOLockUnlock(superIOLock);
+    
+    return true;
+}
+
+float AMDRyzenCPUPowerManagement::getFanCurveTemp(const AMDRyzenFanCurve *curve){
+    switch (curve->source) {
+        case kAMDRyzenFanSourceCCDMax:
+            if(numberOfCCDs){
+                float t = CCD_TEMPERATURE_perCCD[0];
+                for(uint32_t i = 1; i < numberOfCCDs; i++){
+                    t = max(t, CCD_TEMPERATURE_perCCD[i]);
+                }
+                return t;
+            }
+            break;
+            
+        case kAMDRyzenFanSourceCCD:
+            if(curve->sourceIndex < numberOfCCDs)
+                return CCD_TEMPERATURE_perCCD[curve->sourceIndex];
+            break;
+            
+        case kAMDRyzenFanSourcePackage:
+            break;
+            
+        case kAMDRyzenFanSourceSuperIO:
+            if(curve->sourceIndex < superIO->getNumberOfTemperatures())
+                return superIO->getTemperature(curve->sourceIndex);
+            break;
+    }
+    
+    return PACKAGE_TEMPERATURE_perPackage[0];
+}
+
+void AMDRyzenCPUPowerManagement::updateFanCurves(){
+    if(!superIO) return;
+    
+    uint64_t now = getCurrentTimeNs();
+    float dt = fanCurveTimeNs ? (now - fanCurveTimeNs) / 1000000000.0f : 0;
+    fanCurveTimeNs = now;
+    
+    IOLockLock(superIOLock);
+    
+    int numFans = min(superIO->getNumberOfFans(), kMaxFanCurves);
+    for(int i = 0; i < numFans; i++){
+        if(!fanCurves[i].isEnabled()) continue;
+        
+        uint8_t pwm = fanCurves[i].evaluate(getFanCurveTemp(fanCurves[i].getConfig()), dt);
+        if(pwm == fanCurveApplied[i]) continue;
+        
+        superIO->overrideFanControl(i, pwm);
+        fanCurveApplied[i] = pwm;
+    }
+    
+    IOLockUnlock(superIOLock);
+}
+
 uint32_t AMDRyzenCPUPowerManagement::getPMPStateLimit(){
     return pmRyzen_pstatelimit;
 }
@@ -714,7 +1214,7 @@ void AMDRyzenCPUPowerManagement::setPMPStateLimit(uint32_t state){
 }
 
 uint32_t AMDRyzenCPUPowerManagement::getHPcpus(){
-    return pmRyzen_hpcpus;
+    return __atomic_load_n(&pmRyzen_hpcpus, __ATOMIC_RELAXED);
 }
 
 EXPORT extern "C" kern_return_t ADDPR(kern_start)(kmod_info_t *, void *) {
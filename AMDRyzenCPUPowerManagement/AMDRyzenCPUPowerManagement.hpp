@@ -7,6 +7,7 @@
 #include <math.h>
 #include <IOKit/pci/IOPCIDevice.h>
 #include <IOKit/IOTimerEventSource.h>
+#include <IOKit/IOBufferMemoryDescriptor.h>
 
 
 #include <i386/proc_reg.h>
@@ -24,9 +25,16 @@
 
 #include "symresolver/kernel_resolver.h"
 
-#include "SuperIO/ISSuperIONCT668X.hpp"
-#include "SuperIO/ISSuperIONCT67XXFamily.hpp"
-#include "SuperIO/ISSuperIOIT86XXEFamily.hpp"
+#include "AMDRyzenCPUHardware.hpp"
+#include "AMDRyzenCPUSMN.hpp"
+#include "AMDRyzenCPUSampler.hpp"
+#include "AMDRyzenCPUPMTelemetry.h"
+#include "AMDRyzenCPUPMSnapshot.h"
+#include "AMDRyzenCPUSVI.h"
+#include "AMDRyzenCPUEnergy.h"
+#include "AMDRyzenCPUFanCurve.hpp"
+
+#include "SuperIO/ISSuperIOGeneric.hpp"
 
 #include <i386/cpuid.h>
 
@@ -62,6 +70,8 @@ uint64_t pmRyzen_rdmsr_safe(void *, uint32_t);
 
 };
 
+#include "AMDRyzenCPUMSRScope.h"
+
 
 /**
  * Offset table: https://github.com/torvalds/linux/blob/master/drivers/hwmon/k10temp.c#L78
@@ -96,13 +106,17 @@ public:
     
     static constexpr uint32_t kCOFVID_STATUS = 0xC0010071;
     static constexpr uint32_t k17H_M01H_SVI = 0x0005A000;
+    static constexpr uint32_t kSVIPlaneCore = 0;
+    static constexpr uint32_t kSVIPlaneSoC = 1;
+    static constexpr uint32_t kSVIPlaneCount = 2;
     static constexpr uint32_t kF17H_M01H_THM_TCON_CUR_TMP = 0x00059800;
     static constexpr uint32_t kF17H_M70H_CCD1_TEMP = 0x00059954;
+    static constexpr uint32_t kZEN_CCD_TEMP_VALID = 0x800;
+    static constexpr uint32_t kZEN_CCD_TEMP_MASK = 0x7ff;
+    static constexpr uint32_t kMaxCCDs = 8;
     static constexpr uint32_t kF17H_TEMP_OFFSET_FLAG = 0x80000;
     static constexpr uint32_t kF18H_TEMP_OFFSET_FLAG = 0x60000;
-    static constexpr uint8_t kFAMILY_17H_PCI_CONTROL_REGISTER = 0x60;
     static constexpr uint32_t kMSR_HWCR = 0xC0010015;
-    static constexpr uint32_t kMSR_CORE_ENERGY_STAT = 0xC001029A;
     static constexpr uint32_t kMSR_HARDWARE_PSTATE_STATUS = 0xC0010293;
     static constexpr uint32_t kMSR_PKG_ENERGY_STAT = 0xC001029B;
     static constexpr uint32_t kMSR_PSTATE_0 = 0xC0010064;
@@ -110,11 +124,9 @@ public:
     static constexpr uint32_t kMSR_PSTATE_STAT = 0xC0010063;
     static constexpr uint32_t kMSR_PSTATE_CTL = 0xC0010062;
     static constexpr uint32_t kMSR_RAPL_PWR_UNIT = 0xC0010299;
-    static constexpr uint32_t kMSR_MPERF = 0x000000E7;
-    static constexpr uint32_t kMSR_APERF = 0x000000E8;
     static constexpr uint32_t kMSR_PERF_CTL_0 = 0xC0010000;
     static constexpr uint32_t kMSR_PERF_CTR_0 = 0xC0010004;
-    static constexpr uint32_t kMSR_PERF_IRPC = 0xC00000E9;
+    static constexpr uint32_t kPMCMaxCounters = AMDRyzenCPUSampler::kPMCMaxCounters;
     static constexpr uint32_t kMSR_CSTATE_ADDR = 0xC0010073;
     
     
@@ -140,19 +152,38 @@ public:
     bool write_msr(uint32_t addr, uint64_t value);
     
     
-    void updateClockSpeed(uint8_t physical);
-    void calculateEffectiveFrequency(uint8_t physical);
-    void updateInstructionDelta(uint8_t physical);
+    void updateClockSpeed(uint32_t physical);
     void applyPowerControl();
+    void setPStateTargets(const uint64_t *cpuMask, uint8_t state);
+    
+    void setCCXPStateTargets(uint64_t ccxMask, uint8_t state);
     
     void setCPBState(bool enabled);
     bool getCPBState();
     
+    uint32_t readSMN(uint32_t addr);
+    void readSMNBatch(const uint32_t *addrs, uint32_t *values, uint32_t count);
+    
+    void probeCCDs();
     void updatePackageTemp();
+    void updateSVITelemetry();
+    
+    void setHighFrequencySampling(uint32_t intervalUs);
+    void drainHighFrequencySamples();
+    
+    void setPMCEvents(const uint64_t *events, uint32_t count);
+    void applyPMCConfig();
+    float getPMCRate(uint32_t cpu_num, uint32_t slot);
     void updatePackageEnergy();
+    double getEnergyJoules(uint64_t acc);
     
     void registerRequest();
     
+    void publishTelemetry();
+    
+    uint32_t getSnapshotSize(uint32_t fieldMask);
+    uint32_t encodeSnapshot(void *buf, uint32_t bufSize, uint32_t fieldMask);
+    
     void dumpPstate();
     void writePstate(const uint64_t *buf);
     
@@ -163,6 +194,7 @@ public:
     
     uint32_t getHPcpus();
     
+    uint32_t totalNumberOfPackages;
     uint32_t totalNumberOfPhysicalCores;
     uint32_t totalNumberOfLogicalCores;
     
@@ -181,28 +213,63 @@ public:
     
     
     /**
-     *  Hard allocate space for cached readings.
+     *  Per CPU readings of the timer tick, effective frequency, instructions, core power and
+     *  energy and PMU deltas.
      */
-    float effFreq_perCore[CPUInfo::MaxCpus] {};
-    float PACKAGE_TEMPERATURE_perPackage[CPUInfo::MaxCpus];
+    AMDRyzenCPUSampler sampler;
+    static_assert(AMDRyzenCPUSampler::kMaxCPUs >= CPUInfo::MaxCpus, "sampler must cover every CPU");
     
-    uint64_t lastMPERF_PerCore[CPUInfo::MaxCpus];
-    uint64_t lastAPERF_PerCore[CPUInfo::MaxCpus];
-    uint64_t deltaAPERF_PerCore[CPUInfo::MaxCpus];
-    uint64_t deltaMPERF_PerCore[CPUInfo::MaxCpus];
+    /**
+     *  Hard allocate space for cached readings.
+     */
+    float PACKAGE_TEMPERATURE_perPackage[CPUInfo::MaxCpus] {};
     
-//    uint64_t lastAPERF_PerCore[CPUInfo::MaxCpus];
+    /**
+     *  Tccd readings, CCDs without a valid sensor are skipped so index i is the i-th present CCD.
+     */
+    float CCD_TEMPERATURE_perCCD[kMaxCCDs] {};
+    uint32_t numberOfCCDs = 0;
     
-    uint64_t instructionDelta_PerCore[CPUInfo::MaxCpus];
-    uint64_t lastInstructionDelta_perCore[CPUInfo::MaxCpus];
+    /**
+     *  SVI2 telemetry of the core and SoC voltage planes, only valid if sviSupported.
+     */
+    float SVI_VOLTAGE_perPlane[kSVIPlaneCount] {};
+    float SVI_CURRENT_perPlane[kSVIPlaneCount] {};
+    float SVI_POWER_perPlane[kSVIPlaneCount] {};
+    bool sviSupported = false;
     
     float loadIndex_PerCore[CPUInfo::MaxCpus];
     
+    /**
+     *  Aggregates of the high frequency samples each logical CPU took since the last tick.
+     *  Frequencies in MHz, power in Watts, all zero while the mode is off.
+     */
+    uint32_t hfIntervalUs = 0;
+    uint32_t hfSamples_perCore[CPUInfo::MaxCpus] {};
+    float hfFreqMin_perCore[CPUInfo::MaxCpus] {};
+    float hfFreqMax_perCore[CPUInfo::MaxCpus] {};
+    float hfFreqAvg_perCore[CPUInfo::MaxCpus] {};
+    uint64_t hfInstructions_perCore[CPUInfo::MaxCpus] {};
+    float hfPower_perCore[CPUInfo::MaxCpus] {};
+    
+    /**
+     *  Monotonic energy in RAPL units since the service started, never wraps in practice.
+     */
+    energy_counter packageEnergy {};
+    
     float PStateStepUpRatio = 0.36;
     float PStateStepDownRatio = 0.05;
     
     uint8_t PStateCur_perCore[CPUInfo::MaxCpus];
     uint8_t PStateCtl = 0;
+    
+    /**
+     *  P-state pinned per logical CPU, kPStateUnpinned follows PStateCtl and the idle governor.
+     *  Set through setPStateTargets with a mask of kCPUMaskWords words.
+     */
+    static constexpr uint8_t kPStateUnpinned = PMRYZEN_PSTATE_UNPINNED;
+    static constexpr uint32_t kCPUMaskWords = CPUInfo::MaxCpus / 64;
+    uint8_t PStateCtl_perCore[CPUInfo::MaxCpus];
     uint64_t PStateDef_perCore[8];
     uint8_t PStateEnabledLen = 0;
     float PStateDefClock_perCore[8];
@@ -210,7 +277,6 @@ public:
     
     
     uint64_t lastUpdateTime;
-    uint64_t lastUpdateEnergyValue;
     
     double uniPackageEnergy;
     
@@ -223,7 +289,37 @@ public:
     
     ISSuperIOSMCFamily *superIO{nullptr};
     
+    /**
+     *  Fans, voltages and temperatures are sampled from the timer at most every kFanSampleIntervalMs,
+     *  user clients read the values cached in superIO. fanSampleTimeNs is when they were last refreshed.
+     */
+    static constexpr uint32_t kFanSampleIntervalMs = 500;
+    uint64_t fanSampleTimeNs = 0;
+    
+    void sampleFans(bool force);
+    void overrideFanControl(int fan, uint8_t thr);
+    void setDefaultFanControl(int fan);
+    
+    /**
+     *  Fan curves run on the timer after the fans are sampled. A manual override or
+     *  default control request on a fan turns its curve off.
+     */
+    static constexpr int kMaxFanCurves = 16;
+    bool setFanCurve(int fan, const AMDRyzenFanCurve *curve);
+    bool getFanCurve(int fan, AMDRyzenFanCurve *curve, int *pwm);
+    void updateFanCurves();
+    
+    AMDRyzenCPUHardware *hardware{nullptr};
+    
+    /**
+     *  Sample ring shared read-only with user clients.
+     */
+    IOBufferMemoryDescriptor *telemetryBuffer{nullptr};
+    
 private:
+    AMDRyzenTelemetryRing *telemetryRing{nullptr};
+    uint64_t telemetrySamples = 0;
+    
     IOWorkLoop *workLoop;
     IOTimerEventSource *timerEventSource;
     
@@ -236,6 +332,16 @@ private:
     uint32_t timeOfLastMissedRequest = 0;
     
     float tempOffset = 0;
+    uint32_t ccdTempBase = 0;
+    uint32_t ccdTempRegs[kMaxCCDs] {};
+    uint32_t sviRegs[kSVIPlaneCount] {};
+    
+    pmRyzenHF_t hfLast_perCore[CPUInfo::MaxCpus] {};
+    
+    IOLock *pmcLock{nullptr};
+    uint32_t pmcPendingEvents[kPMCMaxCounters] {};
+    uint32_t pmcPendingGen = 0;
+    float sviCurrentScale[kSVIPlaneCount] {};
     double pwrTimeUnit = 0;
     double pwrEnergyUnit = 0;
     uint64_t pwrLastTSC = 0;
@@ -249,6 +355,24 @@ private:
     CPUInfo::CpuTopology cpuTopology {};
     
     IOPCIDevice *fIOPCIDevice;
+    
+    /**
+     *  Serialises SMN index/data pairs through smn.
+     */
+    IOLock *smnLock{nullptr};
+    AMDRyzenCPUSMN smn;
+    
+    /**
+     *  Serialises SuperIO port access between the timer and user clients.
+     */
+    IOLock *superIOLock{nullptr};
+    
+    AMDRyzenCPUFanCurve fanCurves[kMaxFanCurves];
+    int fanCurveApplied[kMaxFanCurves] {};
+    uint64_t fanCurveTimeNs = 0;
+    
+    float getFanCurveTemp(const AMDRyzenFanCurve *curve);
+    
     bool getPCIService();
     bool wentToSleep;
     
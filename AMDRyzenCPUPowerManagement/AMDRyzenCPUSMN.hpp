@@ -0,0 +1,56 @@
+//
+//  AMDRyzenCPUSMN.hpp
+//  AMDRyzenCPUPowerManagement
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#ifndef AMDRyzenCPUSMN_hpp
+#define AMDRyzenCPUSMN_hpp
+
+#include "AMDRyzenCPUHardware.hpp"
+
+/**
+ *  SMN reads through the index/data pair in the root complex config space. The index last
+ *  written is remembered so reading one register again skips rewriting it, nothing else on
+ *  the system programs the index register.
+ *
+ *  Not locked, an index/data pair must not interleave with another caller's so the provider
+ *  serialises every batch with smnLock.
+ */
+class AMDRyzenCPUSMN {
+
+public:
+    static constexpr uint8_t kIndexRegister = 0x60;
+    static constexpr uint8_t kDataRegister = 0x64;
+
+    void setHardware(AMDRyzenCPUHardware *hw){
+        hardware = hw;
+        indexValid = false;
+    }
+
+    void readBatch(const uint32_t *addrs, uint32_t *values, uint32_t count){
+        for(uint32_t i = 0; i < count; i++){
+            //Skip the index write if it already points at this register.
+            if(!indexValid || index != addrs[i]){
+                hardware->pciConfigWrite32(kIndexRegister, addrs[i]);
+                index = addrs[i];
+                indexValid = true;
+            }
+
+            values[i] = hardware->pciConfigRead32(kDataRegister);
+        }
+    }
+
+    /**
+     *  Write the index again on the next read, firmware may have moved it.
+     */
+    void invalidate(){ indexValid = false; }
+
+private:
+    AMDRyzenCPUHardware *hardware = nullptr;
+    uint32_t index = 0;
+    bool indexValid = false;
+};
+
+#endif /* AMDRyzenCPUSMN_hpp */
@@ -0,0 +1,69 @@
+//
+//  AMDRyzenCPUSVI.h
+//  AMDRyzenCPUPowerManagement
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#ifndef AMDRyzenCPUSVI_h
+#define AMDRyzenCPUSVI_h
+
+/**
+ *  SVI2 telemetry plane offsets from k17H_M01H_SVI and current scale in Amps per LSB:
+ *  https://github.com/ocerman/zenpower/blob/master/zenpower.c
+ *
+ *  Each plane register holds VID [23:16], 6.25mV per step down from 1.55V, and IDD [7:0].
+ *  The current scale only changes with the generation of the SMU: Zen2 onward report
+ *  through a finer IDD step than Zen/Zen+, including Zen3 on family 19h.
+ *
+ *  Free of kernel dependencies so Tests/ can check the decode on the host.
+ */
+
+#include <stdint.h>
+
+#define SVI_ZEN1_CORE_SCALE 1.039211f
+#define SVI_ZEN1_SOC_SCALE  0.360772f
+#define SVI_ZEN2_CORE_SCALE 0.658823f
+#define SVI_ZEN2_SOC_SCALE  0.127596f
+
+typedef struct svi_plane_desc {
+    uint8_t family;
+    uint8_t modelFirst;
+    uint8_t modelLast;
+    uint32_t coreOffset;
+    uint32_t socOffset;
+    float coreCurrentScale;
+    float socCurrentScale;
+} svi_plane_desc;
+
+#define SVI_PLANE_TABLE_LEN 7
+static const svi_plane_desc svi_plane_table[SVI_PLANE_TABLE_LEN] = {
+    { 0x17, 0x01, 0x08, 0xc, 0x10, SVI_ZEN1_CORE_SCALE, SVI_ZEN1_SOC_SCALE }, /* Zen/Zen+ Summit Ridge, Pinnacle Ridge */
+    { 0x17, 0x11, 0x18, 0x10, 0xc, SVI_ZEN1_CORE_SCALE, SVI_ZEN1_SOC_SCALE }, /* Zen/Zen+ Raven Ridge, Picasso */
+    { 0x17, 0x31, 0x31, 0x14, 0x10, SVI_ZEN2_CORE_SCALE, SVI_ZEN2_SOC_SCALE }, /* Zen 2 Threadripper/EPYC */
+    { 0x17, 0x60, 0x60, 0x10, 0xc, SVI_ZEN2_CORE_SCALE, SVI_ZEN2_SOC_SCALE }, /* Zen 2 Renoir */
+    { 0x17, 0x71, 0x71, 0x10, 0xc, SVI_ZEN2_CORE_SCALE, SVI_ZEN2_SOC_SCALE }, /* Zen 2 Matisse */
+    { 0x19, 0x00, 0x01, 0x14, 0x10, SVI_ZEN2_CORE_SCALE, SVI_ZEN2_SOC_SCALE }, /* Zen 3 Milan */
+    { 0x19, 0x21, 0x21, 0x10, 0xc, SVI_ZEN2_CORE_SCALE, SVI_ZEN2_SOC_SCALE }, /* Zen 3 Vermeer */
+};
+
+static inline const svi_plane_desc *svi_plane_lookup(uint8_t family, uint8_t model){
+    for(int i = 0; i < SVI_PLANE_TABLE_LEN; i++){
+        const svi_plane_desc *sp = svi_plane_table + i;
+        if(family == sp->family && model >= sp->modelFirst && model <= sp->modelLast)
+            return sp;
+    }
+    return 0;
+}
+
+static inline void svi_decode(uint32_t reg, float currentScale, float *volts, float *amps){
+    uint32_t vid = (reg >> 16) & 0xff;
+    uint32_t idd = reg & 0xff;
+
+    float v = 1.55f - vid * 0.00625f;
+
+    *volts = v > 0.0f ? v : 0.0f;
+    *amps = idd * currentScale;
+}
+
+#endif /* AMDRyzenCPUSVI_h */
@@ -0,0 +1,208 @@
+//
+//  AMDRyzenCPUSampler.hpp
+//  AMDRyzenCPUPowerManagement
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#ifndef AMDRyzenCPUSampler_hpp
+#define AMDRyzenCPUSampler_hpp
+
+#include "AMDRyzenCPUHardware.hpp"
+#include "AMDRyzenCPUEnergy.h"
+
+/**
+ *  The per CPU half of the timer tick: instructions retired and the PMU counters of every
+ *  logical CPU, effective frequency and core energy of every physical one. Each call runs on
+ *  the CPU it samples inside the tick's rendezvous and only touches that CPU's slots.
+ *
+ *  The provider keeps the package half and reads the results out of the arrays below, Tests/
+ *  drives the same calls against AMDRyzenCPUSimulatedHardware to measure a tick.
+ */
+class AMDRyzenCPUSampler {
+
+public:
+    static constexpr uint32_t kMaxCPUs = 256;
+    static constexpr uint32_t kMSR_CORE_ENERGY_STAT = 0xC001029A;
+    static constexpr uint32_t kMSR_MPERF = 0x000000E7;
+    static constexpr uint32_t kMSR_APERF = 0x000000E8;
+    static constexpr uint32_t kMSR_PERF_IRPC = 0xC00000E9;
+    static constexpr uint32_t kMSR_PERF_CTL_EXT_0 = 0xC0010200; //PerfCtrN at PerfCtlN + 1, stride 2
+    static constexpr uint32_t kPMCMaxCounters = 6;
+    static constexpr uint64_t kPMCCounterMask = (1ULL << 48) - 1;
+
+    void configure(AMDRyzenCPUHardware *hw, uint64_t tscFreq, double energyUnit){
+        hardware = hw;
+        this->tscFreq = tscFreq;
+        this->energyUnit = energyUnit;
+    }
+
+    /**
+     *  Take the first APERF, MPERF and core energy readings of a physical core.
+     */
+    bool primeCore(uint32_t physical){
+        uint64_t APERF, MPERF;
+        if(!hardware->readMSR(kMSR_APERF, &APERF) || !hardware->readMSR(kMSR_MPERF, &MPERF))
+            return false;
+
+        lastAPERF_PerCore[physical] = APERF;
+        lastMPERF_PerCore[physical] = MPERF;
+
+        uint64_t coreEnergy = 0;
+        hardware->readMSR(kMSR_CORE_ENERGY_STAT, &coreEnergy);
+        coreEnergy_perCore[physical].last = (uint32_t)coreEnergy;
+        lastCoreEnergyTSC_perCore[physical] = hardware->readTSC();
+        return true;
+    }
+
+    void updateInstructionDelta(uint32_t cpu_num){
+        uint64_t insCount;
+
+        if(!hardware->readMSR(kMSR_PERF_IRPC, &insCount))
+            panic("AMDCPUSupport::updateInstructionDelta: fucked up");
+
+        //Skip if overflowed
+        if(lastInstructionDelta_perCore[cpu_num] > insCount) return;
+
+        instructionDelta_PerCore[cpu_num] = insCount - lastInstructionDelta_perCore[cpu_num];
+        lastInstructionDelta_perCore[cpu_num] = insCount;
+    }
+
+    /**
+     *  Events latched for the next tick under generation gen, every CPU reprograms its
+     *  counters the first time it samples under a generation it has not applied.
+     */
+    void latchPMCEvents(const uint32_t *events, uint32_t gen){
+        pmcActive = false;
+        for(uint32_t i = 0; i < kPMCMaxCounters; i++){
+            pmcEvents[i] = events[i];
+            pmcActive |= pmcEvents[i] != 0;
+        }
+
+        pmcConfigGen = gen;
+    }
+
+    void updatePMC(uint32_t cpu_num){
+        if(pmcAppliedGen_perCore[cpu_num] != pmcConfigGen){
+            for(uint32_t i = 0; i < kPMCMaxCounters; i++){
+                uint32_t ctl = kMSR_PERF_CTL_EXT_0 + i * 2;
+                uint32_t ev = pmcEvents[i];
+
+                hardware->writeMSR(ctl, 0);
+                hardware->writeMSR(ctl + 1, 0);
+                pmcLast_perCore[cpu_num][i] = 0;
+                pmcDelta_perCore[cpu_num][i] = 0;
+
+                if(!ev) continue;
+
+                //EventSelect[7:0], UnitMask[15:8], Usr, Os, En, EventSelect[11:8] at [35:32]
+                uint64_t sel = (ev & 0xff) | (((ev >> 16) & 0xff) << 8) |
+                    (1 << 16) | (1 << 17) | (1 << 22) | ((uint64_t)((ev >> 8) & 0xf) << 32);
+                hardware->writeMSR(ctl, sel);
+            }
+
+            pmcAppliedGen_perCore[cpu_num] = pmcConfigGen;
+            return;
+        }
+
+        if(!pmcActive) return;
+
+        for(uint32_t i = 0; i < kPMCMaxCounters; i++){
+            if(!pmcEvents[i]) continue;
+
+            uint64_t count = 0;
+            if(!hardware->readMSR(kMSR_PERF_CTL_EXT_0 + i * 2 + 1, &count)) continue;
+
+            //Counters are 48 bits wide, masking the difference absorbs a wrap.
+            pmcDelta_perCore[cpu_num][i] = (count - pmcLast_perCore[cpu_num][i]) & kPMCCounterMask;
+            pmcLast_perCore[cpu_num][i] = count;
+        }
+    }
+
+    void calculateEffectiveFrequency(uint32_t physical, float freqP0){
+
+        /**
+         * The effective frequency interface provides +/- 50MHz accuracy if the following constraints are met:
+         * • Effective frequency is read at most one time per millisecond.
+         * • When reading or writing Core::X86::Msr::MPERF and Core::X86::Msr::APERF software executes only
+         *  MOV instructions, and no more than 3 MOV instructions, between the two RDMSR or WRMSR
+         *  instructions.
+         * • Core::X86::Msr::MPERF and Core::X86::Msr::APERF are invalid if an overflow occurs.
+        */
+        uint64_t APERF, MPERF;
+        hardware->readEffectiveFrequencyCounters(&APERF, &MPERF);
+
+        uint64_t lastAPERF = lastAPERF_PerCore[physical];
+        uint64_t lastMPERF = lastMPERF_PerCore[physical];
+
+        //If an overflow of either the MPERF or APERF register occurs between the read of last MPERF and the
+        //read of last APERF, the effective frequency calculated in is invalid.
+        //Yeah, so we will do nothing.
+        if(APERF <= lastAPERF || MPERF <= lastMPERF) {
+            IOLog("AMDCPUSupport::calculateEffectiveFrequency: frequency is invalid!!!");
+            return;
+        }
+
+        uint64_t deltaAPERF = APERF - lastAPERF;
+        deltaAPERF_PerCore[physical] = deltaAPERF;
+        deltaMPERF_PerCore[physical] = MPERF - lastMPERF;
+        float effFreq = ((float)deltaAPERF / (float)(MPERF - lastMPERF)) * freqP0;
+
+        effFreq_perCore[physical] = effFreq;
+
+        lastAPERF_PerCore[physical] = APERF;
+        lastMPERF_PerCore[physical] = MPERF;
+    }
+
+    void updateCoreEnergy(uint32_t physical){
+        uint64_t msr_value_buf = 0;
+        if(!hardware->readMSR(kMSR_CORE_ENERGY_STAT, &msr_value_buf)) return;
+
+        uint64_t ctsc = hardware->readTSC();
+
+        uint32_t energyDelta = energy_accumulate(&coreEnergy_perCore[physical], msr_value_buf);
+
+        double seconds = (ctsc - lastCoreEnergyTSC_perCore[physical]) / (double)(tscFreq);
+        if(seconds > 0)
+            corePower_perCore[physical] = (float)((energyUnit * energyDelta) / seconds);
+
+        lastCoreEnergyTSC_perCore[physical] = ctsc;
+    }
+
+    float effFreq_perCore[kMaxCPUs] {};
+
+    uint64_t lastMPERF_PerCore[kMaxCPUs] {};
+    uint64_t lastAPERF_PerCore[kMaxCPUs] {};
+    uint64_t deltaAPERF_PerCore[kMaxCPUs] {};
+    uint64_t deltaMPERF_PerCore[kMaxCPUs] {};
+
+    uint64_t instructionDelta_PerCore[kMaxCPUs] {};
+    uint64_t lastInstructionDelta_perCore[kMaxCPUs] {};
+
+    uint64_t lastCoreEnergyTSC_perCore[kMaxCPUs] {};
+    float corePower_perCore[kMaxCPUs] {};
+
+    /**
+     *  Monotonic energy in RAPL units since the service started, never wraps in practice.
+     */
+    energy_counter coreEnergy_perCore[kMaxCPUs] {};
+
+    /**
+     *  Core PMU engine. Each slot holds an event as (unitMask << 16) | eventSelect[11:0],
+     *  0 leaves the counter alone. Deltas are counts over the last tick per logical CPU.
+     */
+    uint32_t pmcEvents[kPMCMaxCounters] {};
+    uint64_t pmcDelta_perCore[kMaxCPUs][kPMCMaxCounters] {};
+    uint32_t pmcConfigGen = 0;
+    bool pmcActive = false;
+
+private:
+    AMDRyzenCPUHardware *hardware = nullptr;
+    uint64_t tscFreq = 1;
+    double energyUnit = 0;
+
+    uint32_t pmcAppliedGen_perCore[kMaxCPUs] {};
+    uint64_t pmcLast_perCore[kMaxCPUs][kPMCMaxCounters] {};
+};
+
+#endif /* AMDRyzenCPUSampler_hpp */
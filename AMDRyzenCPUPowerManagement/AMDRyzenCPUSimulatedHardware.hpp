@@ -0,0 +1,310 @@
+//
+//  AMDRyzenCPUSimulatedHardware.hpp
+//  AMDRyzenCPUPowerManagement
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#ifndef AMDRyzenCPUSimulatedHardware_hpp
+#define AMDRyzenCPUSimulatedHardware_hpp
+
+#include "AMDRyzenCPUHardware.hpp"
+
+/**
+ *  Deterministic machine model behind AMDRyzenCPUHardware, for running the sampling engine,
+ *  the P-state code and the SuperIO drivers without the hardware they were written for.
+ *
+ *  MSRs exist per CPU once set, reading or writing any other one fails like a #GP would.
+ *  Counters advance by a fixed step after every read, the TSC by tscStep. CPU-wide calls run
+ *  the action on each simulated CPU in turn with cpuNumber() reporting it. SMN goes through
+ *  the same index/data pair of the root complex config space the provider uses, port I/O to
+ *  whichever PortDevice claims the port and floats high otherwise. Port accesses are counted,
+ *  claimed or not, as each one costs an LPC cycle on real hardware, and so are config cycles.
+ *
+ *  CPU-wide calls are also accounted the way the native backend runs them: a rendezvous, or a
+ *  cross call that falls back to one, sends an IPI to every other CPU and holds all of them
+ *  with interrupts off until the slowest action is done. A cross call through mp_cpus_call
+ *  only interrupts the CPUs in the mask, each for its own action. Time is counted in MSR
+ *  accesses, which is what the provider's actions spend it on.
+ */
+class AMDRyzenCPUSimulatedHardware : public AMDRyzenCPUHardware {
+
+public:
+    static constexpr uint32_t kMaxCPUs = 256;
+    static constexpr uint32_t kMaxMSRs = 32;
+    static constexpr uint32_t kMaxSMN = 32;
+    static constexpr uint32_t kMaxPortDevices = 4;
+    static constexpr uint32_t kMaxCPUIDLeaves = 8;
+
+    static constexpr uint8_t kSMNIndex = 0x60;
+    static constexpr uint8_t kSMNData = 0x64;
+
+    class PortDevice {
+    public:
+        virtual ~PortDevice() {}
+        virtual uint8_t read8(uint16_t port) = 0;
+        virtual void write8(uint16_t port, uint8_t value) = 0;
+    };
+
+    AMDRyzenCPUSimulatedHardware(uint32_t numCPUs, uint64_t tscStep) :
+    numCPUs(numCPUs < kMaxCPUs ? numCPUs : kMaxCPUs), tscStep(tscStep) {}
+
+    uint32_t getNumCPUs() const { return numCPUs; }
+
+    /**
+     *  Define or overwrite an MSR, step is added to it after each read.
+     */
+    void setMSR(uint32_t cpu, uint32_t addr, uint64_t value, uint64_t step = 0){
+        MSR *msr = findMSR(cpu, addr, true);
+        if(!msr) return;
+        msr->value = value;
+        msr->step = step;
+    }
+
+    uint64_t getMSR(uint32_t cpu, uint32_t addr){
+        MSR *msr = findMSR(cpu, addr, false);
+        return msr ? msr->value : 0;
+    }
+
+    uint32_t getMSRWrites(uint32_t cpu, uint32_t addr){
+        MSR *msr = findMSR(cpu, addr, false);
+        return msr ? msr->writes : 0;
+    }
+
+    void setSMN(uint32_t addr, uint32_t value){
+        for(uint32_t i = 0; i < numSMN; i++){
+            if(smn[i].addr == addr){
+                smn[i].value = value;
+                return;
+            }
+        }
+        if(numSMN < kMaxSMN) smn[numSMN++] = {addr, value};
+    }
+
+    /**
+     *  Same answer on every CPU, leaves never set read as zero.
+     */
+    void setCPUID(uint32_t leaf, uint32_t subleaf, uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx){
+        for(uint32_t i = 0; i < numCPUIDLeaves; i++){
+            if(cpuidLeaves[i].leaf == leaf && cpuidLeaves[i].subleaf == subleaf){
+                cpuidLeaves[i] = {leaf, subleaf, {eax, ebx, ecx, edx}};
+                return;
+            }
+        }
+        if(numCPUIDLeaves < kMaxCPUIDLeaves) cpuidLeaves[numCPUIDLeaves++] = {leaf, subleaf, {eax, ebx, ecx, edx}};
+    }
+
+    void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t *regs){
+        for(uint32_t i = 0; i < 4; i++) regs[i] = 0;
+        for(uint32_t i = 0; i < numCPUIDLeaves; i++){
+            if(cpuidLeaves[i].leaf != leaf || cpuidLeaves[i].subleaf != subleaf) continue;
+            for(uint32_t r = 0; r < 4; r++) regs[r] = cpuidLeaves[i].regs[r];
+        }
+    }
+
+    void attachPortDevice(uint16_t first, uint16_t last, PortDevice *dev){
+        if(numPortDevices < kMaxPortDevices) portDevices[numPortDevices++] = {first, last, dev};
+    }
+
+    void setCurrentCPU(uint32_t cpu){ currentCPU = cpu < numCPUs ? cpu : 0; }
+
+    //Let time pass without anyone reading the TSC, for replaying busy and idle periods.
+    void advanceTSC(uint64_t ticks){ tsc += ticks; }
+
+    uint32_t getPortReads() const { return portReads; }
+    uint32_t getPortWrites() const { return portWrites; }
+
+    void resetPortCounts(){
+        portReads = 0;
+        portWrites = 0;
+    }
+
+    uint32_t getConfigReads() const { return configReads; }
+    uint32_t getConfigWrites() const { return configWrites; }
+
+    void resetConfigCounts(){
+        configReads = 0;
+        configWrites = 0;
+    }
+
+    uint64_t getMSRAccesses() const { return msrAccesses; }
+    uint32_t getIPIs() const { return ipis; }
+    uint64_t getIntrsOffAccesses() const { return intrsOffAccesses; }
+
+    void resetCallCounts(){
+        msrAccesses = 0;
+        ipis = 0;
+        intrsOffAccesses = 0;
+    }
+
+    bool readMSR(uint32_t addr, uint64_t *value) override {
+        msrAccesses++;
+        MSR *msr = findMSR(currentCPU, addr, false);
+        if(!msr) return false;
+        *value = msr->value;
+        msr->value += msr->step;
+        return true;
+    }
+
+    bool writeMSR(uint32_t addr, uint64_t value) override {
+        msrAccesses++;
+        MSR *msr = findMSR(currentCPU, addr, false);
+        if(!msr) return false;
+        msr->value = value;
+        msr->writes++;
+        return true;
+    }
+
+    void readEffectiveFrequencyCounters(uint64_t *aperf, uint64_t *mperf) override {
+        if(!readMSR(0xe8, aperf)) *aperf = 0;
+        if(!readMSR(0xe7, mperf)) *mperf = 0;
+    }
+
+    uint32_t pciConfigRead32(uint8_t offset) override {
+        configReads++;
+        if(offset == kSMNData){
+            for(uint32_t i = 0; i < numSMN; i++)
+                if(smn[i].addr == smnIndex) return smn[i].value;
+            return 0xffffffff;
+        }
+        return offset == kSMNIndex ? smnIndex : 0xffffffff;
+    }
+
+    void pciConfigWrite32(uint8_t offset, uint32_t value) override {
+        configWrites++;
+        if(offset == kSMNIndex) smnIndex = value;
+        else if(offset == kSMNData) setSMN(smnIndex, value);
+    }
+
+    uint8_t portRead8(uint16_t port) override {
+        portReads++;
+        PortDevice *dev = findPortDevice(port);
+        return dev ? dev->read8(port) : 0xff;
+    }
+
+    void portWrite8(uint16_t port, uint8_t value) override {
+        portWrites++;
+        PortDevice *dev = findPortDevice(port);
+        if(dev) dev->write8(port, value);
+    }
+
+    uint64_t readTSC() override {
+        uint64_t now = tsc;
+        tsc += tscStep;
+        return now;
+    }
+
+    int cpuNumber() override { return currentCPU; }
+
+    void rendezvous(void (*action)(void *), void *arg) override {
+        rendezvousNoIntrs(action, arg);
+    }
+
+    void rendezvousNoIntrs(void (*action)(void *), void *arg) override {
+        uint32_t caller = currentCPU;
+        uint64_t slowest = 0;
+        for(uint32_t cpu = 0; cpu < numCPUs; cpu++){
+            currentCPU = cpu;
+            uint64_t start = msrAccesses;
+            action(arg);
+            if(msrAccesses - start > slowest) slowest = msrAccesses - start;
+        }
+        currentCPU = caller;
+
+        ipis += numCPUs - 1;
+        intrsOffAccesses += numCPUs * slowest;
+    }
+
+    void crossCall(const uint64_t *cpuMask, uint32_t words, void (*action)(void *), void *arg) override {
+        uint32_t caller = currentCPU;
+        uint32_t sent = 0;
+        uint64_t slowest = 0, total = 0;
+        for(uint32_t cpu = 0; cpu < numCPUs && cpu / 64 < words; cpu++){
+            if(!(cpuMask[cpu / 64] & (1ULL << (cpu % 64)))) continue;
+            currentCPU = cpu;
+            uint64_t start = msrAccesses;
+            action(arg);
+            if(msrAccesses - start > slowest) slowest = msrAccesses - start;
+            total += msrAccesses - start;
+            if(cpu != caller) sent++;
+        }
+        currentCPU = caller;
+
+        //mp_cpus_call takes a 64 bit mask, past that everyone joins a filtered rendezvous.
+        bool fits = true;
+        for(uint32_t i = 1; i < words; i++) if(cpuMask[i]) fits = false;
+
+        ipis += fits ? sent : numCPUs - 1;
+        intrsOffAccesses += fits ? total : numCPUs * slowest;
+    }
+
+private:
+    struct MSR {
+        uint32_t addr;
+        uint32_t writes;
+        uint64_t value;
+        uint64_t step;
+    };
+
+    struct SMNReg {
+        uint32_t addr;
+        uint32_t value;
+    };
+
+    struct CPUIDLeaf {
+        uint32_t leaf;
+        uint32_t subleaf;
+        uint32_t regs[4];
+    };
+
+    struct PortRange {
+        uint16_t first;
+        uint16_t last;
+        PortDevice *dev;
+    };
+
+    MSR *findMSR(uint32_t cpu, uint32_t addr, bool create){
+        if(cpu >= numCPUs) return nullptr;
+        for(uint32_t i = 0; i < numMSRs[cpu]; i++)
+            if(msrs[cpu][i].addr == addr) return &msrs[cpu][i];
+        if(!create || numMSRs[cpu] == kMaxMSRs) return nullptr;
+
+        MSR *msr = &msrs[cpu][numMSRs[cpu]++];
+        *msr = {addr, 0, 0, 0};
+        return msr;
+    }
+
+    PortDevice *findPortDevice(uint16_t port){
+        for(uint32_t i = 0; i < numPortDevices; i++)
+            if(port >= portDevices[i].first && port <= portDevices[i].last) return portDevices[i].dev;
+        return nullptr;
+    }
+
+    uint32_t numCPUs;
+    uint32_t currentCPU = 0;
+
+    uint64_t tsc = 0;
+    uint64_t tscStep;
+
+    MSR msrs[kMaxCPUs][kMaxMSRs] {};
+    uint32_t numMSRs[kMaxCPUs] {};
+
+    SMNReg smn[kMaxSMN] {};
+    uint32_t numSMN = 0;
+    uint32_t smnIndex = 0;
+
+    CPUIDLeaf cpuidLeaves[kMaxCPUIDLeaves] {};
+    uint32_t numCPUIDLeaves = 0;
+
+    PortRange portDevices[kMaxPortDevices] {};
+    uint32_t numPortDevices = 0;
+    uint32_t portReads = 0;
+    uint32_t portWrites = 0;
+    uint32_t configReads = 0;
+    uint32_t configWrites = 0;
+    uint64_t msrAccesses = 0;
+    uint32_t ipis = 0;
+    uint64_t intrsOffAccesses = 0;
+};
+
+#endif /* AMDRyzenCPUSimulatedHardware_hpp */
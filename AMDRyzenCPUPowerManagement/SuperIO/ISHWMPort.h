@@ -0,0 +1,111 @@
+//
+//  ISHWMPort.h
+//  SMCAMDProcessor
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#ifndef ISHWMPort_h
+#define ISHWMPort_h
+
+#include "ISLPCPort.h"
+
+/**
+ *  Index/data access to a hardware monitor behind an LPC base address.
+ *
+ *  Registers are addressed as (bank << 8) | index. The bank last selected is remembered so
+ *  consecutive accesses to one bank only cost the index write and the data access.
+ *  The BIOS may switch banks behind our back, so drivers call invalidate() before each refresh.
+ */
+class ISHWMPort {
+
+public:
+
+    enum BankScheme {
+        kBankNone,      // Flat 8 bit register space (IT86XX)
+        kBankIndexed,   // Bank number written to a register of the index/data pair (NCT67XX)
+        kBankPage,      // Separate page port, unlocked by writing 0xff first (NCT668X EC)
+    };
+
+    static constexpr uint32_t kMaxBatch = 64;
+
+    ISHWMPort() {}
+
+    ISHWMPort(uint16_t indexPort, uint16_t dataPort, BankScheme scheme, uint16_t bankReg) :
+    indexPort(indexPort), dataPort(dataPort), scheme(scheme), bankReg(bankReg) {}
+
+    void invalidate(){
+        bankValid = false;
+    }
+
+    uint8_t readByte(uint16_t addr){
+        selectBank(addr >> 8);
+        ISLPCPort::writePort(indexPort, addr & 0xff);
+        return ISLPCPort::readPort(dataPort);
+    }
+
+    uint16_t readWord(uint16_t addr){
+        return (readByte(addr) << 8) | readByte(addr + 1);
+    }
+
+    void writeByte(uint16_t addr, uint8_t val){
+        selectBank(addr >> 8);
+        ISLPCPort::writePort(indexPort, addr & 0xff);
+        ISLPCPort::writePort(dataPort, val);
+    }
+
+    /**
+     *  Read count registers, visiting each bank once starting with the current one.
+     *  count must not exceed kMaxBatch, values past it are left untouched.
+     */
+    void readBatch(const uint16_t *addrs, uint8_t *values, uint32_t count){
+        if(count > kMaxBatch) count = kMaxBatch;
+
+        uint64_t pending = count == 64 ? ~0ULL : (1ULL << count) - 1;
+        while(pending){
+            uint8_t bank = addrs[__builtin_ctzll(pending)] >> 8;
+            if(bankValid){
+                for(uint32_t i = 0; i < count; i++){
+                    if((pending & (1ULL << i)) && (addrs[i] >> 8) == curBank){
+                        bank = curBank;
+                        break;
+                    }
+                }
+            }
+
+            for(uint32_t i = 0; i < count; i++){
+                if(!(pending & (1ULL << i)) || (addrs[i] >> 8) != bank) continue;
+
+                values[i] = readByte(addrs[i]);
+                pending &= ~(1ULL << i);
+            }
+        }
+    }
+
+private:
+
+    uint16_t indexPort = 0;
+    uint16_t dataPort = 0;
+    BankScheme scheme = kBankNone;
+    uint16_t bankReg = 0;
+
+    uint8_t curBank = 0;
+    bool bankValid = false;
+
+    void selectBank(uint8_t bank){
+        if(scheme == kBankNone || (bankValid && curBank == bank)) return;
+
+        if(scheme == kBankIndexed){
+            ISLPCPort::writePort(indexPort, bankReg);
+            ISLPCPort::writePort(dataPort, bank);
+        } else {
+            ISLPCPort::writePort(bankReg, 0xff);
+            ISLPCPort::writePort(bankReg, bank);
+        }
+
+        curBank = bank;
+        bankValid = true;
+    }
+};
+
+#endif /* ISHWMPort_h */
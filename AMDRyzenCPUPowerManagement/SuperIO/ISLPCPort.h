@@ -11,6 +11,8 @@
 
 #include <mach/mach_types.h>
 
+#include "../AMDRyzenCPUHardware.hpp"
+
 class ISLPCPort {
     
     
@@ -25,9 +27,17 @@ public:
     static constexpr i386_ioport_t kVALUE_PORTS[] = {0x4F, 0x2F};
     
     
+    static uint8_t readPort(i386_ioport_t port){
+        return AMDRyzenCPUHardware::shared()->portRead8(port);
+    }
+    
+    static void writePort(i386_ioport_t port, uint8_t val){
+        AMDRyzenCPUHardware::shared()->portWrite8(port, val);
+    }
+    
     static uint8_t readByte(int portSelect, uint8_t reg){
-        outb(kREGISTER_PORTS[portSelect], reg);
-        return inb(kVALUE_PORTS[portSelect]);
+        writePort(kREGISTER_PORTS[portSelect], reg);
+        return readPort(kVALUE_PORTS[portSelect]);
     }
     
     static uint16_t readWord(int portSelect, uint8_t reg){
@@ -36,13 +46,13 @@ public:
     }
     
     static void writeByte(int portSelect, uint8_t reg, uint8_t val){
-        outb(kREGISTER_PORTS[portSelect], reg);
-        outb(kVALUE_PORTS[portSelect], val);
+        writePort(kREGISTER_PORTS[portSelect], reg);
+        writePort(kVALUE_PORTS[portSelect], val);
     }
     
     static void select(int portSelect, uint8_t devNum){
-        outb(kREGISTER_PORTS[portSelect], kCHIP_DEV_SEL_REG);
-        outb(kVALUE_PORTS[portSelect], devNum);
+        writePort(kREGISTER_PORTS[portSelect], kCHIP_DEV_SEL_REG);
+        writePort(kVALUE_PORTS[portSelect], devNum);
     }
 };
 
@@ -0,0 +1,99 @@
+//
+//  ISSuperIOChipDesc.hpp
+//  AMDRyzenCPUPowerManagement
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#ifndef ISSuperIOChipDesc_hpp
+#define ISSuperIOChipDesc_hpp
+
+#include "ISHWMPort.h"
+
+#define ISSUPERIO_MAX_FANS 16
+#define ISSUPERIO_MAX_VOLTAGES 16
+#define ISSUPERIO_MAX_TEMPS 8
+
+/**
+ *  Data driven description of the SuperIO chips ISSuperIOGeneric knows how to drive.
+ *
+ *  A family holds everything shared by chips answering the same entry sequence: how to open
+ *  and close the configuration port, where the hardware monitor lives, its fan registers and
+ *  its voltage and temperature channels.
+ *  A chip entry only adds what differs within a family. Supporting a new chip that follows an
+ *  existing register layout is one line in ISSuperIOChipTable.cpp.
+ */
+
+enum ISSuperIORPMDecode : uint8_t {
+    kRPMDirect,         // Register pair holds the RPM (NCT67XX, NCT668X)
+    kRPMITEDivisor,     // Register pair holds a tach count, RPM = 1.35e6 / (count * 2) (IT86XX)
+};
+
+enum ISSuperIOControl : uint8_t {
+    kControlModeReg,    // Clear modeMask in the mode register then write pwmCmd (NCT67XX)
+    kControlECRequest,  // Write pwmCmd between a request and a done on ctrlReg (NCT668X)
+    kControlITE,        // Like kControlModeReg plus a per fan bit in ctrlReg (IT86XX)
+};
+
+struct ISSuperIOFamilyDesc {
+    const char *name;
+
+    //Per ISLPCPort::kREGISTER_PORTS entry.
+    uint8_t entry[2][4];
+    uint8_t entryLen;
+    uint8_t exit[2][3];
+    uint8_t exitLen[2];
+
+    uint16_t idMask;        // Applied to (id << 8) | revision before matching
+    uint8_t ldn;            // Hardware monitor logical device
+    uint16_t addrMask;      // Applied to the base address
+    bool verifyAddr;        // Read the base address again after 100ms
+    uint8_t lockReg;        // Config register holding the chip's lockMask, 0 for none
+
+    ISHWMPort::BankScheme bank;
+    uint8_t indexOffset;
+    uint8_t dataOffset;
+    uint8_t bankReg;        // Register for kBankIndexed, port offset for kBankPage
+
+    ISSuperIORPMDecode rpmDecode;
+    ISSuperIOControl control;
+    uint16_t ctrlReg;
+    uint8_t modeMask;       // Mode register bits set while the chip controls the fan
+
+    //0 where a fan has no such register. Without mode registers fans always report auto.
+    uint16_t rpmLoReg[ISSUPERIO_MAX_FANS];
+    uint16_t rpmHiReg[ISSUPERIO_MAX_FANS];
+    uint16_t pwmReg[ISSUPERIO_MAX_FANS];
+    uint16_t pwmCmdReg[ISSUPERIO_MAX_FANS];
+    uint16_t modeReg[ISSUPERIO_MAX_FANS];
+
+    const char *fanNames[ISSUPERIO_MAX_FANS];
+
+    //Voltages read as one byte times voltMV, temperatures as one signed byte in Celsius.
+    //What is wired to a VIN or AUXTIN/TMPIN (VRM, chipset...) is up to the board.
+    uint16_t voltReg[ISSUPERIO_MAX_VOLTAGES];
+    uint8_t voltMV[ISSUPERIO_MAX_VOLTAGES];
+    const char *voltNames[ISSUPERIO_MAX_VOLTAGES];
+
+    uint16_t tempReg[ISSUPERIO_MAX_TEMPS];
+    const char *tempNames[ISSUPERIO_MAX_TEMPS];
+};
+
+struct ISSuperIOChipDesc {
+    uint16_t id;
+    const char *name;
+    uint8_t family;         // Index into ISSuperIOFamilies
+    uint8_t numFans;
+    uint8_t numVoltages;    // 0 where the family's channel map does not apply
+    uint8_t numTemps;
+    uint8_t lockMask;       // Bits cleared in the family's lockReg
+    bool secondary;         // Only used when no other chip is found, see ISSuperIOGeneric::getDevice
+};
+
+extern const ISSuperIOFamilyDesc ISSuperIOFamilies[];
+extern const uint32_t ISSuperIOFamilyCount;
+
+extern const ISSuperIOChipDesc ISSuperIOChips[];
+extern const uint32_t ISSuperIOChipCount;
+
+#endif /* ISSuperIOChipDesc_hpp */
@@ -0,0 +1,156 @@
+//
+//  ISSuperIOChipTable.cpp
+//  AMDRyzenCPUPowerManagement
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#include "ISSuperIOChipDesc.hpp"
+
+enum {
+    kFamilyNCT668X,
+    kFamilyNCT67XX,
+    kFamilyIT86XX,
+};
+
+//Probed in this order, NCT668X first as it also answers the NCT67XX entry sequence.
+const ISSuperIOFamilyDesc ISSuperIOFamilies[] = {
+    {
+        .name = "NCT668X",
+        .entry = {{0x87, 0x87}, {0x87, 0x87}},
+        .entryLen = 2,
+        //668X needs additional step to close port.
+        .exit = {{0xaa, 0x02, 0x02}, {0xaa, 0x02, 0x02}},
+        .exitLen = {3, 3},
+        .idMask = 0xfff0,
+        .ldn = 0x0b,
+        .addrMask = (uint16_t)~7,
+        .verifyAddr = false,
+        .lockReg = 0,
+        .bank = ISHWMPort::kBankPage,
+        .indexOffset = 1,
+        .dataOffset = 2,
+        .bankReg = 0,
+        .rpmDecode = kRPMDirect,
+        .control = kControlECRequest,
+        .ctrlReg = 0xa01,
+        .modeMask = 0,
+        .rpmLoReg = {0x141, 0x143, 0x145, 0x147, 0x149, 0x14b, 0x14d, 0x14f,
+                     0x151, 0x153, 0x155, 0x157, 0x159, 0x15b, 0x15d, 0x15f},
+        .rpmHiReg = {0x140, 0x142, 0x144, 0x146, 0x148, 0x14a, 0x14c, 0x14e,
+                     0x150, 0x152, 0x154, 0x156, 0x158, 0x15a, 0x15c, 0x15e},
+        .pwmReg = {0x160, 0x161, 0x162, 0x163, 0x164, 0x165, 0x166, 0x167,
+                   0x168, 0x169, 0x16a, 0x16b, 0x16c, 0x16d, 0x16e, 0x16f},
+        .pwmCmdReg = {0xa28, 0xa29, 0xa2a, 0xa2b, 0xa2c, 0xa2d, 0xa2e, 0xa2f,
+                      0xa30, 0xa31, 0xa32, 0xa33, 0xa34, 0xa35, 0xa36, 0xa37},
+        .modeReg = {},
+        //Headers behind the EC differ per board, number them in register order.
+        .fanNames = {"Fan 1", "Fan 2", "Fan 3", "Fan 4", "Fan 5", "Fan 6", "Fan 7", "Fan 8",
+                     "Fan 9", "Fan 10", "Fan 11", "Fan 12", "Fan 13", "Fan 14", "Fan 15", "Fan 16"},
+        //EC monitor channels are configurable, not mapped yet.
+        .voltReg = {},
+        .voltMV = {},
+        .voltNames = {},
+        .tempReg = {},
+        .tempNames = {},
+    },
+    {
+        .name = "NCT67XX",
+        .entry = {{0x87, 0x87}, {0x87, 0x87}},
+        .entryLen = 2,
+        .exit = {{0xaa}, {0xaa}},
+        .exitLen = {1, 1},
+        .idMask = 0xffff,
+        .ldn = 0x0b,
+        .addrMask = 0xffff,
+        .verifyAddr = true,
+        .lockReg = 0x28,
+        .bank = ISHWMPort::kBankIndexed,
+        .indexOffset = 5,
+        .dataOffset = 6,
+        .bankReg = 0x4e,
+        .rpmDecode = kRPMDirect,
+        .control = kControlModeReg,
+        .ctrlReg = 0,
+        .modeMask = 0xff,
+        .rpmLoReg = {0x4c1, 0x4c3, 0x4c5, 0x4c7, 0x4c9, 0x4cb, 0x4cf},
+        .rpmHiReg = {0x4c0, 0x4c2, 0x4c4, 0x4c6, 0x4c8, 0x4ca, 0x4ce},
+        .pwmReg = {0x109, 0x209, 0x309, 0x809, 0x909, 0xa09, 0xb09},
+        .pwmCmdReg = {0x109, 0x209, 0x309, 0x809, 0x909, 0xa09, 0xb09},
+        .modeReg = {0x102, 0x202, 0x302, 0x802, 0x902, 0xa02, 0xb02},
+        .fanNames = {"Pump", "CPU", "AUX_0", "AUX_1", "AUX_2", "AUX_3", "PECI"},
+        //NCT6779D and later layout.
+        .voltReg = {0x480, 0x481, 0x482, 0x483, 0x484, 0x485, 0x486, 0x487,
+                    0x488, 0x489, 0x48a, 0x48b, 0x48c, 0x48d, 0x48e},
+        .voltMV = {8, 8, 16, 16, 8, 8, 8, 16, 16, 8, 8, 8, 8, 8, 8},
+        .voltNames = {"CPUVCORE", "VIN1", "AVSB", "3VCC", "VIN0", "VIN8", "VIN4", "3VSB",
+                      "VBAT", "VTT", "VIN5", "VIN6", "VIN2", "VIN3", "VIN7"},
+        .tempReg = {0x490, 0x491, 0x492, 0x493, 0x494, 0x495},
+        .tempNames = {"SYSTIN", "CPUTIN", "AUXTIN0", "AUXTIN1", "AUXTIN2", "AUXTIN3"},
+    },
+    {
+        .name = "IT86XX",
+        //The last key byte depends on the port, 0x4E is never closed.
+        .entry = {{0x87, 0x01, 0x55, 0xaa}, {0x87, 0x01, 0x55, 0x55}},
+        .entryLen = 4,
+        .exit = {{}, {0x02}},
+        .exitLen = {0, 1},
+        .idMask = 0xffff,
+        .ldn = 0x04,
+        .addrMask = 0xffff,
+        .verifyAddr = true,
+        .lockReg = 0,
+        .bank = ISHWMPort::kBankNone,
+        .indexOffset = 5,
+        .dataOffset = 6,
+        .bankReg = 0,
+        .rpmDecode = kRPMITEDivisor,
+        .control = kControlITE,
+        .ctrlReg = 0x13,
+        .modeMask = 0x80,
+        .rpmLoReg = {0x0d, 0x0e, 0x0f, 0x80, 0x82},
+        .rpmHiReg = {0x18, 0x19, 0x1a, 0x81, 0x83},
+        .pwmReg = {0x63, 0x6b, 0x73, 0x7b, 0xa3},
+        .pwmCmdReg = {0x63, 0x6b, 0x73, 0x7b, 0xa3},
+        .modeReg = {0x15, 0x16, 0x17, 0x7f, 0xa7},
+        .fanNames = {"CPU Fan", "System 1 Fan", "System 2 Fan", "PCH Fan", "CPU OPT Fan"},
+        //12mV ADC, 3VSB and VBAT are divided by 2 inside the chip.
+        .voltReg = {0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28},
+        .voltMV = {12, 12, 12, 12, 12, 12, 12, 24, 24},
+        .voltNames = {"VIN0", "VIN1", "VIN2", "VIN3", "VIN4", "VIN5", "VIN6", "3VSB", "VBAT"},
+        .tempReg = {0x29, 0x2a, 0x2b},
+        .tempNames = {"TMPIN1", "TMPIN2", "TMPIN3"},
+    },
+};
+
+const uint32_t ISSuperIOFamilyCount = sizeof(ISSuperIOFamilies) / sizeof(ISSuperIOFamilies[0]);
+
+const ISSuperIOChipDesc ISSuperIOChips[] = {
+    //  id      name         family          fans volts temps lock  secondary
+    { 0xb270, "NCT6681",   kFamilyNCT668X, 16,  0,    0,    0,    false },
+    { 0xc730, "NCT6683",   kFamilyNCT668X, 16,  0,    0,    0,    false },
+
+    { 0xc452, "NCT610XD",  kFamilyNCT67XX, 6,   0,    0,    0,    false },
+    { 0xb470, "NCT6771F",  kFamilyNCT67XX, 6,   0,    0,    0,    false },
+    { 0xc330, "NCT6776F",  kFamilyNCT67XX, 6,   0,    0,    0,    false },
+    { 0xc560, "NCT6779D",  kFamilyNCT67XX, 5,   15,   6,    0,    false },
+    { 0xc803, "NCT6791D",  kFamilyNCT67XX, 6,   15,   6,    0x10, false },
+    { 0xc911, "NCT6792D",  kFamilyNCT67XX, 6,   15,   6,    0x10, false },
+    { 0xc913, "NCT6792DA", kFamilyNCT67XX, 6,   15,   6,    0x10, false },
+    { 0xd121, "NCT6793D",  kFamilyNCT67XX, 6,   15,   6,    0x10, false },
+    { 0xd352, "NCT6795D",  kFamilyNCT67XX, 6,   15,   6,    0x10, false },
+    { 0xd423, "NCT6796D",  kFamilyNCT67XX, 6,   15,   6,    0x10, false },
+    { 0xd42a, "NCT6796DR", kFamilyNCT67XX, 6,   15,   6,    0x10, false },
+    { 0xd451, "NCT6797D",  kFamilyNCT67XX, 7,   15,   6,    0x10, false },
+    { 0xd42b, "NCT6798D",  kFamilyNCT67XX, 7,   15,   6,    0x10, false },
+    { 0xd802, "NCT6799D",  kFamilyNCT67XX, 7,   15,   6,    0x10, false },
+
+    { 0x8665, "IT8665E",   kFamilyIT86XX,  5,   9,    3,    0,    false },
+    { 0x8686, "IT8686E",   kFamilyIT86XX,  5,   9,    3,    0,    false },
+    { 0x8688, "IT8688E",   kFamilyIT86XX,  5,   9,    3,    0,    false },
+    { 0x8689, "IT8689E",   kFamilyIT86XX,  5,   9,    3,    0,    false },
+    //Usually sits next to an IT8688E/IT8689E driving the remaining headers.
+    { 0x8733, "IT8792E",   kFamilyIT86XX,  3,   9,    3,    0,    true  },
+};
+
+const uint32_t ISSuperIOChipCount = sizeof(ISSuperIOChips) / sizeof(ISSuperIOChips[0]);
@@ -0,0 +1,288 @@
+//
+//  ISSuperIOGeneric.cpp
+//  AMDRyzenCPUPowerManagement
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#include "ISSuperIOGeneric.hpp"
+
+#define EC_FAN_CFG_REQ      0x80
+#define EC_FAN_CFG_DONE     0x40
+
+//Every refresh reads its registers in one batch, readBatch stops at kMaxBatch.
+static_assert(ISSUPERIO_MAX_FANS * 2 <= ISHWMPort::kMaxBatch, "fan registers exceed one batch");
+static_assert(ISSUPERIO_MAX_VOLTAGES + ISSUPERIO_MAX_TEMPS <= ISHWMPort::kMaxBatch, "sensor registers exceed one batch");
+
+ISSuperIOGeneric::ISSuperIOGeneric(const ISSuperIOFamilyDesc *family, const ISSuperIOChipDesc *chip,
+                                   uint16_t addr) : family(family), chip(chip){
+    chipAddr = addr;
+    hwm = ISHWMPort(chipAddr + family->indexOffset, chipAddr + family->dataOffset, family->bank,
+                    family->bank == ISHWMPort::kBankPage ? chipAddr + family->bankReg : family->bankReg);
+
+    activeFansOnSystem = chip->numFans < ISSUPERIO_MAX_FANS ? chip->numFans : ISSUPERIO_MAX_FANS;
+    numVoltages = chip->numVoltages < ISSUPERIO_MAX_VOLTAGES ? chip->numVoltages : ISSUPERIO_MAX_VOLTAGES;
+    numTemperatures = chip->numTemps < ISSUPERIO_MAX_TEMPS ? chip->numTemps : ISSUPERIO_MAX_TEMPS;
+
+    //backup default ctrl mode
+    hwm.invalidate();
+    for (int i = 0; i < activeFansOnSystem; i++) {
+        fanDefaultControlMode[i] = family->modeReg[i] ? hwm.readByte(family->modeReg[i]) : 0;
+        fanDefaultPWMCmd[i] = hwm.readByte(family->pwmCmdReg[i]);
+    }
+}
+
+void ISSuperIOGeneric::enterConfig(const ISSuperIOFamilyDesc *family, int portSel){
+    for (int i = 0; i < family->entryLen; i++)
+        ISLPCPort::writePort(ISLPCPort::kREGISTER_PORTS[portSel], family->entry[portSel][i]);
+}
+
+void ISSuperIOGeneric::exitConfig(const ISSuperIOFamilyDesc *family, int portSel){
+    for (int i = 0; i < family->exitLen[portSel]; i++)
+        ISLPCPort::writePort(ISLPCPort::kREGISTER_PORTS[portSel], family->exit[portSel][i]);
+}
+
+bool ISSuperIOGeneric::probe(uint32_t familyIdx, int portSel, bool secondary,
+                             uint16_t *chipIntel, const ISSuperIOChipDesc **chip){
+    const ISSuperIOFamilyDesc *family = &ISSuperIOFamilies[familyIdx];
+
+    enterConfig(family, portSel);
+
+    uint8_t deviceID = ISLPCPort::readByte(portSel, ISLPCPort::kCHIP_ID_REG);
+    uint8_t revision = ISLPCPort::readByte(portSel, ISLPCPort::kCHIP_REVISION_REG);
+    *chipIntel = (deviceID << 8) | revision;
+
+    for (uint32_t i = 0; i < ISSuperIOChipCount; i++) {
+        const ISSuperIOChipDesc *desc = &ISSuperIOChips[i];
+        if(desc->family != familyIdx || desc->secondary != secondary) continue;
+        if(desc->id != (*chipIntel & family->idMask)) continue;
+
+        //Leave the port open for the caller.
+        *chip = desc;
+        return true;
+    }
+
+    exitConfig(family, portSel);
+    return false;
+}
+
+ISSuperIOGeneric* ISSuperIOGeneric::getDevice(uint16_t *chipIntel){
+
+    //Secondary chips are only picked when nothing else answers, so a board carrying both an
+    //IT8688E and an IT8792E keeps driving the primary one whatever port each sits on.
+    for (int pass = 0; pass < 2; pass++) {
+        for (uint32_t f = 0; f < ISSuperIOFamilyCount; f++) {
+            const ISSuperIOFamilyDesc *family = &ISSuperIOFamilies[f];
+            const ISSuperIOChipDesc *chip = nullptr;
+            int portSel = 0;
+            IOLog("probe %s\n", family->name);
+
+            for (; portSel < 2; portSel++) {
+                if(probe(f, portSel, pass == 1, chipIntel, &chip)) break;
+            }
+            if(!chip) continue;
+
+            IOLog("%s chip identified\n", chip->name);
+            IOLog("SMC Chip id:%X revision:%X \n", *chipIntel >> 8, *chipIntel & 0xff);
+            ISLPCPort::select(portSel, family->ldn);
+
+            uint16_t devAddr = ISLPCPort::readWord(portSel, ISLPCPort::kBASE_ADDRESS_REGISTER) & family->addrMask;
+
+            //verify addr
+            if(family->verifyAddr){
+                IOSleep(100);
+                if((ISLPCPort::readWord(portSel, ISLPCPort::kBASE_ADDRESS_REGISTER) & family->addrMask) != devAddr){
+                    IOLog("%s address verify failed\n", chip->name);
+                }
+            }
+
+            IOLog("Chip address: 0x%X\n", devAddr);
+
+            //Now that the present of chip is confirmed, disable IO address space lock.
+            if(family->lockReg && chip->lockMask){
+                uint8_t conf = ISLPCPort::readByte(portSel, family->lockReg);
+                if(conf & chip->lockMask){
+                    ISLPCPort::writeByte(portSel, family->lockReg, conf & ~chip->lockMask);
+                }
+            }
+
+            exitConfig(family, portSel);
+
+            return new ISSuperIOGeneric(family, chip, devAddr);
+        }
+    }
+
+    return nullptr;
+}
+
+int ISSuperIOGeneric::getNumberOfFans(){
+    return activeFansOnSystem;
+}
+
+const char *ISSuperIOGeneric::getReadableStringForFan(int fan){
+    if(fan < 0 || fan >= activeFansOnSystem) return nullptr;
+    return family->fanNames[fan];
+}
+
+uint32_t ISSuperIOGeneric::getRPMForFan(int fan){
+    if(fan < 0 || fan >= activeFansOnSystem) return 0;
+    return fanRPMs[fan];
+}
+
+bool ISSuperIOGeneric::getFanAutoControlMode(int fan){
+    if(fan < 0 || fan >= activeFansOnSystem) return 0;
+    return fanControlMode[fan] != 0;
+}
+
+uint8_t ISSuperIOGeneric::getFanThrottle(int fan){
+    if(fan < 0 || fan >= activeFansOnSystem) return 0;
+    return fanThrottles[fan];
+}
+
+void ISSuperIOGeneric::updateFanRPMS(){
+    uint16_t regs[ISSUPERIO_MAX_FANS * 2];
+    uint8_t vals[ISSUPERIO_MAX_FANS * 2];
+
+    for (int i = 0; i < activeFansOnSystem; i++) {
+        regs[i * 2] = family->rpmHiReg[i];
+        regs[i * 2 + 1] = family->rpmLoReg[i];
+    }
+
+    hwm.invalidate();
+    hwm.readBatch(regs, vals, activeFansOnSystem * 2);
+
+    for (int i = 0; i < activeFansOnSystem; i++) {
+        int value = (vals[i * 2] << 8) | vals[i * 2 + 1];
+
+        switch (family->rpmDecode) {
+            case kRPMITEDivisor:
+                fanRPMs[i] = (value > 0x3f && value < 0xffff) ? 1.35e6f / (value * 2) : 0;
+                break;
+
+            default:
+                fanRPMs[i] = value;
+                break;
+        }
+    }
+}
+
+void ISSuperIOGeneric::updateFanControl(){
+    uint16_t regs[ISSUPERIO_MAX_FANS * 2];
+    uint8_t vals[ISSUPERIO_MAX_FANS * 2];
+    int modeIdx[ISSUPERIO_MAX_FANS];
+    int count = 0;
+
+    for (int i = 0; i < activeFansOnSystem; i++) {
+        regs[count++] = family->pwmReg[i];
+
+        modeIdx[i] = -1;
+        if(family->modeReg[i]){
+            modeIdx[i] = count;
+            regs[count++] = family->modeReg[i];
+        }
+    }
+
+    hwm.invalidate();
+    hwm.readBatch(regs, vals, count);
+
+    for (int i = 0, r = 0; i < activeFansOnSystem; i++, r++) {
+        fanThrottles[i] = vals[r];
+
+        //Chips without mode registers only report their automatic control.
+        fanControlMode[i] = 1;
+        if(modeIdx[i] >= 0){
+            r = modeIdx[i];
+            fanControlMode[i] = vals[r] & family->modeMask;
+        }
+    }
+}
+
+void ISSuperIOGeneric::overrideFanControl(int fan, uint8_t thr){
+    if(fan < 0 || fan >= activeFansOnSystem) return;
+    hwm.invalidate();
+
+    if(family->control == kControlECRequest){
+        hwm.writeByte(family->ctrlReg, EC_FAN_CFG_REQ);
+        IOSleep(2);
+        hwm.writeByte(family->pwmCmdReg[fan], thr);
+        hwm.writeByte(family->ctrlReg, EC_FAN_CFG_DONE);
+        return;
+    }
+
+    if(family->control == kControlITE)
+        hwm.writeByte(family->ctrlReg, hwm.readByte(family->ctrlReg) | (1 << fan));
+
+    hwm.writeByte(family->modeReg[fan], fanDefaultControlMode[fan] & ~family->modeMask);
+    hwm.writeByte(family->pwmCmdReg[fan], thr);
+}
+
+void ISSuperIOGeneric::setDefaultFanControl(int fan){
+    if(fan < 0 || fan >= activeFansOnSystem) return;
+    hwm.invalidate();
+
+    switch (family->control) {
+        case kControlModeReg:
+            hwm.writeByte(family->modeReg[fan], fanDefaultControlMode[fan]);
+            break;
+
+        case kControlITE:
+            //Fan 0 only goes back to auto mode when the main control register is switched twice.
+            hwm.writeByte(family->ctrlReg, hwm.readByte(family->ctrlReg) ^ (1 << fan));
+            hwm.writeByte(family->ctrlReg, hwm.readByte(family->ctrlReg) ^ (1 << fan));
+            hwm.writeByte(family->modeReg[fan], fanDefaultControlMode[fan]);
+            hwm.writeByte(family->pwmCmdReg[fan], fanDefaultPWMCmd[fan]);
+            break;
+
+        default:
+            break;
+    }
+}
+
+int ISSuperIOGeneric::getNumberOfVoltages(){
+    return numVoltages;
+}
+
+const char *ISSuperIOGeneric::getReadableStringForVoltage(int idx){
+    if(idx < 0 || idx >= numVoltages) return nullptr;
+    return family->voltNames[idx];
+}
+
+float ISSuperIOGeneric::getVoltage(int idx){
+    if(idx < 0 || idx >= numVoltages) return 0;
+    return voltages[idx];
+}
+
+int ISSuperIOGeneric::getNumberOfTemperatures(){
+    return numTemperatures;
+}
+
+const char *ISSuperIOGeneric::getReadableStringForTemperature(int idx){
+    if(idx < 0 || idx >= numTemperatures) return nullptr;
+    return family->tempNames[idx];
+}
+
+float ISSuperIOGeneric::getTemperature(int idx){
+    if(idx < 0 || idx >= numTemperatures) return 0;
+    return temperatures[idx];
+}
+
+void ISSuperIOGeneric::updateSensors(){
+    uint16_t regs[ISSUPERIO_MAX_VOLTAGES + ISSUPERIO_MAX_TEMPS];
+    uint8_t vals[ISSUPERIO_MAX_VOLTAGES + ISSUPERIO_MAX_TEMPS];
+    int count = 0;
+
+    if(!numVoltages && !numTemperatures) return;
+
+    for (int i = 0; i < numVoltages; i++)
+        regs[count++] = family->voltReg[i];
+    for (int i = 0; i < numTemperatures; i++)
+        regs[count++] = family->tempReg[i];
+
+    hwm.invalidate();
+    hwm.readBatch(regs, vals, count);
+
+    for (int i = 0; i < numVoltages; i++)
+        voltages[i] = vals[i] * family->voltMV[i] / 1000.0f;
+    for (int i = 0; i < numTemperatures; i++)
+        temperatures[i] = (int8_t)vals[numVoltages + i];
+}
@@ -0,0 +1,84 @@
+//
+//  ISSuperIOGeneric.hpp
+//  AMDRyzenCPUPowerManagement
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#ifndef ISSuperIOGeneric_hpp
+#define ISSuperIOGeneric_hpp
+
+#include <IOKit/IOLib.h>
+
+#include <architecture/i386/pio.h>
+
+#include "ISLPCPort.h"
+#include "ISHWMPort.h"
+#include "ISSuperIOChipDesc.hpp"
+#include "ISSuperIOSMCFamily.hpp"
+
+/**
+ *  Drives any chip listed in ISSuperIOChipTable.cpp by interpreting its description.
+ */
+class ISSuperIOGeneric : public ISSuperIOSMCFamily {
+
+
+public:
+
+    static ISSuperIOGeneric* getDevice(uint16_t *chipIntel);
+
+
+    ISSuperIOGeneric(const ISSuperIOFamilyDesc *family, const ISSuperIOChipDesc *chip, uint16_t addr);
+
+    int fanRPMs[ISSUPERIO_MAX_FANS];
+    uint8_t fanThrottles[ISSUPERIO_MAX_FANS];
+    uint8_t fanControlMode[ISSUPERIO_MAX_FANS];
+
+    int activeFansOnSystem = 0;
+
+    float voltages[ISSUPERIO_MAX_VOLTAGES];
+    float temperatures[ISSUPERIO_MAX_TEMPS];
+
+    int numVoltages = 0;
+    int numTemperatures = 0;
+
+    int getNumberOfFans() override;
+    const char *getReadableStringForFan(int fan) override;
+
+    uint32_t getRPMForFan(int fan) override;
+    bool getFanAutoControlMode(int fan) override;
+    uint8_t getFanThrottle(int fan) override;
+
+    void updateFanRPMS() override;
+    void updateFanControl() override;
+
+    void overrideFanControl(int fan, uint8_t thr) override;
+    void setDefaultFanControl(int fan) override;
+
+    int getNumberOfVoltages() override;
+    const char *getReadableStringForVoltage(int idx) override;
+    float getVoltage(int idx) override;
+
+    int getNumberOfTemperatures() override;
+    const char *getReadableStringForTemperature(int idx) override;
+    float getTemperature(int idx) override;
+
+    void updateSensors() override;
+
+private:
+
+    static bool probe(uint32_t familyIdx, int portSel, bool secondary,
+                      uint16_t *chipIntel, const ISSuperIOChipDesc **chip);
+    static void enterConfig(const ISSuperIOFamilyDesc *family, int portSel);
+    static void exitConfig(const ISSuperIOFamilyDesc *family, int portSel);
+
+    const ISSuperIOFamilyDesc *family;
+    const ISSuperIOChipDesc *chip;
+
+    uint16_t chipAddr = 0;
+    ISHWMPort hwm;
+    uint8_t fanDefaultControlMode[ISSUPERIO_MAX_FANS];
+    uint8_t fanDefaultPWMCmd[ISSUPERIO_MAX_FANS];
+};
+
+#endif /* ISSuperIOGeneric_hpp */
@@ -27,6 +27,20 @@ public:
     virtual void overrideFanControl(int fan, uint8_t thr);
     virtual void setDefaultFanControl(int fan);
     
+    /**
+     *  Hardware monitor voltage (Volts at the pin, internal dividers applied) and
+     *  temperature (Celsius) channels, refreshed together by updateSensors.
+     */
+    virtual int getNumberOfVoltages();
+    virtual const char *getReadableStringForVoltage(int idx);
+    virtual float getVoltage(int idx);
+    
+    virtual int getNumberOfTemperatures();
+    virtual const char *getReadableStringForTemperature(int idx);
+    virtual float getTemperature(int idx);
+    
+    virtual void updateSensors();
+    
 
 };
 
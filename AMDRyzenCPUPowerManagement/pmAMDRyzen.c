@@ -10,20 +10,22 @@
 
 
 
-x86_lcpu_t *pmRyzen_cpunum_to_lcpu[XNU_MAX_CPU];
+x86_lcpu_t **pmRyzen_cpunum_to_lcpu = NULL;
 
 void *pmRyzen_io_service_handle;
 
-pmProcessor_t pmRyzen_cpus[XNU_MAX_CPU];
+pmProcessor_t *pmRyzen_cpus = NULL;
+uint32_t pmRyzen_num_slots = 0;
 uint64_t pmRyzen_tsc_freq;
 uint64_t pmRyzen_effective_timetsc;
 
+uint32_t pmRyzen_num_pkgs;
 uint32_t pmRyzen_num_phys;
 uint32_t pmRyzen_num_logi;
+uint32_t pmRyzen_num_ccx;
+
+pmRyzenCCX_t *pmRyzen_ccx = NULL;
 
-uint64_t pmRyzen_exit_idle_c;
-uint64_t pmRyzen_exit_idle_ipi_c;
-uint64_t pmRyzen_exit_idle_false_c;
 
 uint64_t pmRyzen_p_sdtsc;
 uint64_t pmRyzen_p_sutsc;
@@ -31,6 +33,17 @@ uint64_t pmRyzen_p_sutsc;
 uint32_t pmRyzen_hpcpus = 0;
 uint32_t pmRyzen_pstatelimit;
 
+uint32_t pmRyzen_governor = PMRYZEN_GOV_HEURISTIC;
+uint64_t pmRyzen_gov_latency_tsc;
+
+boolean_t pmRyzen_trace_enabled = false;
+AMDRyzenTraceRecord *pmRyzen_trace_buf = NULL;
+
+uint64_t pmRyzen_hf_interval_tsc = 0;
+uint32_t pmRyzen_hf_gen = 0;
+//Starts past the zeroed per-CPU epoch so the first sample resets ratio_min.
+uint32_t pmRyzen_hf_epoch = 1;
+
 void(*pmRyzen_pmUnRegister)(pmDispatch_t*) = 0;
 void(*pmRyzen_cpu_NMI)(int) = 0;
 void(*pmRyzen_NMI_enabled)(boolean_t) = 0;
@@ -97,7 +110,7 @@ pmDispatch_t pmRyzen_cpuFuncs = {
     .pmThreadTellUrgency = 0,
     .pmActiveRTThreads = 0,
     .pmInterruptPrewakeApplicable = 0,
-    .pmThreadGoingOffCore = 0,
+    .pmThreadGoingOffCore = &pmRyzen_thread_off_core,
 };
 
 void pmRyzen_init_PState(){
@@ -107,28 +120,50 @@ void pmRyzen_init_PState(){
     uint64_t p1 = pmRyzen_rdmsr_safe(pmRyzen_io_service_handle, MSR_PSTATE_0 + 1);
     uint64_t p1fid = (uint64_t)((p0spd * 0.80F) / 200.0F * (float)((p1 >> 8) & 0x1f));
     
-    wrmsr64(MSR_PSTATE_0 + 1, (p1 & ~0xFFULL) | p1fid | (1ULL << 63));
+    pmRyzen_wrmsr_safe(pmRyzen_io_service_handle, MSR_PSTATE_0 + 1, (p1 & ~0xFFULL) | p1fid | (1ULL << 63));
 }
 
-inline void set_PState(pmProcessor_t *cpu, uint8_t state){
-    if(pmRyzen_pstatelimit == 0) return;
-    state = min(pmRyzen_pstatelimit, state);
-    if(cpu->PState == state) return;
-    
+void write_PState(pmProcessor_t *cpu, uint8_t state){
     boolean_t from_hpstate = !cpu->PState;
     
     pmRyzen_wrmsr_safe(pmRyzen_io_service_handle, MSR_PSTATE_CTL, state);
     cpu->PState = state;
     
-    if(!state){
-        __asm__ volatile("lock incq (%0)"::"r"(&pmRyzen_hpcpus):"memory");
-    } else if(from_hpstate) {
-        __asm__ volatile("lock decq (%0)"::"r"(&pmRyzen_hpcpus):"memory");
+    //The MSR may be rewritten with the state it already holds, only count real moves in and out of P0.
+    if(!state && !from_hpstate){
+        __atomic_fetch_add(&pmRyzen_hpcpus, 1, __ATOMIC_RELAXED);
+    } else if(state && from_hpstate) {
+        __atomic_fetch_sub(&pmRyzen_hpcpus, 1, __ATOMIC_RELAXED);
+    }
+}
+
+inline void set_PState(pmProcessor_t *cpu, uint8_t state){
+    if(cpu->pstate_pin != PMRYZEN_PSTATE_UNPINNED){
+        state = cpu->pstate_pin;
+    } else {
+        if(pmRyzen_pstatelimit == 0) return;
+        state = min(pmRyzen_pstatelimit, state);
     }
+    if(cpu->PState == state) return;
+    
+    write_PState(cpu, state);
+}
+
+/**
+ *  Pin the calling CPU to a P-state, or hand it back to the governor with PMRYZEN_PSTATE_UNPINNED,
+ *  starting from release until the governor picks it up again.
+ *  Must run on the CPU itself, from a rendezvous or cross-call.
+ */
+void pmRyzen_pin_PState(uint8_t state, uint8_t release){
+    pmProcessor_t *self = &pmRyzen_cpus[PMRYZEN_CPU_NUMBER()];
+    self->pstate_pin = state;
+    
+    //Written even if PState matches, the global PStateCtl may have changed the MSR behind our back.
+    write_PState(self, state != PMRYZEN_PSTATE_UNPINNED ? state : release);
 }
 
 void pmRyzen_doPState_reset(){
-    uint32_t cn = cpu_number();
+    uint32_t cn = PMRYZEN_CPU_NUMBER();
     pmProcessor_t *self = &pmRyzen_cpus[cn];
     self->PState = 8;
     set_PState(self, 0);
@@ -140,7 +175,57 @@ void pmRyzen_PState_reset(){
     mp_rendezvous_no_intrs(&pmRyzen_doPState_reset, NULL);
 }
 
-void pmRyzen_init(void *handle){
+/**
+ *  Group CPUs by the L3 they share. Zen numbers APIC IDs so that all threads of a CCX
+ *  share the upper bits, the width of the lower part comes from the L3 cache properties.
+ */
+static boolean_t pmRyzen_init_ccx(){
+    uint32_t regs[4];
+    PMRYZEN_CPUID(0x8000001D, 3, regs);
+    
+    uint32_t sharing = ((regs[0] >> 14) & 0xfff) + 1;
+    uint32_t shift = 0;
+    while((1U << shift) < sharing && shift < 6) shift++;
+    
+    //Dense CCX numbers in order of first appearance, at most one per CPU.
+    size_t ids_size = pmRyzen_num_slots * sizeof(uint32_t);
+    uint32_t *ids = (uint32_t*)IOMalloc(ids_size);
+    if(!ids) return false;
+    pmRyzen_num_ccx = 0;
+    
+    for(uint32_t i = 0; i < pmRyzen_num_slots; i++){
+        x86_lcpu_t *lcpu = pmRyzen_cpunum_to_lcpu[i];
+        if(!lcpu) continue;
+        
+        uint32_t id = lcpu->pnum >> shift;
+        uint32_t ccx = 0;
+        while(ccx < pmRyzen_num_ccx && ids[ccx] != id) ccx++;
+        if(ccx == pmRyzen_num_ccx) ids[pmRyzen_num_ccx++] = id;
+        
+        pmRyzen_cpus[i].ccx = ccx;
+        pmRyzen_cpus[i].ccx_bit = lcpu->pnum & ((1U << shift) - 1);
+    }
+    
+    IOFree(ids, ids_size);
+    
+    pmRyzen_ccx = (pmRyzenCCX_t*)IOMallocAligned(pmRyzen_num_ccx * sizeof(pmRyzenCCX_t), PMRYZEN_CACHE_LINE);
+    if(!pmRyzen_ccx) return false;
+    
+    bzero(pmRyzen_ccx, pmRyzen_num_ccx * sizeof(pmRyzenCCX_t));
+    
+    for(uint32_t i = 0; i < pmRyzen_num_slots; i++){
+        if(!pmRyzen_cpunum_to_lcpu[i]) continue;
+        
+        pmProcessor_t *cpu = &pmRyzen_cpus[i];
+        pmRyzen_ccx[cpu->ccx].cpus[cpu->ccx_bit] = i;
+        pmRyzen_ccx[cpu->ccx].awake |= 1ULL << cpu->ccx_bit;
+    }
+    
+    IOLog("pmRyzen_init_ccx: %u CCX(s), %u threads per L3\n", pmRyzen_num_ccx, sharing);
+    return true;
+}
+
+boolean_t pmRyzen_init(void *handle, uint32_t maxcpus){
     
     pmRyzen_io_service_handle = handle;
     
@@ -154,9 +239,34 @@ void pmRyzen_init(void *handle){
     
     
     
+    //Fetch callbacks only, per CPU storage has to exist before the kernel may call into us.
     pmCallBacks_t cb;
-    if(*kernelDisp)(*pmRyzen_pmUnRegister)(*kernelDisp);
-    pmKextRegister(PM_DISPATCH_VERSION, &pmRyzen_cpuFuncs, &cb);
+    pmKextRegister(PM_DISPATCH_VERSION, NULL, &cb);
+    
+    uint32_t slots = 0;
+    for(x86_pkg_t *pkg = cb.GetPkgRoot(); pkg; pkg = pkg->next){
+        for(x86_core_t *core = pkg->cores; core; core = core->next_in_pkg){
+            for(x86_lcpu_t *lcpu = core->lcpus; lcpu; lcpu = lcpu->next_in_core){
+                if(lcpu->cpu_num + 1 > slots) slots = lcpu->cpu_num + 1;
+            }
+        }
+    }
+    
+    if(!slots || slots > maxcpus){
+        IOLog("pmRyzen_init: %u cpu slots, at most %u supported\n", slots, maxcpus);
+        return false;
+    }
+    
+    pmRyzen_num_slots = slots;
+    pmRyzen_cpus = (pmProcessor_t*)IOMallocAligned(slots * sizeof(pmProcessor_t), PMRYZEN_CACHE_LINE);
+    pmRyzen_cpunum_to_lcpu = (x86_lcpu_t**)IOMalloc(slots * sizeof(x86_lcpu_t*));
+    if(!pmRyzen_cpus || !pmRyzen_cpunum_to_lcpu){
+        pmRyzen_free();
+        return false;
+    }
+    
+    bzero(pmRyzen_cpus, slots * sizeof(pmProcessor_t));
+    bzero(pmRyzen_cpunum_to_lcpu, slots * sizeof(x86_lcpu_t*));
     
     x86_pkg_t * pkg = cb.GetPkgRoot();
     int pkgCount = 0;
@@ -182,9 +292,10 @@ void pmRyzen_init(void *handle){
                 
                 pmProcessor_t *cpu = &pmRyzen_cpus[lcpu->cpu_num];
                 cpu->lcpu = lcpu;
-                cpu->stat_exit_idle = 0;
                 cpu->arm_flag = 0;
                 cpu->cpu_awake = 1;
+                cpu->spin_est = SPIN_MAX_TSC / 2;
+                cpu->pstate_pin = PMRYZEN_PSTATE_UNPINNED;
                 
                 lcpu = lcpu->next_in_core;
             }
@@ -194,17 +305,31 @@ void pmRyzen_init(void *handle){
         
         pkg = pkg->next;
     }
-//    IOLog("pkg c %d\n", pkgCount);
+    pmRyzen_num_pkgs = pkgCount;
+    
+    if(!pmRyzen_init_ccx()){
+        pmRyzen_free();
+        return false;
+    }
 
     
     pmRyzen_effective_timetsc = ((double)pmRyzen_tsc_freq * EFF_INTERVAL);
     pmRyzen_p_sdtsc = (uint64_t)((double)pmRyzen_effective_timetsc * PSTATE_STEPDOWN_THRE);
     pmRyzen_p_sutsc = (uint64_t)((double)pmRyzen_effective_timetsc * PSTATE_STEPUP_THRE);
+    pmRyzen_gov_latency_tsc = pmRyzen_tsc_freq * GOV_LATENCY_IDLE_US / 1000000;
+    
+    if(*kernelDisp)(*pmRyzen_pmUnRegister)(*kernelDisp);
+    pmKextRegister(PM_DISPATCH_VERSION, &pmRyzen_cpuFuncs, &cb);
     
     pmRyzen_init_PState();
     pmRyzen_PState_reset();
     
     cb.initComplete();
+    
+    return true;
+}
+
+static void pmRyzen_quiesce(void *arg){
 }
 
 void pmRyzen_stop(){
@@ -212,11 +337,40 @@ void pmRyzen_stop(){
     (*pmRyzen_pmUnRegister)(&pmRyzen_cpuFuncs);
     
     //Make sure all cores exited idle thread.
-    for (int i = 0; i < pmRyzen_num_logi; i++) {
+    for (uint32_t i = 0; i < pmRyzen_num_slots; i++) {
+        if(!pmRyzen_cpunum_to_lcpu[i]) continue;
+        
         while(pmRyzen_exit_idle(pmRyzen_cpunum_to_lcpu[i])){
             (*pmRyzen_cpu_IPI)(i);
         }
     }
+    
+    //MachineIdle and pmThreadGoingOffCore both run with interrupts off. Once every CPU has taken
+    //the rendezvous IPI, none of them can still be inside a call that started before the
+    //unregister, so pmRyzen_free may release their state.
+    mp_rendezvous_no_intrs(&pmRyzen_quiesce, NULL);
+}
+
+void pmRyzen_free(){
+    if(pmRyzen_ccx)
+        IOFreeAligned(pmRyzen_ccx, pmRyzen_num_ccx * sizeof(pmRyzenCCX_t));
+    pmRyzen_ccx = NULL;
+    pmRyzen_num_ccx = 0;
+    
+    if(pmRyzen_trace_buf)
+        IOFree(pmRyzen_trace_buf, pmRyzen_num_slots * AMDRYZEN_TRACE_LEN * sizeof(AMDRyzenTraceRecord));
+    pmRyzen_trace_buf = NULL;
+    pmRyzen_trace_enabled = false;
+    
+    if(pmRyzen_cpus)
+        IOFreeAligned(pmRyzen_cpus, pmRyzen_num_slots * sizeof(pmProcessor_t));
+    
+    if(pmRyzen_cpunum_to_lcpu)
+        IOFree(pmRyzen_cpunum_to_lcpu, pmRyzen_num_slots * sizeof(x86_lcpu_t*));
+    
+    pmRyzen_cpus = NULL;
+    pmRyzen_cpunum_to_lcpu = NULL;
+    pmRyzen_num_slots = 0;
 }
 
 
@@ -237,26 +391,118 @@ float pmRyzen_avgload_pcpu(uint32_t cpu){
 }
 
 
-uint32_t pmRyzen_last_woken_cpu=0;
+/**
+ *  Governors run in the idle loop with interrupts off.
+ *  Avoid using xmm registers shared within same core, integer math only.
+ */
+void pmRyzen_gov_heuristic(pmProcessor_t *self, uint64_t rt, uint64_t window, uint64_t idle){
+    if(rt > pmRyzen_p_sutsc){
+        set_PState(self, 0);
+        self->ll_count = 0;
+    } else if(rt < pmRyzen_p_sdtsc){
+        self->ll_count++;
+        uint32_t hpcpus = __atomic_load_n(&pmRyzen_hpcpus, __ATOMIC_RELAXED);
+        if(self->ll_count > PSTATE_STEPDOWN_TIME + hpcpus * PSTATE_STEPDOWN_MP_GAIN){
+            self->ll_count = 0;
+            set_PState(self, self->PState+1);
+        }
+    }
+}
+
+void pmRyzen_gov_performance(pmProcessor_t *self, uint64_t rt, uint64_t window, uint64_t idle){
+    set_PState(self, 0);
+}
+
+void pmRyzen_gov_powersave(pmProcessor_t *self, uint64_t rt, uint64_t window, uint64_t idle){
+    //set_PState clamps to the lowest state allowed by pmRyzen_pstatelimit.
+    set_PState(self, 0xff);
+}
+
+void pmRyzen_gov_ewma(pmProcessor_t *self, uint64_t rt, uint64_t window, uint64_t idle){
+    //Busy fraction in 1/1024.
+    uint32_t busy = (uint32_t)((rt << 10) / window);
+    self->gov_ewma = self->gov_ewma - (self->gov_ewma >> GOV_EWMA_SHIFT) + (busy >> GOV_EWMA_SHIFT);
+    
+    if(self->gov_ewma > (uint32_t)(PSTATE_STEPUP_THRE * 1024)){
+        set_PState(self, 0);
+        self->ll_count = 0;
+    } else if(self->gov_ewma < (uint32_t)(PSTATE_STEPDOWN_THRE * 1024)){
+        if(++self->ll_count > PSTATE_STEPDOWN_TIME){
+            self->ll_count = 0;
+            set_PState(self, self->PState+1);
+        }
+    }
+}
+
+void pmRyzen_gov_latency(pmProcessor_t *self, uint64_t rt, uint64_t window, uint64_t idle){
+    //Short idle periods mean requests arrive faster than a ramp up would take.
+    if(rt > pmRyzen_p_sdtsc || idle < pmRyzen_gov_latency_tsc){
+        set_PState(self, 0);
+        self->ll_count = 0;
+    } else if(++self->ll_count > PSTATE_STEPDOWN_TIME){
+        self->ll_count = 0;
+        set_PState(self, self->PState+1);
+    }
+}
+
+static const struct {
+    const char *name;
+    void (*evaluate)(pmProcessor_t *self, uint64_t rt, uint64_t window, uint64_t idle);
+} pmRyzen_governors[PMRYZEN_GOV_COUNT] = {
+    [PMRYZEN_GOV_HEURISTIC]     = { "heuristic", &pmRyzen_gov_heuristic },
+    [PMRYZEN_GOV_PERFORMANCE]   = { "performance", &pmRyzen_gov_performance },
+    [PMRYZEN_GOV_POWERSAVE]     = { "powersave", &pmRyzen_gov_powersave },
+    [PMRYZEN_GOV_EWMA]          = { "ewma", &pmRyzen_gov_ewma },
+    [PMRYZEN_GOV_LATENCY]       = { "latency", &pmRyzen_gov_latency },
+};
+
+boolean_t pmRyzen_set_governor(uint32_t gov){
+    if(gov >= PMRYZEN_GOV_COUNT) return false;
+    
+    pmRyzen_governor = gov;
+    return true;
+}
+
+const char* pmRyzen_governor_name(uint32_t gov){
+    if(gov >= PMRYZEN_GOV_COUNT) return "";
+    
+    return pmRyzen_governors[gov].name;
+}
+
+
+static inline void pmRyzen_hist_add(pmProcessor_t *p, uint32_t kind, uint64_t ticks){
+    uint32_t b = ticks ? 64 - __builtin_clzll(ticks) : 0;
+    p->hist[kind][b < AMDRYZEN_HIST_BUCKETS ? b : AMDRYZEN_HIST_BUCKETS - 1]++;
+}
+
+//Written on every wake, keep it off the lines of its neighbours.
+uint32_t pmRyzen_last_woken_cpu __attribute__((aligned(PMRYZEN_CACHE_LINE))) = 0;
 //uint32_t pmRyzen_last_idle_cpu=0;
 uint64_t pmRyzen_machine_idle(uint64_t maxDur){
 
+#ifndef PMRYZEN_HW_HOOKS
     __asm__ volatile("cli;");
+#endif
     
-    uint32_t cn = cpu_number();
+    uint32_t cn = PMRYZEN_CPU_NUMBER();
 //    pmRyzen_last_idle_cpu = cn;
     pmProcessor_t *self = &pmRyzen_cpus[cn];
     
     
     self->cpu_awake = 0;
     self->arm_flag = 0;
+    __atomic_fetch_and(&pmRyzen_ccx[self->ccx].awake, ~(1ULL << self->ccx_bit), __ATOMIC_RELAXED);
     
-    uint64_t tscnow = rdtsc64();
+    uint64_t tscnow = PMRYZEN_RDTSC();
 
     self->last_idle_tsc = tscnow;
 //    self->last_running_time = self->last_idle_tsc - self->last_start_tsc;
     
-#ifdef PMRYZEN_IDLE_MWAIT
+#ifdef PMRYZEN_HW_HOOKS
+    
+    pmRyzen_hw_idle();
+    
+#elif defined(PMRYZEN_IDLE_MWAIT)
 
     void* addr = &self->arm_flag;
     uint32_t ps_hint = 0x50;
@@ -293,58 +539,89 @@ uint64_t pmRyzen_machine_idle(uint64_t maxDur){
 
     
     self->cpu_awake = 1;
+    __atomic_fetch_or(&pmRyzen_ccx[self->ccx].awake, 1ULL << self->ccx_bit, __ATOMIC_RELAXED);
+    self->stat_idle++;
     if(!self->arm_flag)
-        pmRyzen_exit_idle_false_c++;
+        self->stat_false_wake++;
     
     
-    tscnow = rdtsc64();
+    tscnow = PMRYZEN_RDTSC();
 
     uint64_t tscela = tscnow - self->last_idle_tsc;
+    pmRyzen_hist_add(self, kAMDRyzenHistIdleResidency, tscela);
+    
+    //arm_tsc is stored before arm_flag, a later waker may have moved it past tscnow.
+    uint64_t arm_tsc = self->arm_tsc;
+    if(self->arm_flag && arm_tsc <= tscnow)
+        pmRyzen_hist_add(self, kAMDRyzenHistWakeLatency, tscnow - arm_tsc);
     self->eff_timeacc += tscnow - self->last_start_tsc;
     self->eff_idleacc += tscela;
 
+    uint8_t pstate = self->PState;
+    
     if(self->eff_timeacc > pmRyzen_effective_timetsc){
-//        self->eff_load = 1 - (float)self->eff_idleacc / (float)self->eff_timeacc;
         uint64_t rt = self->eff_timeacc - self->eff_idleacc;
         
-        //Avoid using xmm registers shared within same core.
-        if(rt > pmRyzen_p_sutsc){
-            set_PState(self, 0);
-            self->ll_count = 0;
-        } else if(rt < pmRyzen_p_sdtsc){
-            self->ll_count++;
-            if(self->ll_count > PSTATE_STEPDOWN_TIME + pmRyzen_hpcpus * PSTATE_STEPDOWN_MP_GAIN){
-                self->ll_count = 0;
-                set_PState(self, self->PState+1);
-            }
-        }
+        pmRyzen_governors[pmRyzen_governor].evaluate(self, rt, self->eff_timeacc, tscela);
         
-//        self->eff_load = 1 - (float)self->eff_idleacc / (float)self->eff_timeacc;
         self->eff_idleaccd = self->eff_idleacc;
         self->eff_timeaccd = self->eff_timeacc;
         self->eff_timeacc = 0;
         self->eff_idleacc = 0;
-
-        
-//        if(self->eff_load > PSTATE_STEPUP_THRE){
-//            set_PState(self, 0);
-//            self->ll_count = 0;
-//        } else if(self->eff_load < PSTATE_STEPDOWN_THRE){
-//            self->ll_count++;
-//            if(self->ll_count > PSTATE_STEPDOWN_TIME){
-//                set_PState(self, self->PState+1);
-//            }
-//        }
-
     }
 
     self->last_start_tsc = tscnow;
     self->last_idle_length = tscela;
     
+    pmRyzen_hf_sample(self, tscnow);
+    
+    if(__atomic_load_n(&pmRyzen_trace_enabled, __ATOMIC_ACQUIRE)){
+        AMDRyzenTraceRecord *rec = &pmRyzen_trace_buf[cn * AMDRYZEN_TRACE_LEN +
+                                                      self->trace_head % AMDRYZEN_TRACE_LEN];
+        rec->idleTSC = self->last_idle_tsc;
+        rec->idleLength = tscela > 0xffffffff ? 0xffffffff : (uint32_t)tscela;
+        rec->wakeReason = (uint8_t)self->arm_flag;
+        rec->PStateBefore = pstate;
+        rec->PStateAfter = self->PState;
+        rec->reserved = 0;
+        
+        __atomic_store_n(&self->trace_head, self->trace_head + 1, __ATOMIC_RELEASE);
+    }
+    
     pmRyzen_last_woken_cpu = cn;
     return 0;
 }
 
+#ifdef PMRYZEN_IDLE_MWAIT
+/**
+ *  How long to spin on the monitor line of target before sending an IPI, 0 to send it right away.
+ */
+static inline uint64_t pmRyzen_spin_budget(pmProcessor_t *target){
+    if(target->spin_fail >= SPIN_FAIL_LIMIT){
+        //Not answering the monitor line, still try it once in a while in case that changed.
+        if(++target->spin_probe % SPIN_PROBE_INTERVAL) return 0;
+        return SPIN_MAX_TSC;
+    }
+    
+    uint64_t budget = (uint64_t)target->spin_est * 2;
+    return budget < SPIN_MIN_TSC ? SPIN_MIN_TSC : (budget > SPIN_MAX_TSC ? SPIN_MAX_TSC : budget);
+}
+
+static inline void pmRyzen_spin_learn(pmProcessor_t *target, uint64_t spun, boolean_t woke){
+    uint32_t est = target->spin_est;
+    
+    //Stepping up 8 times faster than down settles near the 90th percentile of successful spins.
+    //A timeout counts as a long spin, so a budget set too tight grows back before we give up.
+    if(!woke || spun > est)
+        est += (est >> 3) + 1;
+    else if(est > SPIN_MIN_TSC / 2)
+        est -= est >> 6;
+    
+    target->spin_est = est < SPIN_MAX_TSC ? est : SPIN_MAX_TSC;
+    target->spin_fail = woke ? 0 : target->spin_fail + 1;
+}
+#endif
+
 boolean_t pmRyzen_exit_idle(x86_lcpu_t *lcpu){
     
 
@@ -353,53 +630,271 @@ boolean_t pmRyzen_exit_idle(x86_lcpu_t *lcpu){
     // Exit if cpu is already awake.
     if(target->cpu_awake) return false;
     
-    pmRyzen_exit_idle_c++;
+    //Counted on the calling CPU so no two CPUs ever write the same counter.
+    pmProcessor_t *caller = &pmRyzen_cpus[PMRYZEN_CPU_NUMBER()];
+    caller->stat_exit_idle++;
+    
+    uint64_t start_tsc = PMRYZEN_RDTSC();
+    target->arm_tsc = start_tsc;
+    __asm__ volatile("" ::: "memory");
     
 #ifdef PMRYZEN_IDLE_MWAIT
-    uint64_t start_tsc = rdtsc64();
+    uint64_t budget = pmRyzen_spin_budget(target);
+    if(!budget){
+        target->arm_flag = kAMDRyzenTraceWakeIPI;
+        caller->stat_exit_idle_ipi++;
+        pmRyzen_hist_add(caller, kAMDRyzenHistSpin, 0);
+        return true;
+    }
+    
+    uint64_t now;
     do {
         target->arm_flag = 1;
         __asm__ volatile("pause;");
 //        asm volatile("clflushopt %0" : "+m" (*(volatile char *)&target->arm_flag));
 //        __asm__ volatile("mfence;");
 
-        if(rdtsc64() - start_tsc > 0x6000){
+        now = PMRYZEN_RDTSC();
+        if(now - start_tsc > budget){
             //If we still unable to wake up the processor, send an IPI.
-            pmRyzen_exit_idle_ipi_c++;
+            target->arm_flag = kAMDRyzenTraceWakeIPI;
+            pmRyzen_spin_learn(target, now - start_tsc, false);
+            caller->stat_exit_idle_ipi++;
+            pmRyzen_hist_add(caller, kAMDRyzenHistSpin, now - start_tsc);
             return true;
         }
     } while(!target->cpu_awake);
     
+    pmRyzen_spin_learn(target, now - start_tsc, true);
+    pmRyzen_hist_add(caller, kAMDRyzenHistSpin, now - start_tsc);
     return false;
     
 #else
-    target->arm_flag = 1;
-    pmRyzen_exit_idle_ipi_c++;
+    target->arm_flag = kAMDRyzenTraceWakeIPI;
+    caller->stat_exit_idle_ipi++;
     
     return true;
 #endif
 }
 
+static inline boolean_t pmRyzen_cpu_in_range(uint32_t cpu, int startCPU, int endCPU){
+    //A range of -1 means any CPU.
+    return startCPU < 0 || ((int)cpu >= startCPU && (int)cpu <= endCPU);
+}
+
 int pmRyzen_choose_cpu(int startCPU, int endCPU, int preferredCPU){
     
     //We only provide a hint as scheduler will make the final decision anyway.
-  
-//    return preferredCPU;
+    if(preferredCPU < 0 || preferredCPU >= (int)pmRyzen_num_slots)
+        return preferredCPU;
     
-    if(pmRyzen_cpus[preferredCPU].cpu_awake)
+    pmProcessor_t *pref = &pmRyzen_cpus[preferredCPU];
+    if(pref->cpu_awake)
         return preferredCPU;
-
+    
+    //Slots the topology never filled in have nothing to search.
+    if(!pref->lcpu || !pref->lcpu->core)
+        return preferredCPU;
+    
+    //An awake SMT sibling shares L1 and L2.
+    for(x86_lcpu_t *lcpu = pref->lcpu->core->lcpus; lcpu; lcpu = lcpu->next_in_core){
+        if(pmRyzen_cpus[lcpu->cpu_num].cpu_awake && pmRyzen_cpu_in_range(lcpu->cpu_num, startCPU, endCPU))
+            return lcpu->cpu_num;
+    }
+    
+    //Then anything awake on the same L3, rather than waking a core on another CCX.
+    pmRyzenCCX_t *ccx = &pmRyzen_ccx[pref->ccx];
+    uint64_t awake = __atomic_load_n(&ccx->awake, __ATOMIC_RELAXED);
+    while(awake){
+        uint32_t cpu = ccx->cpus[__builtin_ctzll(awake)];
+        if(pmRyzen_cpu_in_range(cpu, startCPU, endCPU))
+            return cpu;
+        
+        awake &= awake - 1;
+    }
+    
     if(pmRyzen_cpus[pmRyzen_last_woken_cpu].cpu_awake)
         return pmRyzen_last_woken_cpu;
     
-//    for(int i = startCPU; i < endCPU; i++){
-//        if(i != pmRyzen_last_idle_cpu && pmRyzen_cpus[i].cpu_awake)
-//            return i;
-//    }
-    
     return preferredCPU;
 }
 
 pmProcessor_t* pmRyzen_get_processor(uint32_t cpu){
     return &pmRyzen_cpus[cpu];
 }
+
+void pmRyzen_hf_set_interval(uint64_t us){
+    pmRyzen_hf_interval_tsc = pmRyzen_tsc_freq * us / 1000000;
+    
+    //Make every CPU drop its last readings before sampling again.
+    __atomic_fetch_add(&pmRyzen_hf_gen, 1, __ATOMIC_RELEASE);
+}
+
+void pmRyzen_hf_sample(pmProcessor_t *self, uint64_t tsc){
+    if(!pmRyzen_hf_interval_tsc) return;
+    
+    pmRyzenHF_t *hf = &self->hf;
+    uint32_t gen = __atomic_load_n(&pmRyzen_hf_gen, __ATOMIC_ACQUIRE);
+    
+    if(hf->gen == gen && tsc - hf->last_tsc < pmRyzen_hf_interval_tsc) return;
+    
+    //Keep APERF and MPERF reads back to back for effective frequency accuracy.
+    uint64_t aperf = PMRYZEN_RDMSR(MSR_APERF);
+    uint64_t mperf = PMRYZEN_RDMSR(MSR_MPERF);
+    uint64_t irpc = PMRYZEN_RDMSR(MSR_IRPC);
+    uint32_t energy = (uint32_t)PMRYZEN_RDMSR(MSR_CORE_ENERGY_STAT);
+    
+    __atomic_store_n(&hf->seq, hf->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    
+    if(hf->epoch != pmRyzen_hf_epoch){
+        hf->epoch = pmRyzen_hf_epoch;
+        hf->ratio_min = 0xffffffff;
+        hf->ratio_max = 0;
+    }
+    
+    //Integer only, this runs in the idle loop and on context switch.
+    if(hf->gen == gen && aperf > hf->last_aperf && mperf > hf->last_mperf){
+        uint64_t da = aperf - hf->last_aperf;
+        uint64_t dm = mperf - hf->last_mperf;
+        uint32_t ratio = (uint32_t)((da << HF_RATIO_SHIFT) / dm);
+        
+        if(ratio < hf->ratio_min) hf->ratio_min = ratio;
+        if(ratio > hf->ratio_max) hf->ratio_max = ratio;
+        
+        hf->samples++;
+        hf->tsc_acc += tsc - hf->last_tsc;
+        hf->aperf_acc += da;
+        hf->mperf_acc += dm;
+        hf->irpc_acc += irpc - hf->last_irpc;
+        hf->energy_acc += energy - hf->last_energy;
+    }
+    
+    hf->gen = gen;
+    hf->last_tsc = tsc;
+    hf->last_aperf = aperf;
+    hf->last_mperf = mperf;
+    hf->last_irpc = irpc;
+    hf->last_energy = energy;
+    
+    __atomic_store_n(&hf->seq, hf->seq + 1, __ATOMIC_RELEASE);
+}
+
+boolean_t pmRyzen_hf_read(uint32_t cpu, pmRyzenHF_t *out){
+    pmRyzenHF_t *hf = &pmRyzen_cpus[cpu].hf;
+    
+    for(int tries = 0; tries < 4; tries++){
+        uint64_t seq = __atomic_load_n(&hf->seq, __ATOMIC_ACQUIRE);
+        if(seq & 1) continue;
+        
+        *out = *hf;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        
+        if(__atomic_load_n(&hf->seq, __ATOMIC_RELAXED) == seq) return true;
+    }
+    
+    return false;
+}
+
+void pmRyzen_hf_next_epoch(){
+    __atomic_fetch_add(&pmRyzen_hf_epoch, 1, __ATOMIC_RELEASE);
+}
+
+void pmRyzen_thread_off_core(thread_t old_thread, boolean_t transfer_load,
+                             uint64_t last_dispatch, boolean_t thread_runnable){
+    //Busy CPUs never reach the idle loop, sample them on context switch instead.
+    if(!pmRyzen_hf_interval_tsc) return;
+    
+    pmRyzen_hf_sample(&pmRyzen_cpus[PMRYZEN_CPU_NUMBER()], PMRYZEN_RDTSC());
+}
+
+boolean_t pmRyzen_trace_enable(boolean_t enable){
+    if(!enable){
+        __atomic_store_n(&pmRyzen_trace_enabled, false, __ATOMIC_RELEASE);
+        return true;
+    }
+    
+    //Allocated once and kept until pmRyzen_free, CPUs may still be writing after a disable.
+    if(!pmRyzen_trace_buf){
+        size_t size = pmRyzen_num_slots * AMDRYZEN_TRACE_LEN * sizeof(AMDRyzenTraceRecord);
+        AMDRyzenTraceRecord *buf = (AMDRyzenTraceRecord*)IOMalloc(size);
+        if(!buf) return false;
+        
+        bzero(buf, size);
+        pmRyzen_trace_buf = buf;
+    }
+    
+    __atomic_store_n(&pmRyzen_trace_enabled, true, __ATOMIC_RELEASE);
+    return true;
+}
+
+uint64_t pmRyzen_trace_read(uint32_t cpu, uint64_t from, AMDRyzenTraceRecord *out, uint32_t max, uint32_t *count){
+    *count = 0;
+    if(!pmRyzen_trace_buf || cpu >= pmRyzen_num_slots) return from;
+    
+    pmProcessor_t *p = &pmRyzen_cpus[cpu];
+    AMDRyzenTraceRecord *ring = &pmRyzen_trace_buf[cpu * AMDRYZEN_TRACE_LEN];
+    
+    //Index head may be in the middle of overwriting head - AMDRYZEN_TRACE_LEN.
+    uint64_t head = __atomic_load_n(&p->trace_head, __ATOMIC_ACQUIRE);
+    if(head >= AMDRYZEN_TRACE_LEN && from <= head - AMDRYZEN_TRACE_LEN)
+        from = head - AMDRYZEN_TRACE_LEN + 1;
+    if(from > head)
+        from = head;
+    
+    uint32_t n = head - from < max ? (uint32_t)(head - from) : max;
+    for(uint32_t i = 0; i < n; i++){
+        out[i] = ring[(from + i) % AMDRYZEN_TRACE_LEN];
+    }
+    
+    //Drop whatever the CPU overwrote while we copied.
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    uint64_t now = __atomic_load_n(&p->trace_head, __ATOMIC_RELAXED);
+    uint32_t lost = 0;
+    if(now >= AMDRYZEN_TRACE_LEN && now - AMDRYZEN_TRACE_LEN + 1 > from){
+        uint64_t stale = now - AMDRYZEN_TRACE_LEN + 1 - from;
+        lost = stale < n ? (uint32_t)stale : n;
+    }
+    
+    for(uint32_t i = 0; lost && i < n - lost; i++){
+        out[i] = out[i + lost];
+    }
+    
+    *count = (uint32_t)(n - lost);
+    return from + lost;
+}
+
+void pmRyzen_get_stats(pmRyzenStats_t *out){
+    bzero(out, sizeof(pmRyzenStats_t));
+    out->hpcpus = __atomic_load_n(&pmRyzen_hpcpus, __ATOMIC_RELAXED);
+    
+    for(uint32_t i = 0; i < pmRyzen_num_slots; i++){
+        pmProcessor_t *p = &pmRyzen_cpus[i];
+        out->idle += p->stat_idle;
+        out->exit_idle += p->stat_exit_idle;
+        out->exit_idle_ipi += p->stat_exit_idle_ipi;
+        out->false_wake += p->stat_false_wake;
+    }
+}
+
+boolean_t pmRyzen_hist_read(uint32_t cpu, uint32_t kind, uint64_t *out){
+    if(kind >= kAMDRyzenHistCount) return false;
+    
+    //All CPUs summed for cpu == -1.
+    uint32_t first = cpu, last = cpu + 1;
+    if(cpu == (uint32_t)-1){
+        first = 0;
+        last = pmRyzen_num_slots;
+    } else if(cpu >= pmRyzen_num_slots){
+        return false;
+    }
+    
+    bzero(out, AMDRYZEN_HIST_BUCKETS * sizeof(uint64_t));
+    for(uint32_t i = first; i < last; i++){
+        for(uint32_t b = 0; b < AMDRYZEN_HIST_BUCKETS; b++){
+            out[b] += __atomic_load_n(&pmRyzen_cpus[i].hist[kind][b], __ATOMIC_RELAXED);
+        }
+    }
+    
+    return true;
+}
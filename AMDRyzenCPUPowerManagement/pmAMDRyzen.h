@@ -20,12 +20,17 @@
 
 #include <i386/proc_reg.h>
 
+#include "AMDRyzenCPUPMTrace.h"
+
 
 #define MOD_NAME pmARyzen
-#define XNU_MAX_CPU 64
 
 #define MSR_PSTATE_CTL 0xC0010062
 #define MSR_PSTATE_0 0xC0010064
+#define MSR_MPERF 0xE7
+#define MSR_APERF 0xE8
+#define MSR_IRPC 0xC00000E9
+#define MSR_CORE_ENERGY_STAT 0xC001029A
 
 #define EFF_INTERVAL 0.15
 #define PSTATE_LIMIT 1
@@ -34,41 +39,147 @@
 #define PSTATE_STEPDOWN_TIME 16
 #define PSTATE_STEPDOWN_MP_GAIN 5
 
+#define PMRYZEN_PSTATE_UNPINNED 0xff
+
+#define GOV_EWMA_SHIFT 3
+#define GOV_LATENCY_IDLE_US 50
+
+#define HF_RATIO_SHIFT 10
+
+#define SPIN_MAX_TSC 0x6000
+#define SPIN_MIN_TSC 0x400
+#define SPIN_FAIL_LIMIT 4
+#define SPIN_PROBE_INTERVAL 64
+
+#define PMRYZEN_CACHE_LINE 64
+
 
 extern int cpu_number(void);
 extern void mp_rendezvous_no_intrs(void (*action_func)(void *), void *arg);
 
-extern x86_lcpu_t *pmRyzen_cpunum_to_lcpu[XNU_MAX_CPU];
+/**
+ *  The idle loop and context switch hook go through these instead of AMDRyzenCPUHardware.
+ *  They run with interrupts off on every idle entry, where a virtual call per access is not
+ *  affordable, so the backend is picked at compile time: the instructions themselves in the
+ *  kext, the pmRyzen_hw_* functions with PMRYZEN_HW_HOOKS (see Tests/HostSupport.cpp).
+ */
+#ifdef PMRYZEN_HW_HOOKS
+extern uint64_t pmRyzen_hw_rdtsc(void);
+extern uint64_t pmRyzen_hw_rdmsr(uint32_t);
+extern int pmRyzen_hw_cpu_number(void);
+extern void pmRyzen_hw_cpuid(uint32_t, uint32_t, uint32_t *);
+extern void pmRyzen_hw_idle(void);
 
+#define PMRYZEN_RDTSC() pmRyzen_hw_rdtsc()
+#define PMRYZEN_RDMSR(msr) pmRyzen_hw_rdmsr(msr)
+#define PMRYZEN_CPU_NUMBER() pmRyzen_hw_cpu_number()
+#define PMRYZEN_CPUID(leaf, subleaf, regs) pmRyzen_hw_cpuid(leaf, subleaf, regs)
+#else
+#define PMRYZEN_RDTSC() rdtsc64()
+#define PMRYZEN_RDMSR(msr) rdmsr64(msr)
+#define PMRYZEN_CPU_NUMBER() cpu_number()
+#define PMRYZEN_CPUID(leaf, subleaf, regs) __asm__ volatile("cpuid" \
+    : "=a"((regs)[0]), "=b"((regs)[1]), "=c"((regs)[2]), "=d"((regs)[3]) : "a"(leaf), "c"(subleaf))
+#endif
+
+//Indexed by cpu_num, sized from the topology in pmRyzen_init.
+extern x86_lcpu_t **pmRyzen_cpunum_to_lcpu;
+extern uint32_t pmRyzen_num_slots;
+
+extern uint32_t pmRyzen_num_pkgs;
 extern uint32_t pmRyzen_num_phys;
 extern uint32_t pmRyzen_num_logi;
+extern uint32_t pmRyzen_num_ccx;
 
-extern uint64_t pmRyzen_exit_idle_c;
-extern uint64_t pmRyzen_exit_idle_ipi_c;
-extern uint64_t pmRyzen_exit_idle_false_c;
+extern uint64_t pmRyzen_tsc_freq;
 
+//CPUs in P0, only touch it atomically.
 extern uint32_t pmRyzen_hpcpus;
 
 extern uint32_t pmRyzen_pstatelimit;
 
+extern uint64_t pmRyzen_hf_interval_tsc;
+
+/**
+ *  P-state policies evaluated once per EFF_INTERVAL of each CPU, from its idle loop.
+ */
+enum {
+    PMRYZEN_GOV_HEURISTIC = 0,  //Step up on load, step down after sustained idle scaled by active CPUs
+    PMRYZEN_GOV_PERFORMANCE,    //Always P0
+    PMRYZEN_GOV_POWERSAVE,      //Always the lowest allowed P-state
+    PMRYZEN_GOV_EWMA,           //Smoothed load against the heuristic thresholds
+    PMRYZEN_GOV_LATENCY,        //Hold P0 while idle periods are short
+    PMRYZEN_GOV_COUNT
+};
+
+extern uint32_t pmRyzen_governor;
+
+extern boolean_t pmRyzen_trace_enabled;
+
 extern void pmRyzen_wrmsr_safe(void *, uint32_t, uint64_t);
 extern uint64_t pmRyzen_rdmsr_safe(void *, uint32_t);
 
 
-typedef struct pmProcessor{
-    x86_lcpu_t *lcpu;
+/**
+ *  High frequency sampling state, written only by its own CPU.
+ *  seq is odd while the CPU updates it, accumulators never reset.
+ */
+typedef struct pmRyzenHF{
+    uint64_t seq;
+    uint32_t gen;
+    uint32_t epoch;
+    
+    uint64_t last_tsc;
+    uint64_t last_aperf;
+    uint64_t last_mperf;
+    uint64_t last_irpc;
+    uint32_t last_energy;
+    
+    //APERF/MPERF ratio in 1/(1 << HF_RATIO_SHIFT) since the last drain epoch.
+    uint32_t ratio_min;
+    uint32_t ratio_max;
+    
+    uint64_t samples;
+    uint64_t tsc_acc;
+    uint64_t aperf_acc;
+    uint64_t mperf_acc;
+    uint64_t irpc_acc;
+    uint64_t energy_acc;
+} pmRyzenHF_t;
 
-    uint64_t stat_exit_idle;
-#ifdef PMRYZEN_IDLE_MWAIT
-    char pad1[64*64];
-#endif
-    uint64_t arm_flag;
-#ifdef PMRYZEN_IDLE_MWAIT
-    char pad2[64*64];
-#endif
+/**
+ *  CPUs sharing an L3, indexed by their bit in awake.
+ */
+typedef struct pmRyzenCCX{
+    uint64_t awake __attribute__((aligned(PMRYZEN_CACHE_LINE)));
+    uint32_t cpus[64];
+} pmRyzenCCX_t;
+
+typedef struct pmRyzenStats{
+    uint64_t hpcpus;
+    uint64_t idle;              //Idle periods taken
+    uint64_t exit_idle;         //pmRyzen_exit_idle calls on a sleeping CPU
+    uint64_t exit_idle_ipi;     //of which fell back to an IPI
+    uint64_t false_wake;        //Wakes nobody asked for through pmRyzen_exit_idle
+} pmRyzenStats_t;
+
+typedef struct pmProcessor{
+    
+    //Wake line: the MWAIT monitor target. Remote CPUs only store arm_flag here, any other
+    //store to the line would end the MWAIT as well. cpu_awake is polled by them and by pmRyzen_choose_cpu.
+    uint64_t arm_flag __attribute__((aligned(PMRYZEN_CACHE_LINE)));
     uint64_t cpu_awake;
     
-    uint64_t last_idle_tsc;
+    //Waker state, on its own line so updating it before arming cannot wake the target.
+    uint64_t arm_tsc __attribute__((aligned(PMRYZEN_CACHE_LINE)));
+    
+    //Spin budget learned by the CPUs waking this one, updated racily.
+    uint32_t spin_est;
+    uint32_t spin_fail;
+    uint32_t spin_probe;
+    
+    //Accounting, only this CPU writes it.
+    uint64_t last_idle_tsc __attribute__((aligned(PMRYZEN_CACHE_LINE)));
     uint64_t last_start_tsc;
     uint64_t last_idle_length;
     uint64_t last_running_time;
@@ -76,18 +187,42 @@ typedef struct pmProcessor{
     uint64_t eff_timeacc;
     uint64_t eff_idleacc;
     
-    float eff_load;
-    uint64_t eff_timeaccd;
-    uint64_t eff_idleaccd;
-    
     uint32_t ll_count;
+    uint32_t gov_ewma;
     uint8_t PState;
     
+    uint64_t trace_head;
+    
+    //Statistics, summed over CPUs on read.
+    uint64_t stat_idle;
+    uint64_t stat_exit_idle;
+    uint64_t stat_exit_idle_ipi;
+    uint64_t stat_false_wake;
+    
+    //Published for readers on other CPUs once per EFF_INTERVAL.
+    uint64_t eff_timeaccd __attribute__((aligned(PMRYZEN_CACHE_LINE)));
+    uint64_t eff_idleaccd;
+    float eff_load;
+    
+    x86_lcpu_t *lcpu;
+    uint32_t ccx;
+    uint32_t ccx_bit;
+    
+    //Fixed P-state set through pmRyzen_pin_PState, overrides the governor and pmRyzen_pstatelimit.
+    uint8_t pstate_pin;
+    
+    pmRyzenHF_t hf __attribute__((aligned(PMRYZEN_CACHE_LINE)));
+    
+    //Wake path histograms in TSC ticks, only this CPU writes them.
+    uint64_t hist[kAMDRyzenHistCount][AMDRYZEN_HIST_BUCKETS] __attribute__((aligned(PMRYZEN_CACHE_LINE)));
+    
 } pmProcessor_t;
 
-void pmRyzen_init(void*);
+boolean_t pmRyzen_init(void*, uint32_t);
 void pmRyzen_stop(void);
+void pmRyzen_free(void);
 void pmRyzen_PState_reset(void);
+void pmRyzen_pin_PState(uint8_t, uint8_t);
 float pmRyzen_avgload_pcpu(uint32_t);
 
 uint64_t pmRyzen_machine_idle(uint64_t);
@@ -98,6 +233,22 @@ int pmRyzen_choose_cpu(int,int,int);
 
 pmProcessor_t* pmRyzen_get_processor(uint32_t);
 
+boolean_t pmRyzen_trace_enable(boolean_t);
+uint64_t pmRyzen_trace_read(uint32_t, uint64_t, AMDRyzenTraceRecord *, uint32_t, uint32_t *);
+
+void pmRyzen_get_stats(pmRyzenStats_t *);
+boolean_t pmRyzen_hist_read(uint32_t, uint32_t, uint64_t *);
+
+boolean_t pmRyzen_set_governor(uint32_t);
+const char* pmRyzen_governor_name(uint32_t);
+
+void pmRyzen_hf_set_interval(uint64_t);
+void pmRyzen_hf_sample(pmProcessor_t *, uint64_t);
+boolean_t pmRyzen_hf_read(uint32_t, pmRyzenHF_t *);
+void pmRyzen_hf_next_epoch(void);
+
+void pmRyzen_thread_off_core(thread_t, boolean_t, uint64_t, boolean_t);
+
 inline uint32_t pmRyzen_cpu_phys_num(uint32_t cpunum){
     return pmRyzen_cpunum_to_lcpu[cpunum]->core->pcore_num;
 }
@@ -106,6 +257,10 @@ inline uint32_t pmRyzen_cpu_primary_in_core(uint32_t cpunum){
     return pmRyzen_cpunum_to_lcpu[cpunum]->core->lcpus == pmRyzen_cpunum_to_lcpu[cpunum];
 }
 
+inline uint32_t pmRyzen_cpu_primary_in_package(uint32_t cpunum){
+    return pmRyzen_cpunum_to_lcpu[cpunum]->package->lcpus == pmRyzen_cpunum_to_lcpu[cpunum];
+}
+
 inline boolean_t pmRyzen_cpu_is_master(uint32_t cpunum){
     return pmRyzen_cpunum_to_lcpu[cpunum]->master;
 }
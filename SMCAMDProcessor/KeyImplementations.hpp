@@ -35,4 +35,19 @@ class TempCore    : public AMDSupportVsmcValue { using AMDSupportVsmcValue::AMDS
 class EnergyPackage: public AMDSupportVsmcValue
 { using AMDSupportVsmcValue::AMDSupportVsmcValue; protected: SMC_RESULT readAccess() override; };
 
+class EnergyCores: public AMDSupportVsmcValue
+{ using AMDSupportVsmcValue::AMDSupportVsmcValue; protected: SMC_RESULT readAccess() override; };
+
+class VoltagePlane: public AMDSupportVsmcValue
+{ using AMDSupportVsmcValue::AMDSupportVsmcValue; protected: SMC_RESULT readAccess() override; };
+
+class CurrentPlane: public AMDSupportVsmcValue
+{ using AMDSupportVsmcValue::AMDSupportVsmcValue; protected: SMC_RESULT readAccess() override; };
+
+class SuperIOTemp: public AMDSupportVsmcValue
+{ using AMDSupportVsmcValue::AMDSupportVsmcValue; protected: SMC_RESULT readAccess() override; };
+
+class SuperIOVoltage: public AMDSupportVsmcValue
+{ using AMDSupportVsmcValue::AMDSupportVsmcValue; protected: SMC_RESULT readAccess() override; };
+
 #endif /* KeyImplementations_hpp */
@@ -11,14 +11,23 @@
 
 SMC_RESULT TempPackage::readAccess() {
     uint16_t *ptr = reinterpret_cast<uint16_t *>(data);
-    *ptr = VirtualSMCAPI::encodeSp(type, (double)provider->PACKAGE_TEMPERATURE_perPackage[0]);
+    *ptr = VirtualSMCAPI::encodeSp(type, (double)provider->PACKAGE_TEMPERATURE_perPackage[package]);
 
     return SmcSuccess;
 }
 
 SMC_RESULT TempCore::readAccess() {
     uint16_t *ptr = reinterpret_cast<uint16_t *>(data);
-    *ptr = VirtualSMCAPI::encodeSp(type, (double)provider->PACKAGE_TEMPERATURE_perPackage[0]);
+    
+    //Report the temperature of the CCD this core lives on, or the package if there is no Tccd.
+    double t = provider->PACKAGE_TEMPERATURE_perPackage[package];
+    uint32_t numCCDs = provider->numberOfCCDs;
+    if(numCCDs){
+        uint32_t coresPerCCD = max(1, provider->totalNumberOfPhysicalCores / numCCDs);
+        t = provider->CCD_TEMPERATURE_perCCD[min(numCCDs - 1, (uint32_t)core / coresPerCCD)];
+    }
+    
+    *ptr = VirtualSMCAPI::encodeSp(type, t);
 
     return SmcSuccess;
 }
@@ -31,3 +40,47 @@ SMC_RESULT EnergyPackage::readAccess(){
     
     return SmcSuccess;
 }
+
+SMC_RESULT EnergyCores::readAccess(){
+    double power = 0;
+    for (uint32_t i = 0; i < provider->totalNumberOfPhysicalCores; i++) {
+        power += provider->corePower_perCore[i];
+    }
+    
+    if (type == SmcKeyTypeFloat)
+        *reinterpret_cast<uint32_t *>(data) = VirtualSMCAPI::encodeFlt(power);
+    else
+        *reinterpret_cast<uint16_t *>(data) = VirtualSMCAPI::encodeSp(type, power);
+    
+    return SmcSuccess;
+}
+
+//SVI2 plane index is passed in core.
+SMC_RESULT VoltagePlane::readAccess(){
+    uint16_t *ptr = reinterpret_cast<uint16_t *>(data);
+    *ptr = VirtualSMCAPI::encodeSp(type, (double)provider->SVI_VOLTAGE_perPlane[core]);
+    
+    return SmcSuccess;
+}
+
+SMC_RESULT CurrentPlane::readAccess(){
+    uint16_t *ptr = reinterpret_cast<uint16_t *>(data);
+    *ptr = VirtualSMCAPI::encodeSp(type, (double)provider->SVI_CURRENT_perPlane[core]);
+    
+    return SmcSuccess;
+}
+
+//SuperIO channel index is passed in core, values are the ones cached by the last fan sample.
+SMC_RESULT SuperIOTemp::readAccess(){
+    uint16_t *ptr = reinterpret_cast<uint16_t *>(data);
+    *ptr = VirtualSMCAPI::encodeSp(type, (double)provider->superIO->getTemperature((int)core));
+    
+    return SmcSuccess;
+}
+
+SMC_RESULT SuperIOVoltage::readAccess(){
+    uint16_t *ptr = reinterpret_cast<uint16_t *>(data);
+    *ptr = VirtualSMCAPI::encodeSp(type, (double)provider->superIO->getVoltage((int)core));
+    
+    return SmcSuccess;
+}
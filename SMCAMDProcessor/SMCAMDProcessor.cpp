@@ -27,6 +27,7 @@ bool SMCAMDProcessor::setupKeysVsmc(){
     
     suc &= VirtualSMCAPI::addKey(KeyPCPR, vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp96, new EnergyPackage(fProvider, 0)));
     suc &= VirtualSMCAPI::addKey(KeyPSTR, vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp96, new EnergyPackage(fProvider, 0)));
+    suc &= VirtualSMCAPI::addKey(KeyPCPC, vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp96, new EnergyCores(fProvider, 0)));
     //    suc &= VirtualSMCAPI::addKey(KeyPCPT, vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp96, new EnergyPackage(this, 0)));
     //    suc &= VirtualSMCAPI::addKey(KeyPCTR, vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp96, new EnergyPackage(this, 0)));
     
@@ -41,11 +42,34 @@ bool SMCAMDProcessor::setupKeysVsmc(){
     //    VirtualSMCAPI::addKey(KeyPCGM, vsmcPlugin.data, VirtualSMCAPI::valueWithFlt(0, new EnergyPackage(this, 0)));
     //    VirtualSMCAPI::addKey(KeyPCPG, vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp96, new EnergyPackage(this, 0)));
     
-    //Since AMD cpu dont have temperature MSR for each core, we simply report the same package temperature for all cores.
-    //    for(int core = 0; core < totalNumberOfPhysicalCores; core++){
-    //        VirtualSMCAPI::addKey(KeyTCxC(core), vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0, core)));
-    //        VirtualSMCAPI::addKey(KeyTCxc(core), vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0, core)));
-    //    }
+    //AMD cpus dont have temperature sensor for each core, so each core reports the Tccd of its core complex.
+    size_t numCoreKeys = min(fProvider->totalNumberOfPhysicalCores, MaxIndexCount);
+    for(size_t core = 0; core < numCoreKeys; core++){
+        suc &= VirtualSMCAPI::addKey(KeyTCxC(core), vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(fProvider, 0, core)));
+        suc &= VirtualSMCAPI::addKey(KeyTCxc(core), vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(fProvider, 0, core)));
+    }
+    
+    //SVI2 planes: VC0C/IC0C for VDDCR_CPU, VC1C/IC1C for VDDCR_SOC.
+    if(fProvider->sviSupported){
+        for(size_t plane = 0; plane < AMDRyzenCPUPowerManagement::kSVIPlaneCount; plane++){
+            suc &= VirtualSMCAPI::addKey(KeyVCxC(plane), vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp3c, new VoltagePlane(fProvider, 0, plane)));
+            suc &= VirtualSMCAPI::addKey(KeyICxC(plane), vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp87, new CurrentPlane(fProvider, 0, plane)));
+        }
+    }
+    
+    //SuperIO hardware monitor: TMxP temperatures, VMxR voltages. Only present if the provider
+    //probed SuperIO at boot (-amdpsuperio), which channel is VRM or chipset depends on the board.
+    if(fProvider->superIO){
+        size_t numTemps = min((size_t)fProvider->superIO->getNumberOfTemperatures(), MaxIndexCount);
+        for(size_t i = 0; i < numTemps; i++){
+            suc &= VirtualSMCAPI::addKey(KeyTMxP(i), vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new SuperIOTemp(fProvider, 0, i)));
+        }
+        
+        size_t numVoltages = min((size_t)fProvider->superIO->getNumberOfVoltages(), MaxIndexCount);
+        for(size_t i = 0; i < numVoltages; i++){
+            suc &= VirtualSMCAPI::addKey(KeyVMxR(i), vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp3c, new SuperIOVoltage(fProvider, 0, i)));
+        }
+    }
     
     if(!suc){
         IOLog("AMDCPUSupport::setupKeysVsmc: VirtualSMCAPI::addKey returned false. \n");
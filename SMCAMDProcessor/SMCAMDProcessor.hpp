@@ -56,6 +56,8 @@ class SMCAMDProcessor : public IOService {
     static constexpr SMC_KEY KeyPSTR = SMC_MAKE_IDENTIFIER('P','S','T','R');
     static constexpr SMC_KEY KeyPCPT = SMC_MAKE_IDENTIFIER('P','C','P','T');
     static constexpr SMC_KEY KeyPCTR = SMC_MAKE_IDENTIFIER('P','C','T','R');
+    static constexpr SMC_KEY KeyVCxC(size_t i) { return SMC_MAKE_IDENTIFIER('V','C',KeyIndexes[i],'C'); }
+    static constexpr SMC_KEY KeyICxC(size_t i) { return SMC_MAKE_IDENTIFIER('I','C',KeyIndexes[i],'C'); }
     static constexpr SMC_KEY KeyTCxD(size_t i) { return SMC_MAKE_IDENTIFIER('T','C',KeyIndexes[i],'D'); }
     static constexpr SMC_KEY KeyTCxE(size_t i) { return SMC_MAKE_IDENTIFIER('T','C',KeyIndexes[i],'E'); }
     static constexpr SMC_KEY KeyTCxF(size_t i) { return SMC_MAKE_IDENTIFIER('T','C',KeyIndexes[i],'F'); }
@@ -69,6 +71,9 @@ class SMCAMDProcessor : public IOService {
     static constexpr SMC_KEY KeyTCxC(size_t i) { return SMC_MAKE_IDENTIFIER('T','C',KeyIndexes[i],'C'); }
     static constexpr SMC_KEY KeyTCxc(size_t i) { return SMC_MAKE_IDENTIFIER('T','C',KeyIndexes[i],'c'); }
     
+    static constexpr SMC_KEY KeyTMxP(size_t i) { return SMC_MAKE_IDENTIFIER('T','M',KeyIndexes[i],'P'); }
+    static constexpr SMC_KEY KeyVMxR(size_t i) { return SMC_MAKE_IDENTIFIER('V','M',KeyIndexes[i],'R'); }
+    
 public:
     
     virtual bool init(OSDictionary *dictionary = 0) override;
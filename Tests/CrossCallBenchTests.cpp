@@ -0,0 +1,172 @@
+//
+//  CrossCallBenchTests.cpp
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#include "TestHarness.h"
+#include "SimTopology.h"
+
+#include "../AMDRyzenCPUPowerManagement/AMDRyzenCPUSimulatedHardware.hpp"
+#include "../AMDRyzenCPUPowerManagement/AMDRyzenCPUMSRScope.h"
+
+/**
+ *  IPIs and interrupt-disabled time of the provider's control writes on the simulated
+ *  backend, each issued both as a rendezvous across the machine, as it was before, and as a
+ *  cross call at the CPUs AMDRyzenMSRScopeMask picks, with the MSR accesses the provider's
+ *  action makes on each CPU. The sampling tick stays a rendezvous and is there to compare.
+ *
+ *  A 16 thread part fits mp_cpus_call's 64 bit mask whole. On 128 threads the core scoped
+ *  writes still do, as the first thread of every core numbers below 64, thread scoped ones
+ *  fall back to a filtered rendezvous.
+ */
+
+static const uint32_t kMaskWords = 4;
+static const uint32_t kPStateDefs = 2;      // PStateDef entries with a valid FID and DFS
+static const uint32_t kPMCCounters = 5;
+
+static AMDRyzenCPUSimulatedHardware *hw;
+static bool pinned[AMDRyzenCPUSimulatedHardware::kMaxCPUs];
+
+struct Op {
+    const char *name;
+    void (*mask)(uint64_t *cpuMask);
+    void (*action)(void *);
+};
+
+//writePstate: one thread per core writes the valid entries, the master reads all back.
+static void pstateDefMask(uint64_t *cpuMask){
+    AMDRyzenMSRScopeMask(MSR_PSTATE_0, cpuMask, kMaskWords);
+    for(uint32_t i = 0; i < pmRyzen_num_slots; i++)
+        if(pmRyzen_cpu_is_master(i)) cpuMask[i / 64] |= 1ULL << (i % 64);
+}
+
+static void pstateDefAction(void *){
+    for(uint32_t i = 0; i < kPStateDefs; i++) hw->writeMSR(MSR_PSTATE_0 + i, 0x8000000000000890ULL);
+    if(!pmRyzen_cpu_is_master(hw->cpuNumber())) return;
+
+    uint64_t def;
+    for(uint32_t i = 0; i < 8; i++) hw->readMSR(MSR_PSTATE_0 + i, &def);
+}
+
+//setCPBState: HWCR is per thread.
+static void hwcrMask(uint64_t *cpuMask){
+    AMDRyzenMSRScopeMask(0xC0010015, cpuMask, kMaskWords);
+}
+
+static void hwcrAction(void *){
+    hw->writeMSR(0xC0010015, 1 << 25);
+}
+
+//applyPowerControl: pinned CPUs keep their own target.
+static void powerControlMask(uint64_t *cpuMask){
+    AMDRyzenMSRScopeMask(MSR_PSTATE_CTL, cpuMask, kMaskWords);
+    for(uint32_t i = 0; i < pmRyzen_num_slots; i++)
+        if(pinned[i]) cpuMask[i / 64] &= ~(1ULL << (i % 64));
+}
+
+static void powerControlAction(void *){
+    if(!pinned[hw->cpuNumber()]) hw->writeMSR(MSR_PSTATE_CTL, 0);
+}
+
+//The timer tick: IRPC and the PMU on every thread, APERF, MPERF and core energy once per core.
+static void tickAction(void *){
+    uint32_t cpu = hw->cpuNumber();
+    uint64_t value;
+    hw->readMSR(0xC00000E9, &value);
+    for(uint32_t i = 0; i < kPMCCounters; i++) hw->readMSR(0xC0010201 + 2 * i, &value);
+
+    if(!pmRyzen_cpu_primary_in_core(cpu)) return;
+    hw->readMSR(0xE8, &value);
+    hw->readMSR(0xE7, &value);
+    hw->readMSR(0xC001029A, &value);
+}
+
+struct Cost {
+    uint32_t ipis;
+    uint64_t intrsOff;
+};
+
+static Cost rendezvousCost(void (*action)(void *)){
+    hw->resetCallCounts();
+    hw->rendezvousNoIntrs(action, nullptr);
+    return {hw->getIPIs(), hw->getIntrsOffAccesses()};
+}
+
+static Cost crossCallCost(const Op &op){
+    uint64_t cpuMask[kMaskWords];
+    op.mask(cpuMask);
+
+    hw->resetCallCounts();
+    hw->crossCall(cpuMask, kMaskWords, op.action, nullptr);
+    return {hw->getIPIs(), hw->getIntrsOffAccesses()};
+}
+
+static void bench(uint32_t packages, uint32_t cores, uint32_t threads){
+    SimTopology topo(packages, cores, threads);
+    uint32_t n = topo.getNumCPUs();
+
+    AMDRyzenCPUSimulatedHardware sim(n, 1000);
+    hw = &sim;
+    AMDRyzenCPUHardware::setShared(&sim);
+    sim.setCPUID(0x8000001D, 3, 7 << 14, 0, 0, 0);
+    sim.setMSR(0, MSR_PSTATE_0, 0x8000000000000890ULL);
+    sim.setMSR(0, MSR_PSTATE_0 + 1, 0x8000000000000878ULL);
+    for(uint32_t i = 0; i < n; i++) sim.setMSR(i, MSR_PSTATE_CTL, 0);
+
+    hostSetTopology(topo.root());
+    CHECK(pmRyzen_init(nullptr, n));
+
+    //The second thread of every core pinned, as a per-CCX or per-core target leaves them.
+    for(uint32_t i = 0; i < n; i++) pinned[i] = !pmRyzen_cpu_primary_in_core(i);
+
+    static const Op ops[] = {
+        {"PStateDef", pstateDefMask, pstateDefAction},
+        {"HWCR", hwcrMask, hwcrAction},
+        {"PStateCtl", powerControlMask, powerControlAction},
+    };
+
+    uint32_t physical = packages * cores;
+    for(const Op &op : ops){
+        Cost before = rendezvousCost(op.action);
+        Cost after = crossCallCost(op);
+        printf("%4u %-10s %10u %10llu %10u %10llu\n", n, op.name, before.ipis, (unsigned long long)before.intrsOff,
+               after.ipis, (unsigned long long)after.intrsOff);
+
+        //Never worse than the rendezvous it replaced.
+        CHECK(after.ipis <= before.ipis);
+        CHECK(after.intrsOff <= before.intrsOff);
+    }
+
+    Cost tick = rendezvousCost(tickAction);
+    printf("%4u %-10s %10u %10llu %10s %10s\n", n, "tick", tick.ipis, (unsigned long long)tick.intrsOff, "-", "-");
+
+    //PStateDef, and PStateCtl with the siblings pinned, only interrupt the other cores. HWCR
+    //needs every thread, past 64 of them through the rendezvous fallback.
+    Cost def = crossCallCost(ops[0]);
+    CHECK(def.ipis == physical - 1);
+    CHECK(def.intrsOff == physical * kPStateDefs + 8);
+
+    Cost hwcr = crossCallCost(ops[1]);
+    CHECK(hwcr.ipis == n - 1);
+    CHECK(hwcr.intrsOff == n);
+
+    Cost ctl = crossCallCost(ops[2]);
+    CHECK(ctl.ipis == physical - 1);
+    CHECK(ctl.intrsOff == physical);
+
+    CHECK(tick.ipis == n - 1);
+    CHECK(tick.intrsOff == n * (1 + kPMCCounters + 3));
+
+    pmRyzen_stop();
+    pmRyzen_free();
+}
+
+int main(){
+    printf("%4s %-10s %10s %10s %10s %10s\n", "cpus", "write", "rdv ipis", "rdv off", "xcall ipis", "xcall off");
+    bench(1, 8, 2);
+    bench(2, 32, 2);
+
+    return TEST_RESULT("CrossCallBenchTests");
+}
@@ -0,0 +1,67 @@
+//
+//  EnergyAccumulatorTests.cpp
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#include "TestHarness.h"
+#include "../AMDRyzenCPUPowerManagement/AMDRyzenCPUEnergy.h"
+
+/**
+ *  Feeds energy_accumulate the raw MSR values a counter advancing by step would show,
+ *  with junk in the reserved upper half like the hardware is allowed to return.
+ */
+static uint64_t run(energy_counter *ec, uint32_t start, uint32_t step, uint32_t reads){
+    uint64_t sum = 0;
+    uint32_t raw = start;
+
+    ec->last = start;
+    ec->acc = 0;
+    for(uint32_t i = 0; i < reads; i++){
+        raw += step;
+        uint32_t delta = energy_accumulate(ec, 0xdead000000000000ULL | raw);
+        CHECK(delta == step);
+        sum += delta;
+    }
+    return sum;
+}
+
+int main(){
+    energy_counter ec {};
+
+    //One wrap: the read after 0xffffff00 lands at 0x100.
+    ec.last = 0xffffff00;
+    CHECK(energy_accumulate(&ec, 0x100) == 0x200);
+    CHECK(ec.acc == 0x200);
+    CHECK(ec.last == 0x100);
+
+    //Exactly at the boundary.
+    ec = {0xffffffff, 0};
+    CHECK(energy_accumulate(&ec, 0) == 1);
+    CHECK(ec.acc == 1);
+
+    //Repeated wraps: about a quarter turn per read for forty reads is ten full turns.
+    uint32_t step = 0x40000001;
+    uint64_t sum = run(&ec, 0xfffff000, step, 40);
+    CHECK(sum == 40ULL * step);
+    CHECK(ec.acc == 40ULL * step);
+    CHECK(ec.acc > 10ULL << 32);
+    CHECK(ec.last == (uint32_t)(0xfffff000 + 40 * step));
+
+    //A stuck counter contributes nothing however often it is read, wrapped value or not.
+    static const uint32_t stuckAt[] = {0, 0x1234, 0xffffffff};
+    for(uint32_t start : stuckAt){
+        run(&ec, start, 0, 1000);
+        CHECK(ec.acc == 0);
+        CHECK(ec.last == start);
+    }
+
+    //And picks up where it stopped once it moves again.
+    ec = {0xfffffff0, 12345};
+    for(int i = 0; i < 10; i++) CHECK(energy_accumulate(&ec, 0xfffffff0) == 0);
+    CHECK(energy_accumulate(&ec, 0x10) == 0x20);
+    CHECK(ec.acc == 12345 + 0x20);
+
+    return TEST_RESULT("EnergyAccumulatorTests");
+}
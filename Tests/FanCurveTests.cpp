@@ -0,0 +1,232 @@
+//
+//  FanCurveTests.cpp
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#include <math.h>
+#include <time.h>
+
+#include "TestHarness.h"
+#include "../AMDRyzenCPUPowerManagement/AMDRyzenCPUFanCurve.hpp"
+
+/**
+ *  AMDRyzenCPUFanCurve on its own, then closed loop against a first order thermal model of a
+ *  CPU under a load step with a noisy sensor, at the fastest and the default timer interval.
+ *  The bench reports peak temperature, how often the PWM written to the SuperIO changes and
+ *  the cost of one evaluate.
+ */
+
+static AMDRyzenFanCurve baseCurve(){
+    AMDRyzenFanCurve c {};
+    c.version = AMDRYZEN_FANCURVE_VERSION;
+    c.enabled = 1;
+    c.source = kAMDRyzenFanSourcePackage;
+    c.numPoints = 4;
+
+    static const float temps[] = {40, 60, 75, 85};
+    static const uint8_t pwms[] = {50, 100, 200, 255};
+    for(int i = 0; i < 4; i++){
+        c.tempC[i] = temps[i];
+        c.pwm[i] = pwms[i];
+    }
+    return c;
+}
+
+static void testCurve(){
+    AMDRyzenFanCurve c = baseCurve();
+    CHECK(AMDRyzenCPUFanCurve::validate(&c));
+
+    AMDRyzenFanCurve bad = c;
+    bad.version++;
+    CHECK(!AMDRyzenCPUFanCurve::validate(&bad));
+    bad = c;
+    bad.numPoints = 0;
+    CHECK(!AMDRyzenCPUFanCurve::validate(&bad));
+    bad = c;
+    bad.tempC[2] = 50;
+    CHECK(!AMDRyzenCPUFanCurve::validate(&bad));
+    bad = c;
+    bad.tempC[1] = NAN;
+    CHECK(!AMDRyzenCPUFanCurve::validate(&bad));
+    bad = c;
+    bad.kp = NAN;
+    CHECK(!AMDRyzenCPUFanCurve::validate(&bad));
+    bad = c;
+    bad.source = kAMDRyzenFanSourceCount;
+    CHECK(!AMDRyzenCPUFanCurve::validate(&bad));
+
+    //A disabled curve only has to carry the right version.
+    bad = {};
+    bad.version = AMDRYZEN_FANCURVE_VERSION;
+    CHECK(AMDRyzenCPUFanCurve::validate(&bad));
+
+    AMDRyzenCPUFanCurve fan;
+    fan.configure(&c);
+    CHECK(fan.lastOutput() == -1);
+
+    //Clamped outside the points, linear between them.
+    CHECK(fan.evaluate(20, 1) == 50);
+    fan.configure(&c);
+    CHECK(fan.evaluate(50, 1) == 75);
+    fan.configure(&c);
+    CHECK(fan.evaluate(67.5f, 1) == 150);
+    CHECK(fan.lastOutput() == 150);
+    fan.configure(&c);
+    CHECK(fan.evaluate(120, 1) == 255);
+
+    //Hysteresis: up right away, down only once the band is left.
+    c.hysteresisC = 3;
+    fan.configure(&c);
+    CHECK(fan.evaluate(70, 1) == fan.evaluate(70, 1));
+    uint8_t at70 = (uint8_t)fan.lastOutput();
+    CHECK(fan.evaluate(68, 1) == at70);
+    CHECK(fan.evaluate(67.5f, 1) == at70);
+    CHECK(fan.evaluate(66, 1) < at70);
+
+    //Slew: at most slewPerSec * dt per call either way.
+    c.hysteresisC = 0;
+    c.slewPerSec = 20;
+    fan.configure(&c);
+    CHECK(fan.evaluate(40, 1) == 50);
+    CHECK(fan.evaluate(90, 0.5f) == 60);
+    CHECK(fan.evaluate(90, 1) == 80);
+    CHECK(fan.evaluate(40, 2) == 50);
+
+    //A saturated integral unwinds within a few seconds once the error changes sign.
+    c = baseCurve();
+    c.targetC = 60;
+    c.ki = 5;
+    fan.configure(&c);
+    for(int i = 0; i < 1000; i++) fan.evaluate(90, 1);
+    CHECK(fan.lastOutput() == 255);
+    int t = 0;
+    while(fan.evaluate(30, 1) > 100 && t < 100) t++;
+    CHECK(t < 10);
+}
+
+/**
+ *  tau dT/dt = ambient + power * R(pwm) - T, thermal resistance falling linearly from a
+ *  stopped to a full speed fan. Reads come with deterministic noise like a real Tctl.
+ */
+struct Plant {
+    float temp = 35;
+    uint32_t noise = 12345;
+
+    float step(float power, uint8_t pwm, float dt){
+        float r = 0.6f - 0.35f * pwm / 255.0f;
+        float target = 30 + power * r;
+        temp += (target - temp) * (1 - expf(-dt / 10.0f));
+        return temp;
+    }
+
+    float read(){
+        noise = noise * 1103515245 + 12345;
+        return temp + ((noise >> 16) % 1000) / 1000.0f - 0.5f;
+    }
+};
+
+struct LoopResult {
+    float peak;
+    float settledError;     // Largest distance from targetC over the last minute at load
+    uint32_t writes;        // PWM changes the provider would have written
+    uint32_t maxStep;
+    float meanPWM;
+};
+
+//Idle, two minutes of 140W, idle again.
+static LoopResult runLoop(const AMDRyzenFanCurve &c, float dt){
+    AMDRyzenCPUFanCurve fan;
+    fan.configure(&c);
+    Plant plant;
+
+    LoopResult r {};
+    int applied = -1;
+    double pwmSum = 0;
+    uint32_t steps = (uint32_t)(240 / dt);
+
+    for(uint32_t i = 0; i < steps; i++){
+        float t = i * dt;
+        float power = t >= 60 && t < 180 ? 140 : 30;
+
+        uint8_t pwm = fan.evaluate(plant.read(), dt);
+        if(applied >= 0 && (uint32_t)abs(pwm - applied) > r.maxStep) r.maxStep = abs(pwm - applied);
+        if(pwm != applied) r.writes++;
+        applied = pwm;
+        pwmSum += pwm;
+
+        float temp = plant.step(power, pwm, dt);
+        if(temp > r.peak) r.peak = temp;
+        if(t >= 120 && t < 180 && fabsf(temp - c.targetC) > r.settledError) r.settledError = fabsf(temp - c.targetC);
+    }
+
+    r.meanPWM = (float)(pwmSum / steps);
+    return r;
+}
+
+static double nsPerEvaluate(const AMDRyzenFanCurve &c){
+    AMDRyzenCPUFanCurve fan;
+    fan.configure(&c);
+    Plant plant;
+
+    const uint32_t n = 2000000;
+    uint32_t sink = 0;
+    timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(uint32_t i = 0; i < n; i++) sink += fan.evaluate(40 + (i & 63) * 0.5f, 0.05f);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    CHECK(sink > 0);
+    return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / n;
+}
+
+static void benchLoop(){
+    AMDRyzenFanCurve plain = baseCurve();
+    AMDRyzenFanCurve hyst = plain;
+    hyst.hysteresisC = 2;
+    AMDRyzenFanCurve slew = hyst;
+    slew.slewPerSec = 20;
+    AMDRyzenFanCurve pid = slew;
+    pid.targetC = 70;
+    pid.kp = 4;
+    pid.ki = 0.5f;
+
+    struct { const char *name; const AMDRyzenFanCurve *curve; } configs[] = {
+        {"curve", &plain}, {"hysteresis", &hyst}, {"slew", &slew}, {"pid", &pid},
+    };
+    static const float intervals[] = {0.05f, 1.0f};
+
+    printf("%-12s %6s %8s %8s %8s %8s %10s\n", "config", "dt", "peak C", "writes", "max step", "mean pwm", "ns/eval");
+    LoopResult results[4][2];
+    for(int i = 0; i < 4; i++){
+        double ns = nsPerEvaluate(*configs[i].curve);
+        for(int d = 0; d < 2; d++){
+            LoopResult &r = results[i][d] = runLoop(*configs[i].curve, intervals[d]);
+            printf("%-12s %6.2f %8.1f %8u %8u %8.1f %10.1f\n", configs[i].name, intervals[d],
+                   r.peak, r.writes, r.maxStep, r.meanPWM, ns);
+        }
+    }
+
+    for(int d = 0; d < 2; d++){
+        //Everything keeps the CPU well clear of throttling.
+        for(int i = 0; i < 4; i++) CHECK(results[i][d].peak < 90);
+
+        //Sensor noise alone must not keep the fan hunting once there is a band.
+        CHECK(results[1][d].writes * 2 < results[0][d].writes);
+
+        //The slew limit holds whatever the interval, allowing for rounding.
+        CHECK(results[2][d].maxStep <= (uint32_t)(slew.slewPerSec * intervals[d]) + 1);
+        CHECK(results[3][d].maxStep <= (uint32_t)(slew.slewPerSec * intervals[d]) + 1);
+
+        //The PID term settles at its target under load.
+        CHECK(results[3][d].settledError < 2);
+    }
+}
+
+int main(){
+    testCurve();
+    benchLoop();
+
+    return TEST_RESULT("FanCurveTests");
+}
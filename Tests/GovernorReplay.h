@@ -0,0 +1,191 @@
+//
+//  GovernorReplay.h
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#ifndef GovernorReplay_h
+#define GovernorReplay_h
+
+#include "SimTopology.h"
+
+#include "../AMDRyzenCPUPowerManagement/AMDRyzenCPUSimulatedHardware.hpp"
+
+extern "C" {
+extern pmProcessor_t *pmRyzen_cpus;
+extern uint64_t pmRyzen_effective_timetsc;
+}
+
+/**
+ *  Drives pmRyzen_machine_idle on one simulated CPU through a sequence of busy and idle
+ *  periods, with the TSC advanced by exactly their length, so a governor sees the same
+ *  windows it would on hardware.
+ *
+ *  Energy is a relative C·V²·f estimate from the P-state MSRs: busy time at each state
+ *  weighted by f·V² against P0, idle time counted as clock gated and free. One unit is
+ *  one second busy in P0. Delay is the latency proxy, how much longer the busy periods
+ *  would have taken at the frequency they ran at than in P0.
+ *
+ *  recordTo collects the idle trace pmRyzen_machine_idle writes while replaying, replay
+ *  plays such a trace back: the busy period before each record is the gap since the
+ *  previous one ended.
+ */
+struct ReplayStats {
+    uint64_t residency[8];
+    uint64_t ticks;
+    uint32_t transitions;
+    uint8_t finalPState;
+    double energy;
+    double delay;
+
+    double seconds() const { return (double)ticks / hostTscFreq; }
+    double share(int pstate) const { return ticks ? (double)residency[pstate] / ticks : 0; }
+    double transitionsPerSecond() const { return ticks ? transitions / seconds() : 0; }
+};
+
+class GovernorReplay {
+
+public:
+    //P0 3.6GHz at 1.35V, P1 at 1.10V, pmRyzen_init_PState moves P1 to 80% of P0.
+    static constexpr uint64_t kPState0 = 0x8000000000080890ULL;
+    static constexpr uint64_t kPState1 = 0x8000000000120878ULL;
+
+    GovernorReplay() : hw(1, 0), topo(1, 1, 1) {
+        hw.setCPUID(0x8000001D, 3, 7 << 14, 0, 0, 0);
+        hw.setMSR(0, MSR_PSTATE_0, kPState0);
+        hw.setMSR(0, MSR_PSTATE_0 + 1, kPState1);
+        hw.setMSR(0, MSR_PSTATE_CTL, 0);
+    }
+
+    static uint64_t us(uint64_t micros){ return hostTscFreq / 1000000 * micros; }
+
+    bool begin(uint32_t governor){
+        AMDRyzenCPUHardware::setShared(&hw);
+        hostSetTopology(topo.root());
+        hostIdle = &idleHook;
+        current = this;
+
+        if(!pmRyzen_set_governor(governor) || !pmRyzen_init(nullptr, 1)) return false;
+
+        for(int p = 0; p < 8; p++){
+            power[p] = relativePower(p);
+            freq[p] = relativeFrequency(p);
+        }
+        stats = {};
+        recordOut = nullptr;
+        return true;
+    }
+
+    //After begin, copy the trace into out as the replay goes, up to max records.
+    bool recordTo(AMDRyzenTraceRecord *out, uint32_t max){
+        recordOut = out;
+        recordMax = max;
+        recorded = 0;
+        recordLost = 0;
+        traceFrom = 0;
+        return pmRyzen_trace_enable(true);
+    }
+
+    uint32_t getRecorded() const { return recorded; }
+    uint64_t getRecordLost() const { return recordLost; }
+
+    //Nothing is known before the first record, it starts right away. The TSC is moved up to
+    //the recorded one if it can be, the first governor window is measured from zero.
+    void replay(const AMDRyzenTraceRecord *recs, uint32_t n){
+        if(!n) return;
+        uint64_t now = hw.readTSC();
+        if(recs[0].idleTSC > now) hw.advanceTSC(recs[0].idleTSC - now);
+
+        uint64_t end = recs[0].idleTSC;
+        for(uint32_t i = 0; i < n; i++){
+            segment(recs[i].idleTSC > end ? recs[i].idleTSC - end : 0, recs[i].idleLength);
+            end = recs[i].idleTSC + recs[i].idleLength;
+        }
+    }
+
+    void segment(uint64_t busy, uint64_t idle){
+        pmProcessor_t *cpu = &pmRyzen_cpus[0];
+        uint8_t pstate = cpu->PState;
+
+        stats.residency[pstate & 7] += busy + idle;
+        stats.ticks += busy + idle;
+        stats.energy += busy * power[pstate & 7] / hostTscFreq;
+        if(freq[pstate & 7] > 0) stats.delay += busy * (1 / freq[pstate & 7] - 1) / hostTscFreq;
+
+        hw.advanceTSC(busy);
+        pendingIdle = idle;
+        pmRyzen_machine_idle(0);
+
+        if(cpu->PState != pstate) stats.transitions++;
+
+        if(recordOut && recorded < recordMax){
+            uint32_t count;
+            uint64_t from = pmRyzen_trace_read(0, traceFrom, recordOut + recorded, recordMax - recorded, &count);
+            recordLost += from - traceFrom;
+            traceFrom = from + count;
+            recorded += count;
+        }
+    }
+
+    //Repeat busy/idle for the given time.
+    void pattern(uint64_t busy, uint64_t idle, uint64_t duration){
+        for(uint64_t t = 0; t < duration; t += busy + idle) segment(busy, idle);
+    }
+
+    ReplayStats end(){
+        stats.finalPState = pmRyzen_cpus[0].PState;
+        pmRyzen_trace_enable(false);
+        pmRyzen_stop();
+        pmRyzen_free();
+        hostIdle = nullptr;
+        return stats;
+    }
+
+    AMDRyzenCPUSimulatedHardware hw;
+
+private:
+    static void idleHook(){
+        current->hw.advanceTSC(current->pendingIdle);
+    }
+
+    //f·V² of a P-state relative to P0, CpuFid[7:0], CpuDfsId[13:8] and CpuVid[21:14].
+    double relativePower(int pstate){
+        double p0 = fV2(hw.getMSR(0, MSR_PSTATE_0));
+        return p0 > 0 ? fV2(hw.getMSR(0, MSR_PSTATE_0 + pstate)) / p0 : 0;
+    }
+
+    double relativeFrequency(int pstate){
+        double p0 = frequency(hw.getMSR(0, MSR_PSTATE_0));
+        return p0 > 0 ? frequency(hw.getMSR(0, MSR_PSTATE_0 + pstate)) / p0 : 0;
+    }
+
+    static double frequency(uint64_t msr){
+        uint32_t dfs = (msr >> 8) & 0x3f;
+        return dfs ? (double)(msr & 0xff) / dfs * 200 : 0;
+    }
+
+    static double fV2(uint64_t msr){
+        double f = frequency(msr);
+        double v = 1.55 - 0.00625 * ((msr >> 14) & 0xff);
+        return f * v * v;
+    }
+
+    static GovernorReplay *current;
+
+    SimTopology topo;
+    uint64_t pendingIdle = 0;
+    double power[8] {};
+    double freq[8] {};
+
+    AMDRyzenTraceRecord *recordOut = nullptr;
+    uint32_t recordMax = 0;
+    uint32_t recorded = 0;
+    uint64_t recordLost = 0;
+    uint64_t traceFrom = 0;
+    ReplayStats stats {};
+};
+
+GovernorReplay *GovernorReplay::current = nullptr;
+
+#endif /* GovernorReplay_h */
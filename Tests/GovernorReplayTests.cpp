@@ -0,0 +1,120 @@
+//
+//  GovernorReplayTests.cpp
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#include "TestHarness.h"
+#include "GovernorReplay.h"
+
+/**
+ *  Replays synthetic idle and busy traces through every governor and reports P-state
+ *  residency, transitions per second and estimated energy for each pair.
+ */
+
+enum {
+    kTraceIdle = 0,     // 100us of work every 10ms
+    kTraceBusy,         // 9ms of work, 1ms idle
+    kTraceBursty,       // The two above alternating every 5s
+    kTraceInteractive,  // 30us requests 20us apart, idle shorter than GOV_LATENCY_IDLE_US
+    kTraceCount
+};
+
+static const char *traceNames[kTraceCount] = {"idle", "busy", "bursty", "interactive"};
+
+static void play(GovernorReplay &replay, int trace){
+    uint64_t second = GovernorReplay::us(1000000);
+
+    switch (trace) {
+        case kTraceIdle:
+            replay.pattern(GovernorReplay::us(100), GovernorReplay::us(9900), 20 * second);
+            break;
+        case kTraceBusy:
+            replay.pattern(GovernorReplay::us(9000), GovernorReplay::us(1000), 20 * second);
+            break;
+        case kTraceBursty:
+            for(int i = 0; i < 2; i++){
+                replay.pattern(GovernorReplay::us(100), GovernorReplay::us(9900), 5 * second);
+                replay.pattern(GovernorReplay::us(9000), GovernorReplay::us(1000), 5 * second);
+            }
+            break;
+        case kTraceInteractive:
+            replay.pattern(GovernorReplay::us(30), GovernorReplay::us(20), 5 * second);
+            break;
+    }
+}
+
+int main(){
+    static GovernorReplay replay;
+    ReplayStats stats[PMRYZEN_GOV_COUNT][kTraceCount];
+
+    printf("%-12s %-12s %8s %8s %10s %10s\n", "governor", "trace", "P0 %", "P1 %", "trans/s", "energy");
+    for(uint32_t g = 0; g < PMRYZEN_GOV_COUNT; g++){
+        for(int t = 0; t < kTraceCount; t++){
+            CHECK(replay.begin(g));
+            play(replay, t);
+            ReplayStats &s = stats[g][t] = replay.end();
+
+            printf("%-12s %-12s %8.2f %8.2f %10.3f %10.3f\n", pmRyzen_governor_name(g), traceNames[t],
+                   s.share(0) * 100, s.share(1) * 100, s.transitionsPerSecond(), s.energy);
+        }
+    }
+
+    //The replay itself: every tick accounted to a P-state, none above the limit.
+    for(uint32_t g = 0; g < PMRYZEN_GOV_COUNT; g++){
+        for(int t = 0; t < kTraceCount; t++){
+            ReplayStats &s = stats[g][t];
+            CHECK(s.ticks > 0);
+            CHECK(s.residency[0] + s.residency[1] == s.ticks);
+            CHECK(s.energy > 0);
+        }
+    }
+
+    uint64_t window = pmRyzen_effective_timetsc + GovernorReplay::us(10000);
+    for(int t = 0; t < kTraceCount; t++){
+        ReplayStats &perf = stats[PMRYZEN_GOV_PERFORMANCE][t];
+        ReplayStats &save = stats[PMRYZEN_GOV_POWERSAVE][t];
+
+        CHECK(perf.share(0) == 1.0);
+        CHECK(perf.transitions == 0);
+
+        //Powersave leaves P0 at the first evaluation and never returns.
+        CHECK(save.transitions == 1);
+        CHECK(save.residency[0] <= window);
+        CHECK(save.finalPState == 1);
+
+        //Nothing spends less than powersave or more than performance.
+        for(uint32_t g = 0; g < PMRYZEN_GOV_COUNT; g++){
+            CHECK(stats[g][t].energy >= save.energy - 1e-9);
+            CHECK(stats[g][t].energy <= perf.energy + 1e-9);
+        }
+    }
+
+    for(uint32_t g = 0; g < PMRYZEN_GOV_COUNT; g++){
+        if(g == PMRYZEN_GOV_POWERSAVE) continue;
+
+        //90% load never steps down.
+        CHECK(stats[g][kTraceBusy].share(0) == 1.0);
+
+        //1% load ends up in P1, except for performance.
+        if(g != PMRYZEN_GOV_PERFORMANCE){
+            CHECK(stats[g][kTraceIdle].finalPState == 1);
+            CHECK(stats[g][kTraceIdle].energy < stats[PMRYZEN_GOV_PERFORMANCE][kTraceIdle].energy);
+        }
+    }
+
+    //Idle periods too short to ramp back from are what the latency governor holds P0 for.
+    CHECK(stats[PMRYZEN_GOV_LATENCY][kTraceInteractive].share(0) == 1.0);
+
+    //The bursty trace steps down at least once and every busy phase finds the CPU in P0 again.
+    //EWMA still remembers the first busy phase when the second idle one ends.
+    for(uint32_t g = 0; g < PMRYZEN_GOV_COUNT; g++){
+        if(g == PMRYZEN_GOV_PERFORMANCE || g == PMRYZEN_GOV_POWERSAVE) continue;
+        CHECK(stats[g][kTraceBursty].transitions >= 2);
+        CHECK(stats[g][kTraceBursty].transitions % 2 == 0);
+        CHECK(stats[g][kTraceBursty].finalPState == 0);
+    }
+
+    return TEST_RESULT("GovernorReplayTests");
+}
@@ -0,0 +1,167 @@
+//
+//  HostSupport.cpp
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string.h>
+
+#include "HostSupport.h"
+
+#include "../AMDRyzenCPUPowerManagement/AMDRyzenCPUSimulatedHardware.hpp"
+#include "../AMDRyzenCPUPowerManagement/SuperIO/ISSuperIOGeneric.hpp"
+
+/**
+ *  What the kernel and the kext's IOKit side provide to the code under test, with every
+ *  hardware access forwarded to AMDRyzenCPUHardware::shared().
+ */
+
+AMDRyzenCPUHardware *AMDRyzenCPUHardware::sharedInstance = nullptr;
+
+AMDRyzenCPUHardware *AMDRyzenCPUHardware::shared(){
+    return sharedInstance;
+}
+
+void AMDRyzenCPUHardware::setShared(AMDRyzenCPUHardware *hw){
+    sharedInstance = hw;
+}
+
+constexpr i386_ioport_t ISLPCPort::kREGISTER_PORTS[];
+constexpr i386_ioport_t ISLPCPort::kVALUE_PORTS[];
+
+int ISSuperIOSMCFamily::getNumberOfFans(){ return 0; }
+const char *ISSuperIOSMCFamily::getReadableStringForFan(int fan){ return nullptr; }
+uint32_t ISSuperIOSMCFamily::getRPMForFan(int fan){ return 0; }
+bool ISSuperIOSMCFamily::getFanAutoControlMode(int fan){ return false; }
+uint8_t ISSuperIOSMCFamily::getFanThrottle(int fan){ return 0; }
+void ISSuperIOSMCFamily::updateFanRPMS(){}
+void ISSuperIOSMCFamily::updateFanControl(){}
+void ISSuperIOSMCFamily::overrideFanControl(int fan, uint8_t thr){}
+void ISSuperIOSMCFamily::setDefaultFanControl(int fan){}
+int ISSuperIOSMCFamily::getNumberOfVoltages(){ return 0; }
+const char *ISSuperIOSMCFamily::getReadableStringForVoltage(int idx){ return nullptr; }
+float ISSuperIOSMCFamily::getVoltage(int idx){ return 0; }
+int ISSuperIOSMCFamily::getNumberOfTemperatures(){ return 0; }
+const char *ISSuperIOSMCFamily::getReadableStringForTemperature(int idx){ return nullptr; }
+float ISSuperIOSMCFamily::getTemperature(int idx){ return 0; }
+void ISSuperIOSMCFamily::updateSensors(){}
+
+uint64_t hostTscFreq = 3600000000ULL;
+pmDispatch_t *hostDispatch = nullptr;
+uint32_t hostIPIs = 0;
+void (*hostIdle)(void) = nullptr;
+
+static x86_pkg_t *hostPkgRoot = nullptr;
+
+void hostSetTopology(x86_pkg_t *root){
+    hostPkgRoot = root;
+}
+
+static x86_pkg_t *hostGetPkgRoot(void){
+    return hostPkgRoot;
+}
+
+static void hostInitComplete(void){}
+
+static void hostPmUnRegister(pmDispatch_t *cpuFuncs){
+    if(hostDispatch == cpuFuncs) hostDispatch = nullptr;
+}
+
+static void hostCPUNMI(int cpu){}
+static void hostNMIPIEnable(boolean_t enable){}
+
+static void hostCPUIPI(int cpu){
+    hostIPIs++;
+}
+
+extern "C" {
+
+void IOLog(const char *format, ...){
+    if(!getenv("TESTS_VERBOSE")) return;
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void *IOMalloc(size_t size){ return malloc(size); }
+void IOFree(void *address, size_t size){ free(address); }
+void *IOMallocAligned(size_t size, size_t alignment){ return aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1)); }
+void IOFreeAligned(void *address, size_t size){ free(address); }
+void IOSleep(unsigned milliseconds){}
+void IODelay(unsigned microseconds){}
+
+void panic(const char *format, ...){
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    abort();
+}
+
+void *lookup_symbol(const char *symbol){
+    if(!strcmp(symbol, "_pmDispatch")) return &hostDispatch;
+    if(!strcmp(symbol, "_pmUnRegister")) return (void*)&hostPmUnRegister;
+    if(!strcmp(symbol, "_cpu_NMI_interrupt")) return (void*)&hostCPUNMI;
+    if(!strcmp(symbol, "_NMIPI_enable")) return (void*)&hostNMIPIEnable;
+    if(!strcmp(symbol, "_i386_cpu_IPI")) return (void*)&hostCPUIPI;
+    if(!strcmp(symbol, "_tscFreq")) return &hostTscFreq;
+    return nullptr;
+}
+
+void pmKextRegister(uint32_t version, pmDispatch_t *cpuFuncs, pmCallBacks_t *callbacks){
+    if(callbacks){
+        memset(callbacks, 0, sizeof(*callbacks));
+        callbacks->GetPkgRoot = &hostGetPkgRoot;
+        callbacks->initComplete = &hostInitComplete;
+    }
+    if(cpuFuncs) hostDispatch = cpuFuncs;
+}
+
+int cpu_number(void){
+    return AMDRyzenCPUHardware::shared()->cpuNumber();
+}
+
+void mp_rendezvous_no_intrs(void (*action_func)(void *), void *arg){
+    AMDRyzenCPUHardware::shared()->rendezvousNoIntrs(action_func, arg);
+}
+
+void pmRyzen_wrmsr_safe(void *handle, uint32_t addr, uint64_t value){
+    AMDRyzenCPUHardware::shared()->writeMSR(addr, value);
+}
+
+uint64_t pmRyzen_rdmsr_safe(void *handle, uint32_t addr){
+    uint64_t v = 0;
+    AMDRyzenCPUHardware::shared()->readMSR(addr, &v);
+    return v;
+}
+
+uint64_t pmRyzen_hw_rdtsc(void){
+    return AMDRyzenCPUHardware::shared()->readTSC();
+}
+
+uint64_t pmRyzen_hw_rdmsr(uint32_t msr){
+    uint64_t v = 0;
+    AMDRyzenCPUHardware::shared()->readMSR(msr, &v);
+    return v;
+}
+
+int pmRyzen_hw_cpu_number(void){
+    return AMDRyzenCPUHardware::shared()->cpuNumber();
+}
+
+void pmRyzen_hw_idle(void){
+    if(hostIdle) hostIdle();
+}
+
+//CPUID is not part of AMDRyzenCPUHardware, the tests only ever install the simulated backend.
+void pmRyzen_hw_cpuid(uint32_t leaf, uint32_t subleaf, uint32_t *regs){
+    static_cast<AMDRyzenCPUSimulatedHardware*>(AMDRyzenCPUHardware::shared())->cpuid(leaf, subleaf, regs);
+}
+
+}
@@ -0,0 +1,31 @@
+//
+//  HostSupport.h
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#ifndef HostSupport_h
+#define HostSupport_h
+
+extern "C" {
+#include "../AMDRyzenCPUPowerManagement/pmAMDRyzen.h"
+}
+
+/**
+ *  The kernel pmRyzen_init talks to, see HostSupport.cpp. lookup_symbol resolves the few
+ *  symbols it asks for to the variables below, pmKextRegister hands out hostSetTopology's
+ *  root and remembers the dispatch table registered.
+ */
+void hostSetTopology(x86_pkg_t *root);
+
+extern uint64_t hostTscFreq;
+extern pmDispatch_t *hostDispatch;
+
+//What pmRyzen_machine_idle does in place of halting, nothing if unset.
+extern void (*hostIdle)(void);
+
+//i386_cpu_IPI calls, as pmRyzen_exit_idle's fallback would send them.
+extern uint32_t hostIPIs;
+
+#endif /* HostSupport_h */
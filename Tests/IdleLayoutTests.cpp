@@ -0,0 +1,307 @@
+//
+//  IdleLayoutTests.cpp
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "TestHarness.h"
+#include "HostSupport.h"
+
+/**
+ *  Cache traffic of the idle and exit-idle protocol with pmProcessor_t as it is laid out now
+ *  and as it was before, entries packed back to back.
+ *
+ *  Sixteen CPUs go idle and wake each other at random. Every access pmRyzen_machine_idle,
+ *  pmRyzen_exit_idle and pmRyzen_choose_cpu make to the per-CPU state is played against a
+ *  line ownership model: a load or store missing on a line another CPU holds is a transfer,
+ *  a store drops every other copy. A store by anyone to the line an idle CPU monitors, other
+ *  than its waker setting arm_flag, ends that CPU's MWAIT early, which costs a C-state exit
+ *  rather than a line.
+ *
+ *  The sandbox these run in may have a single CPU, so the traffic is counted rather than
+ *  timed with threads.
+ */
+
+//The same fields back to back, as pmProcessor_t was before it was split into cache-line
+//aligned sections.
+struct PackedProcessor {
+    uint64_t arm_flag;
+    uint64_t cpu_awake;
+
+    uint64_t arm_tsc;
+    uint32_t spin_est;
+    uint32_t spin_fail;
+    uint32_t spin_probe;
+
+    uint64_t last_idle_tsc;
+    uint64_t last_start_tsc;
+    uint64_t last_idle_length;
+    uint64_t last_running_time;
+
+    uint64_t eff_timeacc;
+    uint64_t eff_idleacc;
+
+    uint32_t ll_count;
+    uint32_t gov_ewma;
+    uint8_t PState;
+
+    uint64_t trace_head;
+
+    uint64_t stat_idle;
+    uint64_t stat_exit_idle;
+    uint64_t stat_exit_idle_ipi;
+    uint64_t stat_false_wake;
+
+    uint64_t eff_timeaccd;
+    uint64_t eff_idleaccd;
+    float eff_load;
+
+    x86_lcpu_t *lcpu;
+    uint32_t ccx;
+    uint32_t ccx_bit;
+    uint8_t pstate_pin;
+
+    pmRyzenHF_t hf;
+    uint64_t hist[kAMDRyzenHistCount][AMDRYZEN_HIST_BUCKETS];
+};
+
+enum Field {
+    kArmFlag, kCPUAwake, kArmTSC, kStatExitIdle,
+    kLastIdleTSC, kLastStartTSC, kLastIdleLength,
+    kEffTimeAcc, kEffIdleAcc, kEffTimeAccD, kEffIdleAccD,
+    kLLCount, kPState, kStatIdle, kHF,
+    kFieldCount
+};
+
+struct Layout {
+    const char *name;
+    size_t size;
+    size_t offset[kFieldCount];
+};
+
+static const Layout kCurrent = {"aligned", sizeof(pmProcessor_t), {
+    offsetof(pmProcessor_t, arm_flag), offsetof(pmProcessor_t, cpu_awake),
+    offsetof(pmProcessor_t, arm_tsc), offsetof(pmProcessor_t, stat_exit_idle),
+    offsetof(pmProcessor_t, last_idle_tsc), offsetof(pmProcessor_t, last_start_tsc),
+    offsetof(pmProcessor_t, last_idle_length),
+    offsetof(pmProcessor_t, eff_timeacc), offsetof(pmProcessor_t, eff_idleacc),
+    offsetof(pmProcessor_t, eff_timeaccd), offsetof(pmProcessor_t, eff_idleaccd),
+    offsetof(pmProcessor_t, ll_count), offsetof(pmProcessor_t, PState),
+    offsetof(pmProcessor_t, stat_idle), offsetof(pmProcessor_t, hf),
+}};
+
+static const Layout kPacked = {"packed", sizeof(PackedProcessor), {
+    offsetof(PackedProcessor, arm_flag), offsetof(PackedProcessor, cpu_awake),
+    offsetof(PackedProcessor, arm_tsc), offsetof(PackedProcessor, stat_exit_idle),
+    offsetof(PackedProcessor, last_idle_tsc), offsetof(PackedProcessor, last_start_tsc),
+    offsetof(PackedProcessor, last_idle_length),
+    offsetof(PackedProcessor, eff_timeacc), offsetof(PackedProcessor, eff_idleacc),
+    offsetof(PackedProcessor, eff_timeaccd), offsetof(PackedProcessor, eff_idleaccd),
+    offsetof(PackedProcessor, ll_count), offsetof(PackedProcessor, PState),
+    offsetof(PackedProcessor, stat_idle), offsetof(PackedProcessor, hf),
+}};
+
+static const uint32_t kCPUs = 16;
+static const uint32_t kWakes = 100000;
+
+static uint32_t rng;
+static uint32_t rnd(uint32_t n){
+    rng = rng * 1664525 + 1013904223;
+    return (rng >> 8) % n;
+}
+
+//Transfers by the field whose access caused them.
+enum Group { kWakeLine, kWakerLine, kOtherLines, kGroupCount };
+
+static Group groupOf(Field f){
+    if(f == kArmFlag || f == kCPUAwake) return kWakeLine;
+    return f == kArmTSC ? kWakerLine : kOtherLines;
+}
+
+struct Traffic {
+    uint64_t transfers[kGroupCount];
+    uint64_t invalidations;
+    uint64_t spurious;      // Monitor line stores that were not a wake
+};
+
+class CoherenceModel {
+public:
+    CoherenceModel(const Layout &layout) :
+    layout(layout), sharers(kCPUs * layout.size / PMRYZEN_CACHE_LINE + 1) {
+        for(uint32_t i = 0; i < kCPUs; i++) monitoring[i] = -1;
+    }
+
+    void load(uint32_t cpu, uint32_t owner, Field f){
+        long line = lineOf(owner, f);
+
+        uint32_t bit = 1U << cpu;
+        if(!(sharers[line] & bit) && sharers[line]) traffic.transfers[groupOf(f)]++;
+        sharers[line] |= bit;
+    }
+
+    void store(uint32_t cpu, uint32_t owner, Field f, bool wake = false){
+        long line = lineOf(owner, f);
+
+        uint32_t bit = 1U << cpu;
+        uint32_t others = sharers[line] & ~bit;
+        if(!(sharers[line] & bit) && others) traffic.transfers[groupOf(f)]++;
+        traffic.invalidations += __builtin_popcount(others);
+        sharers[line] = bit;
+
+        for(uint32_t m = 0; m < kCPUs; m++){
+            if(m == cpu || monitoring[m] != line) continue;
+            if(!(wake && m == owner)) traffic.spurious++;
+        }
+    }
+
+    void monitor(uint32_t cpu){ monitoring[cpu] = lineOf(cpu, kArmFlag); }
+    void unmonitor(uint32_t cpu){ monitoring[cpu] = -1; }
+
+    Traffic traffic {};
+
+private:
+    long lineOf(uint32_t owner, Field f){
+        return (long)((owner * layout.size + layout.offset[f]) / PMRYZEN_CACHE_LINE);
+    }
+
+    const Layout &layout;
+    std::vector<uint32_t> sharers;
+    long monitoring[kCPUs];
+};
+
+//pmRyzen_machine_idle up to the MWAIT.
+static void enterIdle(CoherenceModel &m, uint32_t c){
+    m.store(c, c, kCPUAwake);
+    m.store(c, c, kArmFlag);
+    m.store(c, c, kLastIdleTSC);
+    m.load(c, c, kArmFlag);
+    m.monitor(c);
+}
+
+//pmRyzen_exit_idle from w, then the rest of pmRyzen_machine_idle on c.
+static void wake(CoherenceModel &m, uint32_t w, uint32_t c, uint32_t wakes){
+    m.load(w, c, kCPUAwake);
+    m.store(w, w, kStatExitIdle);
+    m.store(w, c, kArmTSC);
+    m.store(w, c, kArmFlag, true);
+    m.load(w, c, kCPUAwake);
+    m.unmonitor(c);
+
+    m.store(c, c, kCPUAwake);
+    m.store(c, c, kStatIdle);
+    m.load(c, c, kArmFlag);
+    m.load(c, c, kArmTSC);
+    m.load(c, c, kLastIdleTSC);
+    m.store(c, c, kEffTimeAcc);
+    m.store(c, c, kEffIdleAcc);
+    m.load(w, c, kCPUAwake);
+    m.store(c, c, kLLCount);
+    m.store(c, c, kPState);
+    m.store(c, c, kLastStartTSC);
+    m.store(c, c, kLastIdleLength);
+    m.store(c, c, kHF);
+
+    //Once per EFF_INTERVAL or so the loads are published.
+    if(!(wakes % 8)){
+        m.store(c, c, kEffTimeAccD);
+        m.store(c, c, kEffIdleAccD);
+    }
+}
+
+static Traffic run(const Layout &layout){
+    rng = 1;
+    CoherenceModel m(layout);
+    bool awake[kCPUs];
+    for(uint32_t i = 0; i < kCPUs; i++) awake[i] = true;
+    uint32_t numAwake = kCPUs;
+
+    for(uint32_t wakes = 0; wakes < kWakes;){
+        uint32_t c = rnd(kCPUs);
+        uint32_t w = rnd(kCPUs);
+
+        //Someone stays up to wake the others.
+        if(awake[c] && numAwake > 1){
+            enterIdle(m, c);
+            awake[c] = false;
+            numAwake--;
+        } else if(!awake[c] && awake[w]){
+            wake(m, w, c, wakes++);
+            awake[c] = true;
+            numAwake++;
+        }
+
+        //pmRyzen_choose_cpu polling some CPU's wake line, the governor reading a sibling's load.
+        uint32_t x = rnd(kCPUs);
+        if(awake[x]){
+            m.load(x, rnd(kCPUs), kCPUAwake);
+            m.load(x, x ^ 1, kEffTimeAccD);
+            m.load(x, x ^ 1, kEffIdleAccD);
+        }
+    }
+
+    return m.traffic;
+}
+
+static uint32_t line(size_t offset){
+    return (uint32_t)(offset / PMRYZEN_CACHE_LINE);
+}
+
+static void testLayout(){
+    //Entries tile the array on line boundaries, the wake line starts one.
+    CHECK(sizeof(pmProcessor_t) % PMRYZEN_CACHE_LINE == 0);
+    CHECK(alignof(pmProcessor_t) == PMRYZEN_CACHE_LINE);
+    CHECK(offsetof(pmProcessor_t, arm_flag) % PMRYZEN_CACHE_LINE == 0);
+
+    //Only arm_flag and cpu_awake on the line the MWAIT monitors.
+    uint32_t wakeLine = line(offsetof(pmProcessor_t, arm_flag));
+    CHECK(line(offsetof(pmProcessor_t, cpu_awake)) == wakeLine);
+    CHECK(line(offsetof(pmProcessor_t, arm_tsc)) != wakeLine);
+    CHECK(line(offsetof(pmProcessor_t, spin_est)) != wakeLine);
+    CHECK(line(offsetof(pmProcessor_t, last_idle_tsc)) != wakeLine);
+    CHECK(line(offsetof(pmProcessor_t, stat_idle)) != wakeLine);
+    CHECK(line(offsetof(pmProcessor_t, stat_exit_idle)) != wakeLine);
+
+    //What other CPUs write, what only the owner writes and what others read, apart.
+    uint32_t wakerLine = line(offsetof(pmProcessor_t, arm_tsc));
+    uint32_t ownLine = line(offsetof(pmProcessor_t, last_idle_tsc));
+    uint32_t publishedLine = line(offsetof(pmProcessor_t, eff_timeaccd));
+    CHECK(wakerLine != ownLine && wakerLine != publishedLine && ownLine != publishedLine);
+    CHECK(line(offsetof(pmProcessor_t, eff_idleaccd)) == publishedLine);
+    CHECK(line(offsetof(pmProcessor_t, eff_timeacc)) != publishedLine);
+    CHECK(line(offsetof(pmProcessor_t, hf)) > publishedLine);
+}
+
+int main(){
+    testLayout();
+
+    Traffic packed = run(kPacked);
+    Traffic aligned = run(kCurrent);
+
+    printf("%-8s %6s %10s %10s %10s %10s %10s\n", "layout", "bytes", "wake", "waker", "other",
+           "invalid.", "spurious");
+    const Layout *layouts[] = {&kPacked, &kCurrent};
+    const Traffic *traffic[] = {&packed, &aligned};
+    for(int i = 0; i < 2; i++){
+        const Traffic &t = *traffic[i];
+        printf("%-8s %6zu %10.2f %10.2f %10.2f %10.2f %10.3f\n", layouts[i]->name, layouts[i]->size,
+               (double)t.transfers[kWakeLine] / kWakes, (double)t.transfers[kWakerLine] / kWakes,
+               (double)t.transfers[kOtherLines] / kWakes, (double)t.invalidations / kWakes,
+               (double)t.spurious / kWakes);
+    }
+
+    //arm_tsc stored on the target's wake line ended its MWAIT before arm_flag was set, and
+    //bookkeeping crossed between CPUs with the wake flags. Its own line costs at most the
+    //waker's store and the target's load per wake.
+    CHECK(packed.spurious > 0);
+    CHECK(aligned.spurious == 0);
+    CHECK(aligned.transfers[kOtherLines] < packed.transfers[kOtherLines]);
+    CHECK(aligned.transfers[kWakeLine] <= packed.transfers[kWakeLine]);
+    CHECK(aligned.transfers[kWakerLine] <= 2 * (uint64_t)kWakes);
+
+    return TEST_RESULT("IdleLayoutTests");
+}
@@ -0,0 +1,113 @@
+//
+//  SMNBenchTests.cpp
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#include "TestHarness.h"
+
+#include "../AMDRyzenCPUPowerManagement/AMDRyzenCPUSimulatedHardware.hpp"
+#include "../AMDRyzenCPUPowerManagement/AMDRyzenCPUSMN.hpp"
+
+/**
+ *  Config cycles per timer tick spent on SMN, through AMDRyzenCPUSMN as the provider reads
+ *  it now and through an index write and a data read per register as readSMN did before.
+ *  A tick reads Tctl and the Tccd registers in one batch from updatePackageTemp, then the
+ *  SVI2 planes in another from updateSVITelemetry.
+ */
+
+static const uint32_t kTctl = 0x00059800;
+static const uint32_t kTccdBase = 0x00059954;
+static const uint32_t kSVI = 0x0005A000;
+static const uint32_t kTicks = 1000;
+
+struct Part {
+    const char *name;
+    uint32_t ccds;
+    bool svi;
+    bool client;        // A user client reads Tctl once between ticks
+};
+
+static uint32_t registerValue(uint32_t addr){
+    return addr * 2654435761U;
+}
+
+static void readBefore(AMDRyzenCPUSimulatedHardware &hw, const uint32_t *addrs, uint32_t *values, uint32_t count){
+    for(uint32_t i = 0; i < count; i++){
+        hw.pciConfigWrite32(AMDRyzenCPUSimulatedHardware::kSMNIndex, addrs[i]);
+        values[i] = hw.pciConfigRead32(AMDRyzenCPUSimulatedHardware::kSMNData);
+    }
+}
+
+static uint32_t run(AMDRyzenCPUSimulatedHardware &hw, const Part &part, bool batched, uint32_t *wrong){
+    AMDRyzenCPUSMN smn;
+    smn.setHardware(&hw);
+
+    uint32_t temps[9] = {kTctl};
+    for(uint32_t i = 0; i < part.ccds; i++) temps[i + 1] = kTccdBase + i * 4;
+    uint32_t planes[2] = {kSVI + 0x10, kSVI + 0xc};
+    uint32_t values[9];
+
+    hw.resetConfigCounts();
+    for(uint32_t t = 0; t < kTicks; t++){
+        const uint32_t *batches[] = {temps, planes, temps};
+        uint32_t counts[] = {part.ccds + 1, part.svi ? 2U : 0U, part.client ? 1U : 0U};
+
+        for(int b = 0; b < 3; b++){
+            if(batched) smn.readBatch(batches[b], values, counts[b]);
+            else readBefore(hw, batches[b], values, counts[b]);
+
+            for(uint32_t i = 0; i < counts[b]; i++) *wrong += values[i] != registerValue(batches[b][i]);
+        }
+    }
+
+    return hw.getConfigReads() + hw.getConfigWrites();
+}
+
+int main(){
+    AMDRyzenCPUSimulatedHardware hw(1, 0);
+    static const uint32_t regs[] = {kTctl, kTccdBase, kTccdBase + 4, kSVI + 0xc, kSVI + 0x10};
+    for(uint32_t addr : regs) hw.setSMN(addr, registerValue(addr));
+
+    static const Part parts[] = {
+        {"Zen Tctl", 0, false, false},
+        {"Zen +SVI2", 0, true, false},
+        {"Matisse", 2, true, false},
+        {"Zen +client", 0, false, true},
+        {"Matisse +client", 2, true, true},
+    };
+
+    printf("%-16s %8s %8s\n", "part", "before", "after");
+    uint32_t wrong = 0;
+    uint32_t cycles[5][2];
+    for(int p = 0; p < 5; p++){
+        cycles[p][0] = run(hw, parts[p], false, &wrong);
+        cycles[p][1] = run(hw, parts[p], true, &wrong);
+        printf("%-16s %8.2f %8.2f\n", parts[p].name, (double)cycles[p][0] / kTicks, (double)cycles[p][1] / kTicks);
+
+        CHECK(cycles[p][1] <= cycles[p][0]);
+    }
+    CHECK(wrong == 0);
+
+    //Only a register read twice in a row saves its index write: Tctl alone every tick, or a
+    //client reading it right after the tick's last batch ended on another register.
+    CHECK(cycles[0][1] == kTicks + 1);
+    CHECK(cycles[1][1] == cycles[1][0]);
+    CHECK(cycles[2][1] == cycles[2][0]);
+    CHECK(cycles[3][1] == 2 * kTicks + 1);
+
+    //Dropping the cached index rewrites it once.
+    AMDRyzenCPUSMN smn;
+    smn.setHardware(&hw);
+    uint32_t value;
+    hw.resetConfigCounts();
+    smn.readBatch(&kTctl, &value, 1);
+    smn.readBatch(&kTctl, &value, 1);
+    CHECK(hw.getConfigWrites() == 1);
+    smn.invalidate();
+    smn.readBatch(&kTctl, &value, 1);
+    CHECK(hw.getConfigWrites() == 2 && hw.getConfigReads() == 3);
+
+    return TEST_RESULT("SMNBenchTests");
+}
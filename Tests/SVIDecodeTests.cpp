@@ -0,0 +1,86 @@
+//
+//  SVIDecodeTests.cpp
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#include "TestHarness.h"
+#include "../AMDRyzenCPUPowerManagement/AMDRyzenCPUSVI.h"
+
+/**
+ *  zenpower's integer decode, millivolts and milliamps, kept verbatim as the reference.
+ */
+static uint32_t zenpower_plane_to_vcc(uint32_t p){
+    uint32_t vdd_cor = (p >> 16) & 0xff;
+    return 1550 - ((625 * vdd_cor) / 100);
+}
+
+static uint32_t zenpower_current(uint32_t plane, uint32_t scale){
+    return (scale * (plane & 0xff)) / 1000;
+}
+
+struct SVISample {
+    uint8_t family, model;
+    uint32_t core, soc;
+    float coreV, coreA, socV, socA;
+};
+
+/**
+ *  Plane words in the k17H_M01H_SVI layout for each generation, with the readings zenpower reports for them.
+ */
+static const SVISample samples[] = {
+    // Summit Ridge, 1.3625V 87A core, 0.85V 9A SoC
+    { 0x17, 0x01, 0x001e0054, 0x00700019, 1.3625f, 87.29f, 0.85f, 9.02f },
+    // Picasso, 1.1875V 35A core, 0.9875V 5A SoC
+    { 0x17, 0x18, 0x003a0022, 0x005a000e, 1.1875f, 35.33f, 0.9875f, 5.05f },
+    // Matisse, 1.2875V 76A core, 1.0V 12A SoC
+    { 0x17, 0x71, 0x002a0073, 0x00580060, 1.2875f, 75.76f, 1.0f, 12.25f },
+    // Vermeer, 1.1V 132A core, 1.0375V 15A SoC
+    { 0x19, 0x21, 0x004800c8, 0x00520078, 1.1f, 131.76f, 1.0375f, 15.31f },
+};
+
+int main(){
+    for(const SVISample &s : samples){
+        const svi_plane_desc *sp = svi_plane_lookup(s.family, s.model);
+        CHECK(sp != nullptr);
+        if(!sp) continue;
+
+        float v, a;
+        svi_decode(s.core, sp->coreCurrentScale, &v, &a);
+        CHECK_NEAR(v, s.coreV, 0.0005);
+        CHECK_NEAR(a, s.coreA, 0.01);
+
+        svi_decode(s.soc, sp->socCurrentScale, &v, &a);
+        CHECK_NEAR(v, s.socV, 0.0005);
+        CHECK_NEAR(a, s.socA, 0.01);
+    }
+
+    //Every supported model and every IDD step agrees with zenpower to its integer rounding.
+    for(int i = 0; i < SVI_PLANE_TABLE_LEN; i++){
+        const svi_plane_desc *sp = &svi_plane_table[i];
+        bool zen2 = sp->family == 0x19 || sp->modelFirst >= 0x30;
+        uint32_t coreScale = zen2 ? 658823 : 1039211;
+        uint32_t socScale = zen2 ? 127596 : 360772;
+
+        CHECK(svi_plane_lookup(sp->family, sp->modelLast) == sp);
+
+        for(uint32_t raw = 0; raw < 0x100; raw++){
+            uint32_t reg = (raw << 16) | raw;
+            float v, a;
+
+            svi_decode(reg, sp->coreCurrentScale, &v, &a);
+            CHECK_NEAR(v * 1000, zenpower_plane_to_vcc(reg) > 1550 ? 0 : zenpower_plane_to_vcc(reg), 1.0);
+            CHECK_NEAR(a * 1000, zenpower_current(reg, coreScale), 1.0);
+
+            svi_decode(reg, sp->socCurrentScale, &v, &a);
+            CHECK_NEAR(a * 1000, zenpower_current(reg, socScale), 1.0);
+        }
+    }
+
+    //Unknown models stay unsupported rather than picking a neighbour's planes.
+    CHECK(svi_plane_lookup(0x17, 0x20) == nullptr);
+    CHECK(svi_plane_lookup(0x19, 0x50) == nullptr);
+
+    return TEST_RESULT("SVIDecodeTests");
+}
@@ -0,0 +1,165 @@
+//
+//  SchedulerBenchTests.cpp
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#include <time.h>
+
+#include "TestHarness.h"
+#include "SimTopology.h"
+
+#include "../AMDRyzenCPUPowerManagement/AMDRyzenCPUSimulatedHardware.hpp"
+
+extern "C" {
+extern pmProcessor_t *pmRyzen_cpus;
+extern pmRyzenCCX_t *pmRyzen_ccx;
+extern uint32_t pmRyzen_last_woken_cpu;
+}
+
+/**
+ *  Threads wake one after another on a 2 socket, 128 thread topology brought up through
+ *  pmRyzen_init, each asking pmRyzen_choose_cpu for a CPU with the one it last ran on as the
+ *  preferred CPU and moving there. The other CPUs go idle and wake at random around a target
+ *  load, through the same cpu_awake and CCX awake bits pmRyzen_machine_idle maintains.
+ *
+ *  Every wake is also put to the policy pmRyzen_choose_cpu replaced, the preferred CPU if
+ *  awake, else the last CPU anyone woke on, so both are scored on the same machine state.
+ */
+
+static const uint32_t kThreads = 96;
+static const uint32_t kWakes = 200000;
+
+static uint32_t rng;
+static uint32_t rnd(uint32_t n){
+    rng = rng * 1664525 + 1013904223;
+    return (rng >> 8) % n;
+}
+
+static void setAwake(uint32_t cpu, bool awake){
+    pmProcessor_t *p = &pmRyzen_cpus[cpu];
+    p->cpu_awake = awake;
+    if(awake) pmRyzen_ccx[p->ccx].awake |= 1ULL << p->ccx_bit;
+    else pmRyzen_ccx[p->ccx].awake &= ~(1ULL << p->ccx_bit);
+}
+
+static int choosePrevious(int preferred){
+    if(pmRyzen_cpus[preferred].cpu_awake) return preferred;
+    if(pmRyzen_cpus[pmRyzen_last_woken_cpu].cpu_awake) return pmRyzen_last_woken_cpu;
+    return preferred;
+}
+
+struct Result {
+    uint32_t crossCCX;
+    uint32_t crossPackage;
+    uint32_t woken;         // Wakes that had to bring an idle CPU up
+    uint32_t avoidable;     // Left the CCX although a CPU in it was awake
+    double ns;
+
+    void count(int preferred, int chosen){
+        pmProcessor_t *from = &pmRyzen_cpus[preferred], *to = &pmRyzen_cpus[chosen];
+        if(from->ccx != to->ccx){
+            crossCCX++;
+            if(pmRyzen_ccx[from->ccx].awake) avoidable++;
+        }
+        if(from->lcpu->package != to->lcpu->package) crossPackage++;
+        if(!to->cpu_awake) woken++;
+    }
+};
+
+static double nsSince(const timespec &start){
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) * 1e9 + (now.tv_nsec - start.tv_nsec);
+}
+
+/**
+ *  load is the share of CPUs kept awake in percent, local the share of the background
+ *  changes made on package 0, which is held at twice the load, as when one socket runs a
+ *  busy process and the other mostly sleeps.
+ */
+static void run(uint32_t n, uint32_t load, uint32_t local, Result *previous, Result *current){
+    rng = 1;
+    uint32_t home[kThreads];
+    for(uint32_t t = 0; t < kThreads; t++) home[t] = rnd(n);
+    for(uint32_t i = 0; i < n; i++) setAwake(i, rnd(100) < load);
+    pmRyzen_last_woken_cpu = 0;
+
+    *previous = {};
+    *current = {};
+    for(uint32_t w = 0; w < kWakes; w++){
+        //Background: one CPU changes state per wake, pulled toward the load.
+        uint32_t bg = rnd(100) < local ? rnd(n / 2) : rnd(n);
+        bool package0 = pmRyzen_cpus[bg].lcpu->package->lpkg_num == 0;
+        setAwake(bg, rnd(100) < (local && package0 ? load * 2 : load));
+
+        uint32_t t = rnd(kThreads);
+        int pref = home[t];
+
+        timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int before = choosePrevious(pref);
+        previous->ns += nsSince(start);
+        previous->count(pref, before);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int chosen = pmRyzen_choose_cpu(-1, -1, pref);
+        current->ns += nsSince(start);
+        current->count(pref, chosen);
+
+        setAwake(chosen, true);
+        pmRyzen_last_woken_cpu = chosen;
+        home[t] = chosen;
+    }
+    previous->ns /= kWakes;
+    current->ns /= kWakes;
+
+    //pmRyzen_stop waits for every CPU to be out of idle.
+    for(uint32_t i = 0; i < n; i++) setAwake(i, true);
+}
+
+int main(){
+    static AMDRyzenCPUSimulatedHardware hw(128, 1000);
+    AMDRyzenCPUHardware::setShared(&hw);
+    hw.setCPUID(0x8000001D, 3, 7 << 14, 0, 0, 0);
+    hw.setMSR(0, MSR_PSTATE_0, 0x8000000000000890ULL);
+    hw.setMSR(0, MSR_PSTATE_0 + 1, 0x8000000000000878ULL);
+    for(uint32_t i = 0; i < 128; i++) hw.setMSR(i, MSR_PSTATE_CTL, 0);
+
+    SimTopology topo(2, 32, 2);
+    hostSetTopology(topo.root());
+    CHECK(pmRyzen_init(nullptr, topo.getNumCPUs()));
+    uint32_t n = pmRyzen_num_slots;
+
+    static const struct { const char *name; uint32_t load; uint32_t local; } patterns[] = {
+        {"light", 10, 0},
+        {"half", 50, 0},
+        {"heavy", 85, 0},
+        {"one socket", 25, 80},
+    };
+
+    printf("%-11s %-9s %9s %9s %9s %9s %8s\n", "pattern", "policy", "xCCX/1k", "xPkg/1k", "woken/1k", "avoidable", "ns/call");
+    for(auto &p : patterns){
+        Result before, after;
+        run(n, p.load, p.local, &before, &after);
+
+        const Result *rs[] = {&before, &after};
+        for(int i = 0; i < 2; i++){
+            printf("%-11s %-9s %9.1f %9.1f %9.1f %9u %8.1f\n", p.name, i ? "ccx" : "previous",
+                   rs[i]->crossCCX * 1000.0 / kWakes, rs[i]->crossPackage * 1000.0 / kWakes,
+                   rs[i]->woken * 1000.0 / kWakes, rs[i]->avoidable, rs[i]->ns);
+        }
+
+        //Never leaves a CCX that had somewhere to run, and never migrates more than before.
+        CHECK(before.avoidable > 0);
+        CHECK(after.avoidable == 0);
+        CHECK(after.crossCCX <= before.crossCCX);
+        CHECK(after.crossPackage <= before.crossPackage);
+    }
+
+    pmRyzen_stop();
+    pmRyzen_free();
+
+    return TEST_RESULT("SchedulerBenchTests");
+}
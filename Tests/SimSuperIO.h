@@ -0,0 +1,237 @@
+//
+//  SimSuperIO.h
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#ifndef SimSuperIO_h
+#define SimSuperIO_h
+
+#include "../AMDRyzenCPUPowerManagement/AMDRyzenCPUSimulatedHardware.hpp"
+
+/**
+ *  SuperIO chips as seen from the LPC bus, written from the datasheets rather than from
+ *  ISSuperIOChipTable.cpp so the table is checked against something independent.
+ *
+ *  SimSuperIO is the configuration port: the entry key, chip ID at 0x20/0x21, logical device
+ *  select at 0x07 and the hardware monitor base at 0x60/0x61, only for the right LDN.
+ *  Subclasses add the hardware monitor behind the base address, registers are addressed
+ *  as (bank << 8) | index like the driver does.
+ */
+class SimSuperIO : public AMDRyzenCPUSimulatedHardware::PortDevice {
+
+public:
+    enum ExitStyle {
+        kExitAA,        // 0xAA to the index port (Nuvoton)
+        kExitConfReg2,  // Bit 1 of config register 0x02 (ITE)
+    };
+
+    SimSuperIO(uint16_t configPort, const uint8_t *key, int keyLen, ExitStyle exitStyle,
+               uint16_t id, uint8_t ldn, uint16_t base) :
+    configPort(configPort), key(key), keyLen(keyLen), exitStyle(exitStyle), id(id), ldn(ldn), base(base) {}
+
+    uint8_t conf[256] {};
+
+    //Garbage in the low bits of the reported base, for chips whose driver masks them off.
+    uint8_t baseJunk = 0;
+
+    bool configOpen() const { return unlocked; }
+
+    void attach(AMDRyzenCPUSimulatedHardware &hw, uint16_t hwmPorts){
+        hw.attachPortDevice(configPort, configPort + 1, this);
+        hw.attachPortDevice(base, base + hwmPorts - 1, this);
+    }
+
+    virtual uint8_t &reg(uint16_t addr) = 0;
+
+    uint8_t read8(uint16_t port) override {
+        if(port == configPort) return 0xff;
+        if(port != configPort + 1) return hwmRead(port);
+        if(!unlocked) return 0xff;
+
+        switch (confIdx) {
+            case 0x20: return id >> 8;
+            case 0x21: return id & 0xff;
+            case 0x60: return conf[0x07] == ldn ? base >> 8 : 0;
+            case 0x61: return conf[0x07] == ldn ? (base & 0xff) | baseJunk : 0;
+            default: return conf[confIdx];
+        }
+    }
+
+    void write8(uint16_t port, uint8_t value) override {
+        if(port == configPort){
+            if(unlocked){
+                if(exitStyle == kExitAA && value == 0xaa) unlocked = false;
+                else confIdx = value;
+                return;
+            }
+
+            keyPos = value == key[keyPos] ? keyPos + 1 : value == key[0];
+            if(keyPos == keyLen){
+                unlocked = true;
+                keyPos = 0;
+            }
+        } else if(port == configPort + 1){
+            if(!unlocked) return;
+            conf[confIdx] = value;
+            if(exitStyle == kExitConfReg2 && confIdx == 0x02 && (value & 0x02)) unlocked = false;
+        } else {
+            hwmWrite(port, value);
+        }
+    }
+
+protected:
+    virtual uint8_t hwmRead(uint16_t port) = 0;
+    virtual void hwmWrite(uint16_t port, uint8_t value) = 0;
+
+    uint16_t configPort;
+    const uint8_t *key;
+    int keyLen;
+    ExitStyle exitStyle;
+
+    uint16_t id;
+    uint8_t ldn;
+    uint16_t base;
+
+    bool unlocked = false;
+    int keyPos = 0;
+    uint8_t confIdx = 0;
+};
+
+static const uint8_t kSimNuvotonKey[] = {0x87, 0x87};
+static const uint8_t kSimITEKey2E[] = {0x87, 0x01, 0x55, 0x55};
+static const uint8_t kSimITEKey4E[] = {0x87, 0x01, 0x55, 0xaa};
+
+/**
+ *  NCT67XX, hardware monitor at base+5/+6 banked through register 0x4E.
+ */
+class SimNCT67XX : public SimSuperIO {
+
+public:
+    SimNCT67XX(uint16_t id, uint16_t base, uint16_t configPort = 0x2e) :
+    SimSuperIO(configPort, kSimNuvotonKey, 2, kExitAA, id, 0x0b, base) {}
+
+    uint8_t regs[16][256] {};
+
+    uint8_t &reg(uint16_t addr) override { return regs[(addr >> 8) & 0xf][addr & 0xff]; }
+
+protected:
+    uint8_t hwmRead(uint16_t port) override {
+        if(port == base + 6) return hwmIdx == 0x4e ? bank : regs[bank][hwmIdx];
+        return 0xff;
+    }
+
+    void hwmWrite(uint16_t port, uint8_t value) override {
+        if(port == base + 5){
+            hwmIdx = value;
+        } else if(port == base + 6){
+            if(hwmIdx == 0x4e) bank = value & 0xf;
+            else regs[bank][hwmIdx] = value;
+        }
+    }
+
+private:
+    uint8_t hwmIdx = 0;
+    uint8_t bank = 0;
+};
+
+/**
+ *  NCT6681/NCT6683, the monitor belongs to an EC: page port at base, index at base+1 and
+ *  data at base+2, a page is selected by writing 0xFF then its number.
+ *
+ *  Fan commands at 0xA28 onwards are only taken between a request (0x80) and a done (0x40)
+ *  on 0xA01, done copies the ones written to the duty cycle registers at 0x160.
+ */
+class SimNCT668X : public SimSuperIO {
+
+public:
+    SimNCT668X(uint16_t id, uint16_t base, uint16_t configPort = 0x2e) :
+    SimSuperIO(configPort, kSimNuvotonKey, 2, kExitAA, id, 0x0b, base) {}
+
+    uint8_t regs[16][256] {};
+
+    bool requestPending = false;
+    uint32_t commandsApplied = 0;
+    uint32_t commandsDropped = 0;
+
+    uint8_t &reg(uint16_t addr) override { return regs[(addr >> 8) & 0xf][addr & 0xff]; }
+
+protected:
+    uint8_t hwmRead(uint16_t port) override {
+        if(port == base + 2) return regs[page][hwmIdx];
+        return 0xff;
+    }
+
+    void hwmWrite(uint16_t port, uint8_t value) override {
+        if(port == base){
+            if(pageArmed){
+                page = value & 0xf;
+                pageArmed = false;
+            } else {
+                pageArmed = value == 0xff;
+            }
+        } else if(port == base + 1){
+            hwmIdx = value;
+        } else if(port == base + 2){
+            uint16_t addr = (page << 8) | hwmIdx;
+
+            if(addr == 0xa01){
+                if(value == 0x80){
+                    requestPending = true;
+                } else if(value == 0x40 && requestPending){
+                    for(int i = 0; i < 16; i++)
+                        if(written & (1 << i)) regs[1][0x60 + i] = regs[0xa][0x28 + i];
+                    written = 0;
+                    requestPending = false;
+                    commandsApplied++;
+                }
+            } else if(addr >= 0xa28 && addr <= 0xa37){
+                if(requestPending){
+                    regs[0xa][hwmIdx] = value;
+                    written |= 1 << (addr - 0xa28);
+                } else {
+                    commandsDropped++;
+                }
+            } else {
+                regs[page][hwmIdx] = value;
+            }
+        }
+    }
+
+private:
+    uint16_t written = 0;
+    bool pageArmed = false;
+    uint8_t page = 0;
+    uint8_t hwmIdx = 0;
+};
+
+/**
+ *  IT86XX, flat register space at base+5/+6.
+ */
+class SimIT86XX : public SimSuperIO {
+
+public:
+    SimIT86XX(uint16_t id, uint16_t base, uint16_t configPort = 0x2e) :
+    SimSuperIO(configPort, configPort == 0x4e ? kSimITEKey4E : kSimITEKey2E, 4, kExitConfReg2, id, 0x04, base) {}
+
+    uint8_t regs[256] {};
+
+    uint8_t &reg(uint16_t addr) override { return regs[addr & 0xff]; }
+
+protected:
+    uint8_t hwmRead(uint16_t port) override {
+        if(port == base + 6) return regs[hwmIdx];
+        return 0xff;
+    }
+
+    void hwmWrite(uint16_t port, uint8_t value) override {
+        if(port == base + 5) hwmIdx = value;
+        else if(port == base + 6) regs[hwmIdx] = value;
+    }
+
+private:
+    uint8_t hwmIdx = 0;
+};
+
+#endif /* SimSuperIO_h */
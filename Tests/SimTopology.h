@@ -0,0 +1,104 @@
+//
+//  SimTopology.h
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#ifndef SimTopology_h
+#define SimTopology_h
+
+#include <stdlib.h>
+
+#include "HostSupport.h"
+
+/**
+ *  The package/core/lcpu tree XNU would build for a Zen system, for hostSetTopology.
+ *
+ *  APIC IDs are (package, core, thread) packed from the low bits up with each field as wide as
+ *  it needs. cpu_num follows the order XNU brings CPUs up in: every first thread of every
+ *  package, then the second threads, so SMT siblings and packages are never adjacent.
+ */
+class SimTopology {
+
+public:
+    SimTopology(uint32_t packages, uint32_t coresPerPackage, uint32_t threadsPerCore) :
+    packages(packages), cores(coresPerPackage), threads(threadsPerCore) {
+        uint32_t numCores = packages * cores;
+        numCPUs = numCores * threads;
+
+        pkgs = (x86_pkg_t*)calloc(packages, sizeof(x86_pkg_t));
+        coreList = (x86_core_t*)calloc(numCores, sizeof(x86_core_t));
+        lcpus = (x86_lcpu_t*)calloc(numCPUs, sizeof(x86_lcpu_t));
+
+        threadBits = bits(threads);
+        coreBits = bits(cores);
+
+        for(uint32_t p = 0; p < packages; p++){
+            x86_pkg_t *pkg = &pkgs[p];
+            pkg->lpkg_num = pkg->ppkg_num = p;
+            pkg->next = p + 1 < packages ? &pkgs[p + 1] : nullptr;
+
+            for(uint32_t c = 0; c < cores; c++){
+                x86_core_t *core = &coreList[p * cores + c];
+                core->package = pkg;
+                core->pcore_num = p * cores + c;
+                core->lcore_num = c;
+                core->num_lcpus = threads;
+                core->next_in_pkg = c + 1 < cores ? core + 1 : nullptr;
+                if(!c) pkg->cores = core;
+
+                for(uint32_t t = 0; t < threads; t++){
+                    x86_lcpu_t *lcpu = &lcpus[(p * cores + c) * threads + t];
+                    lcpu->lcpu = lcpu;
+                    lcpu->core = core;
+                    lcpu->package = pkg;
+                    lcpu->lnum = t;
+                    lcpu->pnum = (p << (coreBits + threadBits)) | (c << threadBits) | t;
+                    lcpu->cpu_num = t * numCores + p * cores + c;
+                    lcpu->master = lcpu->cpu_num == 0;
+                    lcpu->primary = !c && !t;
+                    lcpu->next_in_core = t + 1 < threads ? lcpu + 1 : nullptr;
+                    if(!t) core->lcpus = lcpu;
+                    if(!c && !t) pkg->lcpus = lcpu;
+                }
+            }
+        }
+    }
+
+    ~SimTopology(){
+        free(lcpus);
+        free(coreList);
+        free(pkgs);
+    }
+
+    x86_pkg_t *root(){ return pkgs; }
+    uint32_t getNumCPUs() const { return numCPUs; }
+
+    x86_lcpu_t *lcpuFor(uint32_t cpuNum){
+        for(uint32_t i = 0; i < numCPUs; i++)
+            if(lcpus[i].cpu_num == cpuNum) return &lcpus[i];
+        return nullptr;
+    }
+
+    uint32_t packages;
+    uint32_t cores;
+    uint32_t threads;
+
+private:
+    static uint32_t bits(uint32_t n){
+        uint32_t b = 0;
+        while((1U << b) < n) b++;
+        return b;
+    }
+
+    uint32_t numCPUs;
+    uint32_t threadBits;
+    uint32_t coreBits;
+
+    x86_pkg_t *pkgs;
+    x86_core_t *coreList;
+    x86_lcpu_t *lcpus;
+};
+
+#endif /* SimTopology_h */
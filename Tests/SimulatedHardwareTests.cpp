@@ -0,0 +1,187 @@
+//
+//  SimulatedHardwareTests.cpp
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#include <stdlib.h>
+
+#include "TestHarness.h"
+#include "SimSuperIO.h"
+
+#include "../AMDRyzenCPUPowerManagement/AMDRyzenCPUSimulatedHardware.hpp"
+#include "../AMDRyzenCPUPowerManagement/SuperIO/ISSuperIOGeneric.hpp"
+
+extern "C" {
+#include "../AMDRyzenCPUPowerManagement/pmAMDRyzen.h"
+
+extern pmProcessor_t *pmRyzen_cpus;
+}
+
+static void testMachineModel(AMDRyzenCPUSimulatedHardware &hw){
+    //Unknown MSRs fault, known ones are per CPU.
+    uint64_t v = 0;
+    CHECK(!hw.readMSR(0xc0010299, &v));
+    CHECK(!hw.writeMSR(0xc0010299, 1));
+
+    hw.setMSR(1, 0xc0010299, 0x000a1003);
+    hw.setCurrentCPU(1);
+    CHECK(hw.readMSR(0xc0010299, &v) && v == 0x000a1003);
+    hw.setCurrentCPU(0);
+    CHECK(!hw.readMSR(0xc0010299, &v));
+
+    //SMN through the root complex index/data pair.
+    hw.setSMN(0x0005a010, 0x00580060);
+    hw.pciConfigWrite32(AMDRyzenCPUSimulatedHardware::kSMNIndex, 0x0005a010);
+    CHECK(hw.pciConfigRead32(AMDRyzenCPUSimulatedHardware::kSMNData) == 0x00580060);
+    hw.pciConfigWrite32(AMDRyzenCPUSimulatedHardware::kSMNIndex, 0x0005a014);
+    CHECK(hw.pciConfigRead32(AMDRyzenCPUSimulatedHardware::kSMNData) == 0xffffffff);
+
+    //Cross calls only visit the mask, rendezvous everyone, both restore the caller.
+    static uint64_t visited;
+    uint64_t mask[2] = {0x5, 0};
+    visited = 0;
+    hw.setCurrentCPU(2);
+    hw.crossCall(mask, 2, [](void *obj) {
+        visited |= 1ULL << static_cast<AMDRyzenCPUHardware*>(obj)->cpuNumber();
+    }, &hw);
+    CHECK(visited == 0x5);
+    CHECK(hw.cpuNumber() == 2);
+
+    visited = 0;
+    hw.rendezvousNoIntrs([](void *obj) {
+        visited |= 1ULL << static_cast<AMDRyzenCPUHardware*>(obj)->cpuNumber();
+    }, &hw);
+    CHECK(visited == (1ULL << hw.getNumCPUs()) - 1);
+    CHECK(hw.cpuNumber() == 2);
+    hw.setCurrentCPU(0);
+
+    uint64_t t0 = hw.readTSC();
+    CHECK(hw.readTSC() - t0 == 1000);
+}
+
+static void testPStateAndSampling(AMDRyzenCPUSimulatedHardware &hw){
+    uint32_t n = hw.getNumCPUs();
+    pmRyzen_num_slots = n;
+    pmRyzen_cpus = (pmProcessor_t*)calloc(n, sizeof(pmProcessor_t));
+
+    for(uint32_t i = 0; i < n; i++){
+        pmRyzen_cpus[i].pstate_pin = PMRYZEN_PSTATE_UNPINNED;
+        hw.setMSR(i, MSR_PSTATE_CTL, 0);
+        hw.setMSR(i, MSR_APERF, 0, 900);
+        hw.setMSR(i, MSR_MPERF, 0, 1000);
+        hw.setMSR(i, MSR_IRPC, 0, 500);
+        hw.setMSR(i, MSR_CORE_ENERGY_STAT, 0, 7);
+    }
+
+    pmRyzen_PState_reset();
+    CHECK(pmRyzen_hpcpus == n);
+
+    //Pinning reaches every CPU through its own MSR.
+    uint64_t mask[1] = {(1ULL << n) - 1};
+    hw.crossCall(mask, 1, [](void *) { pmRyzen_pin_PState(2, 0); }, nullptr);
+    for(uint32_t i = 0; i < n; i++){
+        CHECK(hw.getMSR(i, MSR_PSTATE_CTL) == 2);
+        CHECK(pmRyzen_cpus[i].PState == 2);
+    }
+    CHECK(pmRyzen_hpcpus == 0);
+
+    //Unpinning leaves the governor's view in step with the MSR it wrote.
+    mask[0] = 0x3;
+    hw.crossCall(mask, 1, [](void *) { pmRyzen_pin_PState(PMRYZEN_PSTATE_UNPINNED, 0); }, nullptr);
+    for(uint32_t i = 0; i < n; i++){
+        uint8_t expect = i < 2 ? 0 : 2;
+        CHECK(hw.getMSR(i, MSR_PSTATE_CTL) == expect);
+        CHECK(pmRyzen_cpus[i].PState == expect);
+        CHECK(pmRyzen_cpus[i].pstate_pin == (i < 2 ? PMRYZEN_PSTATE_UNPINNED : 2));
+    }
+    CHECK(pmRyzen_hpcpus == 2);
+
+    //Rewriting P0 on a CPU already in P0 keeps the MSR write but must not count it again.
+    mask[0] = 0x1;
+    hw.crossCall(mask, 1, [](void *) { pmRyzen_pin_PState(0, 0); }, nullptr);
+    CHECK(pmRyzen_hpcpus == 2);
+    hw.crossCall(mask, 1, [](void *) { pmRyzen_pin_PState(PMRYZEN_PSTATE_UNPINNED, 0); }, nullptr);
+    CHECK(pmRyzen_hpcpus == 2);
+    CHECK(hw.getMSRWrites(0, MSR_PSTATE_CTL) == 5);
+
+    //The context switch hook samples the CPU it runs on, through the hardware hooks.
+    pmRyzen_hf_interval_tsc = 1;
+    hw.setCurrentCPU(1);
+    for(int i = 0; i < 5; i++) pmRyzen_thread_off_core(nullptr, false, 0, true);
+    hw.setCurrentCPU(0);
+
+    pmRyzenHF_t hf;
+    CHECK(pmRyzen_hf_read(1, &hf));
+    CHECK(hf.samples == 4);
+    CHECK(hf.aperf_acc == 4 * 900);
+    CHECK(hf.mperf_acc == 4 * 1000);
+    CHECK(hf.irpc_acc == 4 * 500);
+    CHECK(hf.energy_acc == 4 * 7);
+    CHECK(hf.ratio_min == (900 << HF_RATIO_SHIFT) / 1000);
+    CHECK(hf.ratio_max == hf.ratio_min);
+
+    CHECK(pmRyzen_hf_read(0, &hf));
+    CHECK(hf.samples == 0);
+
+    pmRyzen_hf_interval_tsc = 0;
+    
+    //Without a topology behind the slot the hint is the preferred CPU itself.
+    CHECK(pmRyzen_choose_cpu(0, n - 1, 3) == 3);
+    
+    free(pmRyzen_cpus);
+    pmRyzen_cpus = nullptr;
+}
+
+static void testSuperIO(AMDRyzenCPUSimulatedHardware &hw){
+    SimNCT67XX chip(0xd802, 0x290);
+    chip.attach(hw, 8);
+
+    chip.conf[0x28] = 0x10;
+    chip.regs[4][0xc2] = 0x04;
+    chip.regs[4][0xc3] = 0xb0;
+    chip.regs[2][0x02] = 0x50;
+    chip.regs[2][0x09] = 0x80;
+    chip.regs[4][0x80] = 110;
+    chip.regs[4][0x83] = 206;
+    chip.regs[4][0x90] = 38;
+
+    uint16_t chipIntel = 0;
+    ISSuperIOGeneric *dev = ISSuperIOGeneric::getDevice(&chipIntel);
+    CHECK(dev != nullptr);
+    if(!dev) return;
+
+    CHECK(chipIntel == 0xd802);
+    CHECK(dev->getNumberOfFans() == 7);
+    CHECK(chip.conf[0x28] == 0);
+
+    dev->updateFanRPMS();
+    dev->updateFanControl();
+    CHECK(dev->getRPMForFan(1) == 1200);
+    CHECK(dev->getFanThrottle(1) == 0x80);
+    CHECK(dev->getFanAutoControlMode(1));
+
+    dev->overrideFanControl(1, 0x40);
+    CHECK(chip.regs[2][0x02] == 0);
+    CHECK(chip.regs[2][0x09] == 0x40);
+    dev->setDefaultFanControl(1);
+    CHECK(chip.regs[2][0x02] == 0x50);
+
+    dev->updateSensors();
+    CHECK_NEAR(dev->getVoltage(0), 0.88, 0.001);
+    CHECK_NEAR(dev->getVoltage(3), 3.296, 0.001);
+    CHECK_NEAR(dev->getTemperature(0), 38, 0.001);
+
+}
+
+int main(){
+    AMDRyzenCPUSimulatedHardware hw(4, 1000);
+    AMDRyzenCPUHardware::setShared(&hw);
+
+    testMachineModel(hw);
+    testPStateAndSampling(hw);
+    testSuperIO(hw);
+
+    return TEST_RESULT("SimulatedHardwareTests");
+}
@@ -0,0 +1,178 @@
+//
+//  SnapshotTests.cpp
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "TestHarness.h"
+#include "../AMDRyzenCPUPowerManagement/AMDRyzenCPUPMSnapshot.h"
+
+/**
+ *  Encodes snapshots the way encodeSnapshot does, through AMDRyzenSnapshotBeginEncode and
+ *  AMDRyzenSnapshotSectionOut, and decodes them the way a client does through
+ *  AMDRyzenSnapshotSection, for every field mask and a few core counts.
+ *
+ *  Section payload sizes are written out here from the enum's comments rather than taken
+ *  from AMDRyzenSnapshotSectionSize, so a layout change shows up as a failure.
+ */
+
+struct Counts {
+    uint32_t phys;
+    uint32_t logical;
+    uint32_t fans;
+    uint32_t ccds;
+};
+
+static const Counts counts[] = {
+    {1, 1, 0, 1},
+    {3, 5, 1, 1},       // Odd counts leave padding behind the byte and float sections
+    {8, 16, 7, 2},
+    {64, 128, 3, 8},
+};
+
+static const uint32_t kBufSize = 64 * 1024;
+
+static uint32_t payloadSize(const Counts &c, uint32_t field){
+    switch (field) {
+        case kAMDRyzenSnapshotPackage:      return 16;
+        case kAMDRyzenSnapshotCoreFreq:     return c.phys * 4;
+        case kAMDRyzenSnapshotCoreLoad:     return c.phys * 4;
+        case kAMDRyzenSnapshotInstRetired:  return c.logical * 8;
+        case kAMDRyzenSnapshotPState:       return c.logical;
+        case kAMDRyzenSnapshotFans:         return c.fans * 8;
+        case kAMDRyzenSnapshotCorePower:    return c.phys * 4;
+        case kAMDRyzenSnapshotEnergy:       return (1 + c.phys) * 8;
+        case kAMDRyzenSnapshotCCDTemp:      return c.ccds * 4;
+        case kAMDRyzenSnapshotSVI:          return 24;
+        case kAMDRyzenSnapshotHighFreq:     return c.logical * 32;
+        default:                            return 0;
+    }
+}
+
+//Payload byte i of a section, never zero so a missing write is told apart from padding.
+static uint8_t patternByte(uint32_t field, uint32_t i){
+    return (uint8_t)(((__builtin_ctz(field) + 1) * 37 + i * 11) | 1);
+}
+
+static uint32_t encode(uint8_t *buf, uint32_t bufSize, const Counts &c, uint32_t mask){
+    AMDRyzenSnapshotHeader hdr {};
+    hdr.fieldMask = mask;
+    hdr.numPhysCores = c.phys;
+    hdr.numLogicalCores = c.logical;
+    hdr.numFans = c.fans;
+    hdr.numCCDs = c.ccds;
+    hdr.timestampNs = 0x0123456789abcdefULL;
+
+    uint32_t size = AMDRyzenSnapshotBeginEncode(buf, bufSize, &hdr);
+    if(!size) return 0;
+
+    for(uint32_t f = 1; f & kAMDRyzenSnapshotAllFields; f <<= 1){
+        uint8_t *out = (uint8_t*)AMDRyzenSnapshotSectionOut(buf, f);
+        CHECK(!out == !(mask & f));
+        if(!out) continue;
+
+        for(uint32_t i = 0; i < payloadSize(c, f); i++) out[i] = patternByte(f, i);
+    }
+    return size;
+}
+
+static void roundTrip(const Counts &c, uint32_t mask, uint8_t *buf){
+    //Stale bytes where the snapshot goes, none may survive the encode.
+    memset(buf, 0xa5, kBufSize);
+    uint32_t size = encode(buf, kBufSize, c, mask);
+
+    uint32_t expectSize = AMDRyzenSnapshotAlign(sizeof(AMDRyzenSnapshotHeader));
+    for(uint32_t f = 1; f & kAMDRyzenSnapshotAllFields; f <<= 1)
+        if(mask & f) expectSize += AMDRyzenSnapshotAlign(payloadSize(c, f));
+    CHECK(size == expectSize);
+
+    const AMDRyzenSnapshotHeader *hdr = (const AMDRyzenSnapshotHeader*)buf;
+    CHECK(hdr->version == AMDRYZEN_SNAPSHOT_VERSION);
+    CHECK(hdr->headerSize == sizeof(AMDRyzenSnapshotHeader));
+    CHECK(hdr->totalSize == size);
+    CHECK(hdr->fieldMask == mask);
+    CHECK(hdr->numPhysCores == c.phys && hdr->numLogicalCores == c.logical);
+    CHECK(hdr->numFans == c.fans && hdr->numCCDs == c.ccds);
+    CHECK(hdr->timestampNs == 0x0123456789abcdefULL);
+    CHECK(buf[size] == 0xa5);
+
+    //Every section where the decoder looks, 8 byte aligned, back to back and zero padded.
+    uint32_t expectOffset = AMDRyzenSnapshotAlign(sizeof(AMDRyzenSnapshotHeader));
+    uint32_t bad = 0;
+    for(uint32_t f = 1; f & kAMDRyzenSnapshotAllFields; f <<= 1){
+        const uint8_t *sec = (const uint8_t*)AMDRyzenSnapshotSection(buf, size, f);
+        if(!(mask & f)){
+            bad += sec != nullptr;
+            continue;
+        }
+        if(sec != buf + expectOffset){
+            bad++;
+            continue;
+        }
+
+        uint32_t payload = payloadSize(c, f);
+        for(uint32_t i = 0; i < payload; i++) bad += sec[i] != patternByte(f, i);
+        for(uint32_t i = payload; i < AMDRyzenSnapshotAlign(payload); i++) bad += sec[i] != 0;
+        expectOffset += AMDRyzenSnapshotAlign(payload);
+    }
+    for(uint32_t i = sizeof(AMDRyzenSnapshotHeader); i < AMDRyzenSnapshotAlign(sizeof(AMDRyzenSnapshotHeader)); i++)
+        bad += buf[i] != 0;
+    CHECK(bad == 0);
+
+    //The last present section needs every byte of the snapshot.
+    uint32_t last = 0;
+    for(uint32_t f = 1; f & kAMDRyzenSnapshotAllFields; f <<= 1) if(mask & f) last = f;
+    if(last && payloadSize(c, last)){
+        CHECK(AMDRyzenSnapshotSection(buf, size - 1, last) == nullptr);
+        CHECK(AMDRyzenSnapshotSection(buf, size, last) != nullptr);
+    }
+
+    //A buffer one byte short is refused without being touched.
+    memset(buf, 0xa5, kBufSize);
+    CHECK(encode(buf, size - 1, c, mask) == 0);
+    CHECK(buf[0] == 0xa5 && buf[size - 2] == 0xa5);
+}
+
+int main(){
+    uint8_t *buf = (uint8_t*)malloc(kBufSize);
+
+    for(const Counts &c : counts){
+        for(uint32_t mask = 0; mask <= kAMDRyzenSnapshotAllFields; mask++){
+            roundTrip(c, mask, buf);
+        }
+    }
+
+    //Bits nobody knows about yet are dropped by the encoder.
+    const Counts &c = counts[1];
+    uint32_t size = encode(buf, kBufSize, c, 0xfffff000 | kAMDRyzenSnapshotSVI);
+    CHECK(((AMDRyzenSnapshotHeader*)buf)->fieldMask == kAMDRyzenSnapshotSVI);
+    CHECK(size == AMDRyzenSnapshotAlign(sizeof(AMDRyzenSnapshotHeader)) + 24);
+
+    //A newer kext with a longer header: sections move, this decoder still finds them.
+    encode(buf, kBufSize, c, kAMDRyzenSnapshotAllFields);
+    AMDRyzenSnapshotHeader *hdr = (AMDRyzenSnapshotHeader*)buf;
+    const uint8_t *svi = (const uint8_t*)AMDRyzenSnapshotSection(buf, hdr->totalSize, kAMDRyzenSnapshotSVI);
+    uint8_t sviCopy[24];
+    memcpy(sviCopy, svi, sizeof(sviCopy));
+
+    uint32_t grow = 16;
+    memmove(buf + hdr->headerSize + grow, buf + hdr->headerSize, hdr->totalSize - hdr->headerSize);
+    hdr->headerSize += grow;
+    hdr->totalSize += grow;
+    svi = (const uint8_t*)AMDRyzenSnapshotSection(buf, hdr->totalSize, kAMDRyzenSnapshotSVI);
+    CHECK(svi && !memcmp(svi, sviCopy, sizeof(sviCopy)));
+
+    //Another version or a buffer without a whole header is not decoded at all.
+    hdr->version++;
+    CHECK(AMDRyzenSnapshotSection(buf, hdr->totalSize, kAMDRyzenSnapshotPackage) == nullptr);
+    hdr->version--;
+    CHECK(AMDRyzenSnapshotSection(buf, sizeof(AMDRyzenSnapshotHeader) - 1, kAMDRyzenSnapshotPackage) == nullptr);
+    CHECK(AMDRyzenSnapshotSection(buf, hdr->totalSize, 1U << 20) == nullptr);
+
+    free(buf);
+    return TEST_RESULT("SnapshotTests");
+}
@@ -0,0 +1,198 @@
+//
+//  SpinBudgetBenchTests.cpp
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#include "TestHarness.h"
+#include "SimTopology.h"
+
+#include "../AMDRyzenCPUPowerManagement/AMDRyzenCPUSimulatedHardware.hpp"
+
+extern "C" {
+extern pmProcessor_t *pmRyzen_cpus;
+}
+
+/**
+ *  The arm_flag/cpu_awake handshake of an MWAIT build, pmRyzen_exit_idle with its adaptive
+ *  spin budget against the fixed SPIN_MAX_TSC spin it replaced, one target CPU per kind of
+ *  idle state. This links pmAMDRyzen.c built with PMRYZEN_IDLE_MWAIT.
+ *
+ *  The target's side runs inside the TSC hook rather than on a thread of its own: once the
+ *  caller has stored arm_flag, the target stores cpu_awake as soon as its exit latency has
+ *  passed, or never if it does not answer the monitor line. Every TSC read stands for one
+ *  pause iteration of the spin. An IPI costs the caller kIPISend and reaches the target
+ *  kIPIWake later, unless the monitor line woke it first.
+ */
+
+static const uint64_t kStep = 64;
+static const uint64_t kIPISend = 1000;
+static const uint64_t kIPIWake = 0x1000;
+static const uint64_t kNever = ~0ULL;
+static const uint32_t kWakes = 20000;
+
+static uint32_t rng;
+static uint32_t rnd(uint32_t n){
+    rng = rng * 1664525 + 1013904223;
+    return (rng >> 8) % n;
+}
+
+class HandshakeHardware : public AMDRyzenCPUSimulatedHardware {
+
+public:
+    HandshakeHardware(uint32_t numCPUs) : AMDRyzenCPUSimulatedHardware(numCPUs, kStep) {}
+
+    //The target goes idle, it wakes latency TSC ticks after it sees arm_flag.
+    void sleep(pmProcessor_t *target, uint64_t latency){
+        remote = target;
+        remoteLatency = latency;
+        armed = false;
+        target->cpu_awake = 0;
+        target->arm_flag = 0;
+    }
+
+    void detach(){ remote = nullptr; }
+
+    uint64_t readTSC() override {
+        uint64_t now = AMDRyzenCPUSimulatedHardware::readTSC();
+        if(!remote) return now;
+
+        if(!armed && remote->arm_flag == kAMDRyzenTraceWakeArmed){
+            armed = true;
+            armedAt = now;
+        }
+        if(armed && remoteLatency != kNever && now - armedAt >= remoteLatency)
+            remote->cpu_awake = 1;
+
+        return now;
+    }
+
+private:
+    pmProcessor_t *remote = nullptr;
+    uint64_t remoteLatency = 0;
+    uint64_t armedAt = 0;
+    bool armed = false;
+};
+
+static HandshakeHardware *hw;
+
+//pmRyzen_exit_idle as it was, spinning up to SPIN_MAX_TSC on every target.
+static bool exitIdleFixed(pmProcessor_t *target){
+    uint64_t start = hw->readTSC();
+    do {
+        target->arm_flag = kAMDRyzenTraceWakeArmed;
+        if(hw->readTSC() - start > SPIN_MAX_TSC){
+            target->arm_flag = kAMDRyzenTraceWakeIPI;
+            return true;
+        }
+    } while(!target->cpu_awake);
+
+    return false;
+}
+
+struct Target {
+    const char *name;
+    uint64_t latency;       // Exit latency once armed, kNever if the monitor line is ignored
+    uint64_t jitter;
+    uint32_t deafUntil;     // Ignores the monitor line for this many wakes first
+};
+
+struct Cost {
+    uint64_t caller;        // TSC the waking CPU spent spinning and sending IPIs
+    uint64_t latency;       // TSC until the target was awake
+    uint32_t ipis;
+};
+
+static Cost bench(x86_lcpu_t *lcpu, const Target &t, bool adaptive, uint32_t from, uint32_t to){
+    pmProcessor_t *target = &pmRyzen_cpus[lcpu->cpu_num];
+    target->spin_est = SPIN_MAX_TSC / 2;
+    target->spin_fail = 0;
+    target->spin_probe = 0;
+
+    Cost cost = {};
+    rng = 1;
+    for(uint32_t i = 0; i < to; i++){
+        bool deaf = t.latency == kNever || i < t.deafUntil;
+        uint64_t latency = deaf ? kNever : t.latency + (t.jitter ? rnd((uint32_t)t.jitter) : 0);
+        hw->sleep(target, latency);
+
+        uint64_t start = hw->readTSC();
+        bool ipi = adaptive ? pmRyzen_exit_idle(lcpu) : exitIdleFixed(target);
+        uint64_t spun = hw->readTSC() - start;
+
+        uint64_t woke = ipi ? spun + kIPIWake : spun;
+        if(ipi && latency < woke) woke = latency;
+        target->cpu_awake = 1;
+
+        if(i < from) continue;
+        cost.caller += spun + (ipi ? kIPISend : 0);
+        cost.latency += woke;
+        cost.ipis += ipi;
+    }
+
+    hw->detach();
+    return cost;
+}
+
+int main(){
+    SimTopology topo(1, 8, 2);
+    uint32_t n = topo.getNumCPUs();
+
+    HandshakeHardware sim(n);
+    hw = &sim;
+    AMDRyzenCPUHardware::setShared(&sim);
+    sim.setCPUID(0x8000001D, 3, 7 << 14, 0, 0, 0);
+    sim.setMSR(0, MSR_PSTATE_0, 0x8000000000000890ULL);
+    sim.setMSR(0, MSR_PSTATE_0 + 1, 0x8000000000000878ULL);
+    hostSetTopology(topo.root());
+    CHECK(pmRyzen_init(nullptr, n));
+
+    static const Target targets[] = {
+        {"C1", 0x300, 0x200, 0},
+        {"C6", 0x1800, 0x1000, 0},
+        {"slow", 0x4800, 0x2000, 0},
+        {"deaf", kNever, 0, 0},
+        {"deaf->C1", 0x300, 0x200, kWakes / 4},
+    };
+
+    printf("%-10s %10s %10s %8s %10s %10s %8s\n", "target", "fixed tsc", "latency", "ipi %",
+           "adapt tsc", "latency", "ipi %");
+    Cost fixed[5], adaptive[5];
+    for(int i = 0; i < 5; i++){
+        //Every target on its own core, none of them the caller.
+        x86_lcpu_t *lcpu = topo.lcpuFor(i + 1);
+        uint32_t from = targets[i].deafUntil ? kWakes / 2 : 0;
+        fixed[i] = bench(lcpu, targets[i], false, from, kWakes);
+        adaptive[i] = bench(lcpu, targets[i], true, from, kWakes);
+
+        double wakes = kWakes - from;
+        printf("%-10s %10.0f %10.0f %8.2f %10.0f %10.0f %8.2f\n", targets[i].name,
+               fixed[i].caller / wakes, fixed[i].latency / wakes, 100 * fixed[i].ipis / wakes,
+               adaptive[i].caller / wakes, adaptive[i].latency / wakes, 100 * adaptive[i].ipis / wakes);
+    }
+
+    //Responsive targets are still woken through the monitor line, nearly never through an IPI.
+    CHECK(adaptive[0].ipis == 0 && fixed[0].ipis == 0);
+    CHECK(adaptive[1].ipis <= kWakes / 100);
+    CHECK(adaptive[0].caller <= fixed[0].caller && adaptive[1].caller <= fixed[1].caller * 101 / 100);
+
+    //Slow ones that keep running past the budget are given up on for a while, more of their
+    //wakes take an IPI but that still lands sooner than spinning on would.
+    CHECK(adaptive[2].caller <= fixed[2].caller);
+    CHECK(adaptive[2].latency <= fixed[2].latency);
+
+    //A target deaf to the monitor line goes straight to the IPI but for the odd probe.
+    CHECK(fixed[3].ipis == kWakes && adaptive[3].ipis == kWakes);
+    CHECK(adaptive[3].caller * 8 < fixed[3].caller);
+    CHECK(adaptive[3].latency * 4 < fixed[3].latency);
+
+    //Once it answers again a probe finds out and it is woken through the line from then on.
+    CHECK(adaptive[4].ipis <= kWakes / 100);
+    CHECK(adaptive[4].caller <= fixed[4].caller * 101 / 100);
+
+    pmRyzen_stop();
+    pmRyzen_free();
+
+    return TEST_RESULT("SpinBudgetBenchTests");
+}
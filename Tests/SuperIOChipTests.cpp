@@ -0,0 +1,389 @@
+//
+//  SuperIOChipTests.cpp
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#include <string.h>
+
+#include "TestHarness.h"
+#include "SimSuperIO.h"
+
+#include "../AMDRyzenCPUPowerManagement/SuperIO/ISSuperIOGeneric.hpp"
+
+enum SimKind {
+    kSimNCT668X,
+    kSimNCT67XX,
+    kSimIT86XX,
+};
+
+/**
+ *  Register map of each kind of chip, from the datasheets.
+ */
+struct SimLayout {
+    uint16_t rpmHi[16];
+    uint16_t rpmLo[16];
+    uint16_t pwm[16];
+    uint16_t mode[16];
+    uint16_t volt[16];
+    uint8_t voltMV[16];
+    uint16_t temp[8];
+    uint16_t hwmPorts;
+};
+
+static const SimLayout layouts[] = {
+    //NCT668X, the EC reports RPM directly and has no mode registers.
+    {
+        {0x140, 0x142, 0x144, 0x146, 0x148, 0x14a, 0x14c, 0x14e, 0x150, 0x152, 0x154, 0x156, 0x158, 0x15a, 0x15c, 0x15e},
+        {0x141, 0x143, 0x145, 0x147, 0x149, 0x14b, 0x14d, 0x14f, 0x151, 0x153, 0x155, 0x157, 0x159, 0x15b, 0x15d, 0x15f},
+        {0x160, 0x161, 0x162, 0x163, 0x164, 0x165, 0x166, 0x167, 0x168, 0x169, 0x16a, 0x16b, 0x16c, 0x16d, 0x16e, 0x16f},
+        {}, {}, {}, {}, 8,
+    },
+    //NCT67XX, PECI fan count sits at 0x4CE after the unused 0x4CC.
+    {
+        {0x4c0, 0x4c2, 0x4c4, 0x4c6, 0x4c8, 0x4ca, 0x4ce},
+        {0x4c1, 0x4c3, 0x4c5, 0x4c7, 0x4c9, 0x4cb, 0x4cf},
+        {0x109, 0x209, 0x309, 0x809, 0x909, 0xa09, 0xb09},
+        {0x102, 0x202, 0x302, 0x802, 0x902, 0xa02, 0xb02},
+        {0x480, 0x481, 0x482, 0x483, 0x484, 0x485, 0x486, 0x487, 0x488, 0x489, 0x48a, 0x48b, 0x48c, 0x48d, 0x48e},
+        {8, 8, 16, 16, 8, 8, 8, 16, 16, 8, 8, 8, 8, 8, 8},
+        {0x490, 0x491, 0x492, 0x493, 0x494, 0x495}, 8,
+    },
+    //IT86XX, tach counts with the extended fans 4 and 5 at 0x80.
+    {
+        {0x18, 0x19, 0x1a, 0x81, 0x83},
+        {0x0d, 0x0e, 0x0f, 0x80, 0x82},
+        {0x63, 0x6b, 0x73, 0x7b, 0xa3},
+        {0x15, 0x16, 0x17, 0x7f, 0xa7},
+        {0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28},
+        {12, 12, 12, 12, 12, 12, 12, 24, 24},
+        {0x29, 0x2a, 0x2b}, 8,
+    },
+};
+
+struct ChipCase {
+    const char *name;
+    uint16_t id;            // What the chip answers at 0x20/0x21
+    SimKind kind;
+    int fans;
+    int volts;
+    int temps;
+    uint8_t lockMask;
+    bool secondary;
+};
+
+/**
+ *  One line per ISSuperIOChips[] entry. NCT668X carry a revision in the low nibble the
+ *  driver must mask off.
+ */
+static const ChipCase cases[] = {
+    { "NCT6681",   0xb273, kSimNCT668X, 16, 0,  0, 0,    false },
+    { "NCT6683",   0xc732, kSimNCT668X, 16, 0,  0, 0,    false },
+    { "NCT610XD",  0xc452, kSimNCT67XX, 6,  0,  0, 0,    false },
+    { "NCT6771F",  0xb470, kSimNCT67XX, 6,  0,  0, 0,    false },
+    { "NCT6776F",  0xc330, kSimNCT67XX, 6,  0,  0, 0,    false },
+    { "NCT6779D",  0xc560, kSimNCT67XX, 5,  15, 6, 0,    false },
+    { "NCT6791D",  0xc803, kSimNCT67XX, 6,  15, 6, 0x10, false },
+    { "NCT6792D",  0xc911, kSimNCT67XX, 6,  15, 6, 0x10, false },
+    { "NCT6792DA", 0xc913, kSimNCT67XX, 6,  15, 6, 0x10, false },
+    { "NCT6793D",  0xd121, kSimNCT67XX, 6,  15, 6, 0x10, false },
+    { "NCT6795D",  0xd352, kSimNCT67XX, 6,  15, 6, 0x10, false },
+    { "NCT6796D",  0xd423, kSimNCT67XX, 6,  15, 6, 0x10, false },
+    { "NCT6796DR", 0xd42a, kSimNCT67XX, 6,  15, 6, 0x10, false },
+    { "NCT6797D",  0xd451, kSimNCT67XX, 7,  15, 6, 0x10, false },
+    { "NCT6798D",  0xd42b, kSimNCT67XX, 7,  15, 6, 0x10, false },
+    { "NCT6799D",  0xd802, kSimNCT67XX, 7,  15, 6, 0x10, false },
+    { "IT8665E",   0x8665, kSimIT86XX,  5,  9,  3, 0,    false },
+    { "IT8686E",   0x8686, kSimIT86XX,  5,  9,  3, 0,    false },
+    { "IT8688E",   0x8688, kSimIT86XX,  5,  9,  3, 0,    false },
+    { "IT8689E",   0x8689, kSimIT86XX,  5,  9,  3, 0,    false },
+    { "IT8792E",   0x8733, kSimIT86XX,  3,  9,  3, 0,    true  },
+};
+
+static const int kNumCases = sizeof(cases) / sizeof(cases[0]);
+
+static SimSuperIO *makeChip(SimKind kind, uint16_t id, uint16_t configPort){
+    switch (kind) {
+        case kSimNCT668X: {
+            auto chip = new SimNCT668X(id, 0xa20, configPort);
+            chip->baseJunk = 0x5;
+            return chip;
+        }
+        case kSimNCT67XX:
+            return new SimNCT67XX(id, 0x290, configPort);
+        default:
+            return new SimIT86XX(id, configPort == 0x4e ? 0xa60 : 0xa40, configPort);
+    }
+}
+
+static void checkTableCoverage(){
+    //Every table entry has a case and nothing in the table is left out.
+    CHECK(ISSuperIOChipCount == (uint32_t)kNumCases);
+
+    for(uint32_t i = 0; i < ISSuperIOChipCount; i++){
+        const ISSuperIOChipDesc *desc = &ISSuperIOChips[i];
+        bool found = false;
+
+        for(const ChipCase &c : cases){
+            if(strcmp(c.name, desc->name)) continue;
+            found = true;
+            CHECK(desc->numFans == c.fans);
+            CHECK(desc->numVoltages == c.volts);
+            CHECK(desc->numTemps == c.temps);
+            CHECK(desc->lockMask == c.lockMask);
+            CHECK(desc->secondary == c.secondary);
+        }
+        if(!found) fprintf(stderr, "%s has no test case\n", desc->name);
+        CHECK(found);
+    }
+}
+
+//Odd fans start under manual control, the last one always under the chip's.
+static bool startsAuto(const ChipCase &c, int fan){
+    return !(fan & 1) || fan == c.fans - 1;
+}
+
+static void checkChip(const ChipCase &c, uint16_t configPort){
+    AMDRyzenCPUSimulatedHardware hw(1, 1000);
+    AMDRyzenCPUHardware::setShared(&hw);
+
+    const SimLayout &l = layouts[c.kind];
+    SimSuperIO *chip = makeChip(c.kind, c.id, configPort);
+    chip->attach(hw, l.hwmPorts);
+
+    chip->conf[0x28] = 0xff;
+
+    for(int i = 0; i < c.fans; i++){
+        //NCT chips report RPM, ITE a tach count.
+        uint16_t raw = c.kind == kSimIT86XX ? 0x200 + i * 0x40 : 1000 + i * 37;
+        chip->reg(l.rpmHi[i]) = raw >> 8;
+        chip->reg(l.rpmLo[i]) = raw & 0xff;
+        chip->reg(l.pwm[i]) = 0x10 + i;
+
+        //ITE keeps its PWM value in bits 6:0 next to the automatic bit.
+        if(l.mode[i]){
+            if(c.kind == kSimIT86XX) chip->reg(l.mode[i]) = startsAuto(c, i) ? 0x80 | i : 0x7f;
+            else chip->reg(l.mode[i]) = startsAuto(c, i) ? 0x50 : 0;
+        }
+    }
+
+    for(int i = 0; i < c.volts; i++) chip->reg(l.volt[i]) = 100 + i;
+    for(int i = 0; i < c.temps; i++) chip->reg(l.temp[i]) = (uint8_t)(i ? 30 + i : -5);
+
+    uint16_t chipIntel = 0;
+    ISSuperIOGeneric *dev = ISSuperIOGeneric::getDevice(&chipIntel);
+    CHECK(dev != nullptr);
+    if(!dev){
+        fprintf(stderr, "%s not found on 0x%x\n", c.name, configPort);
+        delete chip;
+        return;
+    }
+
+    CHECK(chipIntel == c.id);
+    CHECK(dev->getNumberOfFans() == c.fans);
+    CHECK(dev->getNumberOfVoltages() == c.volts);
+    CHECK(dev->getNumberOfTemperatures() == c.temps);
+    CHECK(dev->getReadableStringForFan(c.fans - 1) != nullptr);
+    CHECK(dev->getReadableStringForFan(c.fans) == nullptr);
+
+    //Nuvoton close their config port, and only the chip's own lock bits are cleared.
+    if(c.kind != kSimIT86XX) CHECK(!chip->configOpen());
+    if(c.kind == kSimNCT67XX) CHECK(chip->conf[0x28] == (uint8_t)~c.lockMask);
+
+    dev->updateFanRPMS();
+    dev->updateFanControl();
+    for(int i = 0; i < c.fans; i++){
+        if(c.kind == kSimIT86XX)
+            CHECK_NEAR(dev->getRPMForFan(i), 1350000 / (2 * (0x200 + i * 0x40)), 1);
+        else
+            CHECK(dev->getRPMForFan(i) == (uint32_t)(1000 + i * 37));
+
+        CHECK(dev->getFanThrottle(i) == 0x10 + i);
+        CHECK(dev->getFanAutoControlMode(i) == (!l.mode[i] || startsAuto(c, i)));
+    }
+
+    //Take the last fan over and give it back.
+    int fan = c.fans - 1;
+    uint8_t defaultMode = l.mode[fan] ? chip->reg(l.mode[fan]) : 0;
+    dev->overrideFanControl(fan, 0x33);
+    dev->updateFanControl();
+    CHECK(dev->getFanThrottle(fan) == 0x33);
+    CHECK(!l.mode[fan] || !dev->getFanAutoControlMode(fan));
+
+    switch (c.kind) {
+        case kSimNCT668X: {
+            auto ec = static_cast<SimNCT668X*>(chip);
+            CHECK(ec->commandsApplied == 1);
+            CHECK(ec->commandsDropped == 0);
+            CHECK(!ec->requestPending);
+            //The other fans keep their duty cycle.
+            for(int i = 0; i < fan; i++) CHECK(chip->reg(l.pwm[i]) == 0x10 + i);
+            break;
+        }
+        case kSimNCT67XX:
+            CHECK(chip->reg(l.mode[fan]) == 0);
+            break;
+        case kSimIT86XX:
+            CHECK(chip->reg(0x13) & (1 << fan));
+            CHECK(chip->reg(l.mode[fan]) == (defaultMode & 0x7f));
+            break;
+    }
+
+    dev->setDefaultFanControl(fan);
+    if(l.mode[fan]) CHECK(chip->reg(l.mode[fan]) == defaultMode);
+    if(c.kind == kSimIT86XX) CHECK(chip->reg(l.pwm[fan]) == 0x10 + fan);
+
+    dev->updateSensors();
+    for(int i = 0; i < c.volts; i++)
+        CHECK_NEAR(dev->getVoltage(i), (100 + i) * l.voltMV[i] / 1000.0, 0.0001);
+    for(int i = 0; i < c.temps; i++)
+        CHECK_NEAR(dev->getTemperature(i), i ? 30 + i : -5, 0.0001);
+
+    delete dev;
+    delete chip;
+}
+
+static void checkITEAutoBit(){
+    AMDRyzenCPUSimulatedHardware hw(1, 1000);
+    AMDRyzenCPUHardware::setShared(&hw);
+
+    SimIT86XX chip(0x8688, 0xa40);
+    chip.attach(hw, 8);
+
+    uint16_t chipIntel = 0;
+    ISSuperIOGeneric *dev = ISSuperIOGeneric::getDevice(&chipIntel);
+    CHECK(dev != nullptr);
+    if(!dev) return;
+
+    //Only bit 7 tells automatic control, whatever the PWM bits hold.
+    static const uint8_t modes[] = {0x80, 0xff, 0x00, 0x7f, 0x01};
+    for(uint8_t mode : modes){
+        chip.regs[0x15] = mode;
+        dev->updateFanControl();
+        CHECK(dev->getFanAutoControlMode(0) == !!(mode & 0x80));
+    }
+
+    delete dev;
+}
+
+static void checkSecondaryFallback(){
+    //Alone, the IT8792E is used.
+    {
+        AMDRyzenCPUSimulatedHardware hw(1, 1000);
+        AMDRyzenCPUHardware::setShared(&hw);
+
+        SimIT86XX second(0x8733, 0xa60, 0x4e);
+        second.attach(hw, 8);
+
+        uint16_t chipIntel = 0;
+        ISSuperIOGeneric *dev = ISSuperIOGeneric::getDevice(&chipIntel);
+        CHECK(dev != nullptr);
+        CHECK(chipIntel == 0x8733);
+        if(dev) CHECK(dev->getNumberOfFans() == 3);
+        delete dev;
+    }
+
+    //Next to a primary chip it never wins, on either port.
+    static const uint16_t secondaryPorts[] = {0x4e, 0x2e};
+    for(uint16_t port : secondaryPorts){
+        AMDRyzenCPUSimulatedHardware hw(1, 1000);
+        AMDRyzenCPUHardware::setShared(&hw);
+
+        uint16_t primaryPort = port == 0x4e ? 0x2e : 0x4e;
+        SimIT86XX second(0x8733, port == 0x4e ? 0xa60 : 0xa40, port);
+        SimIT86XX primary(0x8689, primaryPort == 0x4e ? 0xa60 : 0xa40, primaryPort);
+        second.attach(hw, 8);
+        primary.attach(hw, 8);
+
+        uint16_t chipIntel = 0;
+        ISSuperIOGeneric *dev = ISSuperIOGeneric::getDevice(&chipIntel);
+        CHECK(dev != nullptr);
+        CHECK(chipIntel == 0x8689);
+        if(dev) CHECK(dev->getNumberOfFans() == 5);
+        delete dev;
+    }
+
+    //Nothing at all.
+    {
+        AMDRyzenCPUSimulatedHardware hw(1, 1000);
+        AMDRyzenCPUHardware::setShared(&hw);
+
+        uint16_t chipIntel = 0;
+        CHECK(ISSuperIOGeneric::getDevice(&chipIntel) == nullptr);
+    }
+}
+
+/**
+ *  Port operations per refresh on an NCT6798D. Every register sits behind the index/data pair
+ *  and a bank switch costs two writes, reading one byte with its bank selected each time as
+ *  the drivers used to is four operations.
+ */
+static void checkRefreshBudgets(){
+    AMDRyzenCPUSimulatedHardware hw(1, 1000);
+    AMDRyzenCPUHardware::setShared(&hw);
+
+    SimNCT67XX chip(0xd42b, 0x290);
+    chip.attach(hw, 8);
+
+    uint16_t chipIntel = 0;
+    ISSuperIOGeneric *dev = ISSuperIOGeneric::getDevice(&chipIntel);
+    CHECK(dev != nullptr);
+    if(!dev) return;
+
+    //7 fans, 14 RPM bytes all in bank 4: one bank switch, then index and data per byte.
+    for(int pass = 0; pass < 2; pass++){
+        hw.resetPortCounts();
+        dev->updateFanRPMS();
+        CHECK(hw.getPortWrites() == 2 + 14);
+        CHECK(hw.getPortReads() == 14);
+    }
+
+    //PWM and mode of each fan share a bank, 7 banks in all.
+    hw.resetPortCounts();
+    dev->updateFanControl();
+    CHECK(hw.getPortWrites() == 7 * 2 + 14);
+    CHECK(hw.getPortReads() == 14);
+
+    //15 voltages and 6 temperatures, all in bank 4.
+    hw.resetPortCounts();
+    dev->updateSensors();
+    CHECK(hw.getPortWrites() == 2 + 21);
+    CHECK(hw.getPortReads() == 21);
+
+    //Taking a fan over: mode and PWM command in one bank.
+    hw.resetPortCounts();
+    dev->overrideFanControl(6, 0x40);
+    CHECK(hw.getPortWrites() == 2 + 2 * 2);
+    CHECK(hw.getPortReads() == 0);
+
+    //What the same RPM refresh costs without the bank cache.
+    static const uint16_t rpmRegs[] = {0x4c0, 0x4c1, 0x4c2, 0x4c3, 0x4c4, 0x4c5, 0x4c6,
+                                       0x4c7, 0x4c8, 0x4c9, 0x4ca, 0x4cb, 0x4ce, 0x4cf};
+    ISHWMPort uncached(0x295, 0x296, ISHWMPort::kBankIndexed, 0x4e);
+    hw.resetPortCounts();
+    for(uint16_t r : rpmRegs){
+        uncached.invalidate();
+        uncached.readByte(r);
+    }
+    CHECK(hw.getPortReads() + hw.getPortWrites() == 56);
+
+    delete dev;
+}
+
+int main(){
+    checkTableCoverage();
+
+    //Each chip on both config ports.
+    for(const ChipCase &c : cases){
+        checkChip(c, 0x2e);
+        checkChip(c, 0x4e);
+    }
+
+    checkITEAutoBit();
+    checkSecondaryFallback();
+    checkRefreshBudgets();
+
+    AMDRyzenCPUHardware::setShared(nullptr);
+    return TEST_RESULT("SuperIOChipTests");
+}
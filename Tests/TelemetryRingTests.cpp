@@ -0,0 +1,140 @@
+//
+//  TelemetryRingTests.cpp
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#include <stdlib.h>
+
+#include <atomic>
+#include <thread>
+
+#include "TestHarness.h"
+#include "../AMDRyzenCPUPowerManagement/AMDRyzenCPUPMTelemetry.h"
+
+/**
+ *  A writer thread publishes samples through the kext's writer helpers as fast as it can
+ *  while readers copy them out, every field of sample n is derived from n so a record mixing
+ *  two samples is caught. The ring is small enough that the writer laps the readers all the
+ *  time, which is exactly when a torn copy could be accepted.
+ */
+
+static const uint64_t kSamples = 200000;
+static const int kReaders = 3;
+
+static uint32_t pattern(uint64_t n, uint32_t i){
+    return (uint32_t)(n * 2654435761U) ^ (i * 40503U);
+}
+
+static void fill(AMDRyzenTelemetrySample *rec, uint64_t n){
+    rec->timestampNs = n;
+    rec->instructionDelta = ~n;
+    rec->packagePower = (float)(n & 0xffff);
+    rec->packageTemp = (float)(n & 0xff);
+    rec->PStateCtl = (uint32_t)n;
+    rec->numPhysCores = (uint32_t)(n >> 32) ^ 0x5a5a;
+    for(uint32_t i = 0; i < AMDRYZEN_TELEMETRY_MAX_CORES; i++){
+        uint32_t a = pattern(n, i), b = ~pattern(n, i);
+        memcpy(&rec->effFreq_perCore[i], &a, sizeof(a));
+        memcpy(&rec->load_perCore[i], &b, sizeof(b));
+    }
+}
+
+static bool consistent(const AMDRyzenTelemetrySample *rec, uint64_t n){
+    AMDRyzenTelemetrySample expect;
+    expect.seq = 2 * n + 2;
+    fill(&expect, n);
+    return !memcmp(&expect, rec, sizeof(expect));
+}
+
+struct ReaderStats {
+    uint64_t accepted = 0;
+    uint64_t rejected = 0;
+    uint64_t torn = 0;
+    uint64_t backwards = 0;
+};
+
+static void reader(const AMDRyzenTelemetryRing *ring, const std::atomic<bool> *done, ReaderStats *stats){
+    AMDRyzenTelemetrySample out;
+    uint64_t last = 0;
+
+    while(!done->load(std::memory_order_acquire)){
+        //The latest sample, then the oldest one, whose record the writer reuses next.
+        if(AMDRyzenTelemetryReadLatest(ring, &out)){
+            uint64_t n = (out.seq - 2) / 2;
+            if(!consistent(&out, n)) stats->torn++;
+            if(n < last) stats->backwards++;
+            last = n;
+            stats->accepted++;
+        }
+
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if(head < AMDRYZEN_TELEMETRY_CAPACITY) continue;
+
+        uint64_t n = head - AMDRYZEN_TELEMETRY_CAPACITY;
+        if(AMDRyzenTelemetryRead(ring, n, &out)){
+            if(out.seq != 2 * n + 2 || !consistent(&out, n)) stats->torn++;
+            stats->accepted++;
+        } else {
+            stats->rejected++;
+        }
+    }
+}
+
+int main(){
+    AMDRyzenTelemetryRing *ring = (AMDRyzenTelemetryRing*)calloc(1, sizeof(AMDRyzenTelemetryRing));
+    AMDRyzenTelemetrySample out;
+
+    //Nothing published, nothing to read.
+    CHECK(!AMDRyzenTelemetryReadLatest(ring, &out));
+    CHECK(!AMDRyzenTelemetryRead(ring, 0, &out));
+
+    //Single threaded: a record being written is refused, a lapped one too.
+    AMDRyzenTelemetrySample *rec = AMDRyzenTelemetryBeginWrite(ring, 0);
+    fill(rec, 0);
+    CHECK(!AMDRyzenTelemetryRead(ring, 0, &out));
+    AMDRyzenTelemetryEndWrite(ring, 0);
+    CHECK(AMDRyzenTelemetryRead(ring, 0, &out) && consistent(&out, 0));
+    CHECK(ring->head == 1);
+
+    for(uint64_t n = 1; n <= AMDRYZEN_TELEMETRY_CAPACITY; n++){
+        fill(AMDRyzenTelemetryBeginWrite(ring, n), n);
+        AMDRyzenTelemetryEndWrite(ring, n);
+    }
+    CHECK(!AMDRyzenTelemetryRead(ring, 0, &out));
+    CHECK(AMDRyzenTelemetryReadLatest(ring, &out) && consistent(&out, AMDRYZEN_TELEMETRY_CAPACITY));
+
+    //Concurrent.
+    memset(ring, 0, sizeof(*ring));
+    std::atomic<bool> done(false);
+    ReaderStats stats[kReaders];
+    std::thread readers[kReaders];
+    for(int i = 0; i < kReaders; i++)
+        readers[i] = std::thread(reader, ring, &done, &stats[i]);
+
+    //Yielding halfway through a record now and then lets readers run into it on a single CPU too.
+    for(uint64_t n = 0; n < kSamples; n++){
+        AMDRyzenTelemetrySample *rec = AMDRyzenTelemetryBeginWrite(ring, n);
+        rec->timestampNs = n;
+        if(!(n % 16)) std::this_thread::yield();
+        fill(rec, n);
+        AMDRyzenTelemetryEndWrite(ring, n);
+    }
+
+    done.store(true, std::memory_order_release);
+    for(int i = 0; i < kReaders; i++) readers[i].join();
+
+    for(int i = 0; i < kReaders; i++){
+        CHECK(stats[i].torn == 0);
+        CHECK(stats[i].backwards == 0);
+        CHECK(stats[i].accepted > 0);
+        if(getenv("TESTS_VERBOSE"))
+            printf("reader %d: %llu accepted, %llu refused\n", i,
+                   (unsigned long long)stats[i].accepted, (unsigned long long)stats[i].rejected);
+    }
+    CHECK(AMDRyzenTelemetryReadLatest(ring, &out) && consistent(&out, kSamples - 1));
+
+    free(ring);
+    return TEST_RESULT("TelemetryRingTests");
+}
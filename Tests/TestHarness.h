@@ -0,0 +1,38 @@
+//
+//  TestHarness.h
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#ifndef TestHarness_h
+#define TestHarness_h
+
+/**
+ *  Minimal checks for the host tests, a failed check reports and keeps the test running.
+ *  Each test binary returns the number of failures from main.
+ */
+
+#include <stdio.h>
+#include <math.h>
+
+static int testFailures = 0;
+
+#define CHECK(cond) do { \
+    if(!(cond)){ \
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        testFailures++; \
+    } \
+} while(0)
+
+#define CHECK_NEAR(a, b, eps) do { \
+    double _a = (a), _b = (b); \
+    if(fabs(_a - _b) > (eps)){ \
+        fprintf(stderr, "%s:%d: CHECK_NEAR(%s, %s) failed: %f vs %f\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+        testFailures++; \
+    } \
+} while(0)
+
+#define TEST_RESULT(name) (printf("%s: %s\n", name, testFailures ? "FAILED" : "ok"), testFailures)
+
+#endif /* TestHarness_h */
@@ -0,0 +1,200 @@
+//
+//  TickBenchTests.cpp
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#include <time.h>
+
+#include "TestHarness.h"
+#include "SimTopology.h"
+
+#include "../AMDRyzenCPUPowerManagement/AMDRyzenCPUSimulatedHardware.hpp"
+#include "../AMDRyzenCPUPowerManagement/AMDRyzenCPUSampler.hpp"
+#include "../AMDRyzenCPUPowerManagement/AMDRyzenCPUSMN.hpp"
+
+/**
+ *  Cost of the provider's timer tick on the simulated backend: the per CPU half through
+ *  AMDRyzenCPUSampler inside a rendezvous, as the timer callback runs it, then the package
+ *  half's SMN batches through AMDRyzenCPUSMN and the package energy read. Fans are left out,
+ *  SuperIOChipTests holds their port budgets.
+ *
+ *  Reported per tick are MSR accesses, IPIs, MSR accesses made with interrupts off, config
+ *  cycles, and host time. The simulated accesses are plain calls, so the time is the
+ *  software overhead of a tick, not what the hardware accesses cost.
+ */
+
+static const uint32_t kTicks = 2000;
+static const uint64_t kTSCFreq = 3000000000ULL;
+static const uint64_t kTSCStep = 1000;
+static const double kEnergyUnit = 1.0 / 65536;
+static const float kFreqP0 = 3800.0f;
+
+static const uint64_t kAPERFStep = 3600000;
+static const uint64_t kMPERFStep = 4000000;
+static const uint64_t kIRPCStep = 5000000;
+static const uint64_t kEnergyStep = 300;
+static const uint64_t kPMCStep = 1000;
+
+static const uint32_t kTctl = 0x00059800;
+static const uint32_t kTccdBase = 0x00059954;
+static const uint32_t kSVI = 0x0005A000;
+static const uint32_t kPkgEnergy = 0xC001029B;
+
+static const uint32_t kDefaultEvents[AMDRyzenCPUSampler::kPMCMaxCounters] = {
+    0x000076, 0x0000c0, 0x0000c3, 0x090064, 0x480043, 0,
+};
+static const uint32_t kActiveEvents = 5;
+
+static AMDRyzenCPUSimulatedHardware *hw;
+static AMDRyzenCPUSampler *sampler;
+
+//The timer callback's rendezvous.
+static void tickAction(void *){
+    uint32_t cpu_num = hw->cpuNumber();
+
+    sampler->updateInstructionDelta(cpu_num);
+    sampler->updatePMC(cpu_num);
+
+    if(!pmRyzen_cpu_primary_in_core(cpu_num)) return;
+    uint32_t physical = pmRyzen_cpu_phys_num(cpu_num);
+
+    sampler->calculateEffectiveFrequency(physical, kFreqP0);
+    sampler->updateCoreEnergy(physical);
+}
+
+static void primeAction(void *){
+    uint32_t cpu_num = hw->cpuNumber();
+    if(pmRyzen_cpu_primary_in_core(cpu_num))
+        CHECK(sampler->primeCore(pmRyzen_cpu_phys_num(cpu_num)));
+}
+
+struct Cost {
+    double msr;
+    double ipis;
+    double intrsOff;
+    double config;
+    double ns;
+};
+
+static Cost runTicks(AMDRyzenCPUSMN &smn, const uint32_t *temps, uint32_t numTemps, uint32_t ticks){
+    uint32_t values[9];
+    uint32_t planes[2] = {kSVI + 0x10, kSVI + 0xc};
+    energy_counter pkg {};
+
+    hw->resetCallCounts();
+    hw->resetConfigCounts();
+
+    timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(uint32_t t = 0; t < ticks; t++){
+        hw->rendezvousNoIntrs(tickAction, nullptr);
+
+        smn.readBatch(temps, values, numTemps);
+        smn.readBatch(planes, values, 2);
+
+        uint64_t energy = 0;
+        hw->readTSC();
+        hw->readMSR(kPkgEnergy, &energy);
+        energy_accumulate(&pkg, energy);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    return {(double)hw->getMSRAccesses() / ticks, (double)hw->getIPIs() / ticks,
+            (double)hw->getIntrsOffAccesses() / ticks,
+            (double)(hw->getConfigReads() + hw->getConfigWrites()) / ticks, ns / ticks};
+}
+
+static void print(uint32_t n, const char *what, const Cost &c){
+    printf("%4u %-10s %8.1f %6.1f %9.1f %7.1f %10.0f\n", n, what, c.msr, c.ipis, c.intrsOff, c.config, c.ns);
+}
+
+static void bench(uint32_t packages, uint32_t cores, uint32_t threads, uint32_t ccds){
+    SimTopology topo(packages, cores, threads);
+    uint32_t n = topo.getNumCPUs();
+    uint32_t physical = packages * cores;
+
+    AMDRyzenCPUSimulatedHardware sim(n, kTSCStep);
+    hw = &sim;
+    AMDRyzenCPUHardware::setShared(&sim);
+    sim.setCPUID(0x8000001D, 3, 7 << 14, 0, 0, 0);
+    sim.setMSR(0, MSR_PSTATE_0, 0x8000000000000890ULL);
+    sim.setMSR(0, MSR_PSTATE_0 + 1, 0x8000000000000878ULL);
+    for(uint32_t i = 0; i < n; i++){
+        sim.setMSR(i, AMDRyzenCPUSampler::kMSR_APERF, 0, kAPERFStep);
+        sim.setMSR(i, AMDRyzenCPUSampler::kMSR_MPERF, 0, kMPERFStep);
+        sim.setMSR(i, AMDRyzenCPUSampler::kMSR_PERF_IRPC, 0, kIRPCStep);
+        sim.setMSR(i, AMDRyzenCPUSampler::kMSR_CORE_ENERGY_STAT, 0, kEnergyStep);
+        for(uint32_t c = 0; c < AMDRyzenCPUSampler::kPMCMaxCounters; c++){
+            sim.setMSR(i, AMDRyzenCPUSampler::kMSR_PERF_CTL_EXT_0 + c * 2, 0);
+            sim.setMSR(i, AMDRyzenCPUSampler::kMSR_PERF_CTL_EXT_0 + c * 2 + 1, 0, kPMCStep);
+        }
+    }
+    sim.setMSR(0, kPkgEnergy, 0, kEnergyStep * physical);
+
+    uint32_t temps[9] = {kTctl};
+    for(uint32_t i = 0; i < ccds; i++){
+        temps[i + 1] = kTccdBase + i * 4;
+        sim.setSMN(temps[i + 1], 0x800 | 600);
+    }
+    sim.setSMN(kTctl, 45 << 24);
+
+    hostSetTopology(topo.root());
+    CHECK(pmRyzen_init(nullptr, n));
+
+    AMDRyzenCPUSampler *s = new AMDRyzenCPUSampler();
+    sampler = s;
+    s->configure(&sim, kTSCFreq, kEnergyUnit);
+    sim.rendezvousNoIntrs(primeAction, nullptr);
+
+    AMDRyzenCPUSMN smn;
+    smn.setHardware(&sim);
+
+    Cost idle = runTicks(smn, temps, ccds + 1, kTicks);
+    print(n, "pmc off", idle);
+
+    s->latchPMCEvents(kDefaultEvents, 1);
+    Cost program = runTicks(smn, temps, ccds + 1, 1);
+    print(n, "pmc latch", program);
+
+    Cost pmc = runTicks(smn, temps, ccds + 1, kTicks);
+    print(n, "pmc on", pmc);
+
+    //IRPC on every thread, APERF, MPERF and core energy per core, the package energy.
+    CHECK(idle.msr == n + physical * 3 + 1);
+    CHECK(pmc.msr == idle.msr + n * kActiveEvents);
+    //Every counter cleared and the active ones selected once.
+    CHECK(program.msr == idle.msr + n * (2 * AMDRyzenCPUSampler::kPMCMaxCounters + kActiveEvents));
+    CHECK(idle.ipis == n - 1 && pmc.ipis == n - 1);
+    //A primary thread does 4 accesses, its sibling 1, or 1 + kActiveEvents with the PMU on.
+    CHECK(idle.intrsOff == n * 4);
+    CHECK(pmc.intrsOff == n * (4 + kActiveEvents));
+    //No register is read twice in a row, every SMN read pays for its index write.
+    CHECK(idle.config == 2 * (ccds + 1 + 2));
+
+    //Readings of the last tick, every counter advanced by one step since the one before.
+    double seconds = (physical + 1) * kTSCStep / (double)kTSCFreq;
+    for(uint32_t i = 0; i < physical; i++){
+        CHECK_NEAR(s->effFreq_perCore[i], kFreqP0 * kAPERFStep / kMPERFStep, 0.01);
+        CHECK_NEAR(s->corePower_perCore[i], kEnergyUnit * kEnergyStep / seconds, 0.01);
+        CHECK(s->coreEnergy_perCore[i].acc == (2 * kTicks + 1) * kEnergyStep);
+    }
+    for(uint32_t i = 0; i < n; i++){
+        CHECK(s->instructionDelta_PerCore[i] == kIRPCStep);
+        CHECK(s->pmcDelta_perCore[i][0] == kPMCStep && s->pmcDelta_perCore[i][5] == 0);
+    }
+
+    delete s;
+    pmRyzen_stop();
+    pmRyzen_free();
+}
+
+int main(){
+    printf("%4s %-10s %8s %6s %9s %7s %10s\n", "cpus", "tick", "msr", "ipis", "intrs off", "config", "host ns");
+    bench(1, 8, 2, 1);
+    bench(2, 32, 2, 8);
+
+    return TEST_RESULT("TickBenchTests");
+}
@@ -0,0 +1,124 @@
+//
+//  TopologyTests.cpp
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#include "TestHarness.h"
+#include "SimTopology.h"
+
+#include "../AMDRyzenCPUPowerManagement/AMDRyzenCPUSimulatedHardware.hpp"
+
+extern "C" {
+extern pmProcessor_t *pmRyzen_cpus;
+extern pmRyzenCCX_t *pmRyzen_ccx;
+}
+
+//Zen 2 L3: 8 threads sharing it, CPUID 0x8000001D[3] EAX[25:14] is that minus one.
+static const uint32_t kThreadsPerL3 = 8;
+
+static void setupHardware(AMDRyzenCPUSimulatedHardware &hw){
+    hw.setCPUID(0x8000001D, 3, (kThreadsPerL3 - 1) << 14, 0, 0, 0);
+
+    //P0 3.6GHz at DfsId 8, P1 below it.
+    hw.setMSR(0, MSR_PSTATE_0, 0x8000000000000890ULL);
+    hw.setMSR(0, MSR_PSTATE_0 + 1, 0x8000000000000878ULL);
+    for(uint32_t i = 0; i < hw.getNumCPUs(); i++)
+        hw.setMSR(i, MSR_PSTATE_CTL, 1);
+}
+
+static void checkTopology(AMDRyzenCPUSimulatedHardware &hw, SimTopology &topo){
+    uint32_t n = topo.getNumCPUs();
+    hostSetTopology(topo.root());
+    hostDispatch = nullptr;
+
+    CHECK(pmRyzen_init(nullptr, n));
+    CHECK(hostDispatch != nullptr);
+
+    CHECK(pmRyzen_num_slots == n);
+    CHECK(pmRyzen_num_pkgs == topo.packages);
+    CHECK(pmRyzen_num_phys == topo.packages * topo.cores);
+    CHECK(pmRyzen_num_logi == n);
+    CHECK(pmRyzen_tsc_freq == hostTscFreq);
+
+    //Every thread is reachable by its cpu_num and came up in P0.
+    CHECK(pmRyzen_hpcpus == n);
+    for(uint32_t i = 0; i < n; i++){
+        CHECK(pmRyzen_cpunum_to_lcpu[i] == topo.lcpuFor(i));
+        CHECK(pmRyzen_cpus[i].lcpu == topo.lcpuFor(i));
+        CHECK(pmRyzen_cpus[i].PState == 0);
+        CHECK(hw.getMSR(i, MSR_PSTATE_CTL) == 0);
+    }
+
+    //Four cores to a CCX on either layout, none of them straddling a package.
+    CHECK(pmRyzen_num_ccx == n / kThreadsPerL3);
+    for(uint32_t c = 0; c < pmRyzen_num_ccx; c++)
+        CHECK(pmRyzen_ccx[c].awake == (1ULL << kThreadsPerL3) - 1);
+
+    uint32_t perCCX = kThreadsPerL3 / topo.threads;
+    uint32_t misgrouped = 0;
+    for(uint32_t i = 0; i < n; i++){
+        pmProcessor_t *cpu = &pmRyzen_cpus[i];
+        CHECK(pmRyzen_ccx[cpu->ccx].cpus[cpu->ccx_bit] == i);
+
+        x86_lcpu_t *lcpu = topo.lcpuFor(i);
+        for(uint32_t j = 0; j < n; j++){
+            x86_lcpu_t *other = topo.lcpuFor(j);
+            bool sameL3 = other->package == lcpu->package &&
+                other->core->lcore_num / perCCX == lcpu->core->lcore_num / perCCX;
+            if((pmRyzen_cpus[j].ccx == cpu->ccx) != sameL3) misgrouped++;
+        }
+    }
+    CHECK(misgrouped == 0);
+
+    //choose_cpu: an idle preferred CPU hands over to its sibling, then to its CCX.
+    uint32_t pref = topo.cores * topo.packages - 1;
+    x86_lcpu_t *lcpu = topo.lcpuFor(pref);
+    uint32_t sibling = lcpu->next_in_core->cpu_num;
+    pmRyzen_cpus[pref].cpu_awake = 0;
+    CHECK(pmRyzen_choose_cpu(0, n - 1, pref) == (int)sibling);
+
+    pmRyzen_cpus[sibling].cpu_awake = 0;
+    pmRyzen_ccx[pmRyzen_cpus[pref].ccx].awake &= ~((1ULL << pmRyzen_cpus[pref].ccx_bit) |
+                                                   (1ULL << pmRyzen_cpus[sibling].ccx_bit));
+    int chosen = pmRyzen_choose_cpu(0, n - 1, pref);
+    CHECK(chosen >= 0 && chosen < (int)n);
+    if(chosen >= 0 && chosen < (int)n){
+        CHECK(pmRyzen_cpus[chosen].ccx == pmRyzen_cpus[pref].ccx);
+        CHECK(pmRyzen_cpus[chosen].cpu_awake);
+    }
+    pmRyzen_cpus[pref].cpu_awake = pmRyzen_cpus[sibling].cpu_awake = 1;
+
+    pmRyzen_stop();
+    CHECK(hostDispatch == nullptr);
+    CHECK(hostIPIs == 0);
+
+    pmRyzen_free();
+    CHECK(pmRyzen_cpus == nullptr);
+    CHECK(pmRyzen_ccx == nullptr);
+    CHECK(pmRyzen_num_slots == 0);
+}
+
+int main(){
+    static AMDRyzenCPUSimulatedHardware hw(128, 1000);
+    AMDRyzenCPUHardware::setShared(&hw);
+    setupHardware(hw);
+
+    SimTopology oneSocket(1, 64, 2);
+    SimTopology twoSocket(2, 32, 2);
+    CHECK(oneSocket.getNumCPUs() == 128);
+    CHECK(twoSocket.getNumCPUs() == 128);
+
+    checkTopology(hw, oneSocket);
+    checkTopology(hw, twoSocket);
+
+    //More CPUs than the caller has room for must fail without registering anything.
+    hostSetTopology(twoSocket.root());
+    hostDispatch = nullptr;
+    CHECK(!pmRyzen_init(nullptr, 64));
+    CHECK(hostDispatch == nullptr);
+    CHECK(pmRyzen_cpus == nullptr);
+
+    return TEST_RESULT("TopologyTests");
+}
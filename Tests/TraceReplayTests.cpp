@@ -0,0 +1,132 @@
+//
+//  TraceReplayTests.cpp
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "TestHarness.h"
+#include "GovernorReplay.h"
+
+/**
+ *  Replays idle traces through the governors and reports latency and power proxies.
+ *
+ *  With no arguments it records a trace from a synthetic workload, checks that replaying
+ *  it reproduces every record including the P-state decisions, then reports each governor
+ *  on it. Given a file of AMDRyzenTraceRecords as the user client exports them for one
+ *  CPU, and optionally a governor name, it only reports on that trace.
+ */
+
+static const uint32_t kMaxRecords = 1 << 20;
+
+static void report(const char *name, const ReplayStats &s, uint32_t records){
+    printf("%-12s %8u %8.2f %10.3f %10.3f %10.3f\n", name, records, s.share(0) * 100,
+           s.transitionsPerSecond(), s.energy, s.delay * 1000);
+}
+
+static void reportHeader(){
+    printf("%-12s %8s %8s %10s %10s %10s\n", "governor", "records", "P0 %", "trans/s", "energy", "delay ms");
+}
+
+static int replayFile(const char *path, const char *governor){
+    FILE *f = fopen(path, "rb");
+    if(!f){
+        fprintf(stderr, "%s: cannot open\n", path);
+        return 1;
+    }
+
+    AMDRyzenTraceRecord *recs = (AMDRyzenTraceRecord*)malloc(kMaxRecords * sizeof(AMDRyzenTraceRecord));
+    uint32_t n = (uint32_t)fread(recs, sizeof(AMDRyzenTraceRecord), kMaxRecords, f);
+    fclose(f);
+
+    static GovernorReplay replay;
+    reportHeader();
+    for(uint32_t g = 0; g < PMRYZEN_GOV_COUNT; g++){
+        if(governor && strcmp(governor, pmRyzen_governor_name(g))) continue;
+
+        if(!replay.begin(g)){
+            free(recs);
+            return 1;
+        }
+        replay.replay(recs, n);
+        report(pmRyzen_governor_name(g), replay.end(), n);
+    }
+
+    free(recs);
+    return 0;
+}
+
+//Light load with bursts, long enough for several step downs and up again.
+static void workload(GovernorReplay &replay){
+    uint64_t second = GovernorReplay::us(1000000);
+    for(int i = 0; i < 2; i++){
+        replay.pattern(GovernorReplay::us(100), GovernorReplay::us(9900), 5 * second);
+        replay.pattern(GovernorReplay::us(9000), GovernorReplay::us(1000), 2 * second);
+        replay.pattern(GovernorReplay::us(30), GovernorReplay::us(20), second / 10);
+    }
+}
+
+int main(int argc, char **argv){
+    if(argc > 1) return replayFile(argv[1], argc > 2 ? argv[2] : nullptr);
+
+    static AMDRyzenTraceRecord recorded[8192];
+    static AMDRyzenTraceRecord replayed[8192];
+
+    //Record on one simulated CPU, replay on another starting from the same TSC.
+    static GovernorReplay recorder;
+    CHECK(recorder.begin(PMRYZEN_GOV_HEURISTIC));
+    CHECK(recorder.recordTo(recorded, 8192));
+    workload(recorder);
+    ReplayStats live = recorder.end();
+    uint32_t n = recorder.getRecorded();
+
+    CHECK(recorder.getRecordLost() == 0);
+    CHECK(n > 2 * AMDRYZEN_TRACE_LEN);
+    CHECK(n < 8192);
+    CHECK(live.transitions >= 2);
+
+    static GovernorReplay player;
+    CHECK(player.begin(PMRYZEN_GOV_HEURISTIC));
+    CHECK(player.recordTo(replayed, 8192));
+    player.replay(recorded, n);
+    ReplayStats again = player.end();
+
+    CHECK(player.getRecorded() == n);
+    uint32_t mismatched = 0;
+    for(uint32_t i = 0; i < n; i++){
+        if(replayed[i].idleTSC != recorded[i].idleTSC ||
+           replayed[i].idleLength != recorded[i].idleLength ||
+           replayed[i].PStateBefore != recorded[i].PStateBefore ||
+           replayed[i].PStateAfter != recorded[i].PStateAfter)
+            mismatched++;
+    }
+    CHECK(mismatched == 0);
+    //All but the busy period before the first record, 100us in P0.
+    CHECK(again.transitions == live.transitions);
+    CHECK(live.ticks - again.ticks == GovernorReplay::us(100));
+    CHECK_NEAR(live.energy - again.energy, 100e-6, 1e-9);
+    CHECK_NEAR(again.delay, live.delay, 1e-9);
+
+    //Every governor on the recorded trace, performance never delays and spends the most.
+    ReplayStats stats[PMRYZEN_GOV_COUNT];
+    reportHeader();
+    for(uint32_t g = 0; g < PMRYZEN_GOV_COUNT; g++){
+        CHECK(player.begin(g));
+        player.replay(recorded, n);
+        stats[g] = player.end();
+        report(pmRyzen_governor_name(g), stats[g], n);
+    }
+
+    CHECK(stats[PMRYZEN_GOV_PERFORMANCE].delay == 0);
+    for(uint32_t g = 0; g < PMRYZEN_GOV_COUNT; g++){
+        CHECK(stats[g].ticks == stats[PMRYZEN_GOV_HEURISTIC].ticks);
+        CHECK(stats[g].energy <= stats[PMRYZEN_GOV_PERFORMANCE].energy + 1e-9);
+        CHECK(stats[g].delay <= stats[PMRYZEN_GOV_POWERSAVE].delay + 1e-9);
+    }
+    CHECK(stats[PMRYZEN_GOV_POWERSAVE].delay > 0);
+
+    return TEST_RESULT("TraceReplayTests");
+}
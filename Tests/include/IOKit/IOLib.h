@@ -0,0 +1,33 @@
+//
+//  IOLib.h
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#ifndef Tests_IOLib_h
+#define Tests_IOLib_h
+
+#include <mach/mach_types.h>
+#include <strings.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void IOLog(const char *format, ...);
+void *IOMalloc(size_t size);
+void IOFree(void *address, size_t size);
+void *IOMallocAligned(size_t size, size_t alignment);
+void IOFreeAligned(void *address, size_t size);
+void IOSleep(unsigned milliseconds);
+void IODelay(unsigned microseconds);
+
+//kern/debug.h in the kernel, which IOLib.h pulls in.
+void panic(const char *format, ...) __attribute__((noreturn));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* Tests_IOLib_h */
@@ -0,0 +1,13 @@
+//
+//  IOPCIDevice.h
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#ifndef Tests_IOPCIDevice_h
+#define Tests_IOPCIDevice_h
+
+class IOPCIDevice;
+
+#endif /* Tests_IOPCIDevice_h */
@@ -0,0 +1,24 @@
+//
+//  pio.h
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#ifndef Tests_pio_h
+#define Tests_pio_h
+
+#include <mach/mach_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint8_t inb(i386_ioport_t port);
+void outb(i386_ioport_t port, uint8_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* Tests_pio_h */
@@ -0,0 +1,24 @@
+//
+//  proc_reg.h
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#ifndef Tests_proc_reg_h
+#define Tests_proc_reg_h
+
+#include <mach/mach_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint64_t rdmsr64(uint32_t msr);
+uint64_t rdtsc64(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* Tests_proc_reg_h */
@@ -0,0 +1,34 @@
+//
+//  mach_types.h
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#ifndef Tests_mach_types_h
+#define Tests_mach_types_h
+
+/**
+ *  Host stand-ins for the kernel headers the kext includes, just enough for the code under test.
+ *  Anything touching real hardware (rdmsr64, rdtsc64, inb, outb) is declared but never defined,
+ *  so a path that bypasses AMDRyzenCPUHardware fails to link instead of running.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef int boolean_t;
+typedef void *thread_t;
+typedef void *processor_t;
+typedef int kern_return_t;
+typedef uint16_t i386_ioport_t;
+
+#ifndef __cplusplus
+#define true 1
+#define false 0
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+#endif /* Tests_mach_types_h */
@@ -0,0 +1,8 @@
+//
+//  sysctl.h
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#include <mach/mach_types.h>
@@ -0,0 +1,8 @@
+//
+//  systm.h
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#include <mach/mach_types.h>
@@ -0,0 +1,8 @@
+//
+//  vm_kern.h
+//  Tests
+//
+//  Copyright © 2020 trulyspinach. All rights reserved.
+//
+
+#include <mach/mach_types.h>